@@ -0,0 +1,36 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MBED_PWMOUT_H
+#define MBED_PWMOUT_H
+
+#include "PinNames.h"
+
+namespace mbed {
+
+// hardware PWM is not simulated, writes are ignored
+class PwmOut {
+    public:
+        PwmOut(PinName pin) : duty(0) {}
+        void write(float value) { duty= value; }
+        float read() { return duty; }
+        void period(float seconds) {}
+        void period_ms(int ms) {}
+        void period_us(int us) {}
+        void pulsewidth(float seconds) {}
+        void pulsewidth_ms(int ms) {}
+        void pulsewidth_us(int us) {}
+        PwmOut& operator= (float value) { write(value); return *this; }
+        operator float() { return read(); }
+
+    private:
+        float duty;
+};
+
+}
+
+#endif
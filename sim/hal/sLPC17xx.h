@@ -0,0 +1,264 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host replacement for the LPC17xx device header used by the motion simulator.
+// Only the peripherals the motion code touches are modelled, see sim/src/Hal.cpp for their behaviour.
+
+#ifndef __LPC17xx_H__
+#define __LPC17xx_H__
+
+#include <stdint.h>
+
+typedef enum IRQn
+{
+    NonMaskableInt_IRQn           = -14,
+    MemoryManagement_IRQn         = -12,
+    BusFault_IRQn                 = -11,
+    UsageFault_IRQn               = -10,
+    SVCall_IRQn                   = -5,
+    DebugMonitor_IRQn             = -4,
+    PendSV_IRQn                   = -2,
+    SysTick_IRQn                  = -1,
+
+    WDT_IRQn                      = 0,
+    TIMER0_IRQn                   = 1,
+    TIMER1_IRQn                   = 2,
+    TIMER2_IRQn                   = 3,
+    TIMER3_IRQn                   = 4,
+    UART0_IRQn                    = 5,
+    UART1_IRQn                    = 6,
+    UART2_IRQn                    = 7,
+    UART3_IRQn                    = 8,
+    PWM1_IRQn                     = 9,
+    I2C0_IRQn                     = 10,
+    I2C1_IRQn                     = 11,
+    I2C2_IRQn                     = 12,
+    SPI_IRQn                      = 13,
+    SSP0_IRQn                     = 14,
+    SSP1_IRQn                     = 15,
+    PLL0_IRQn                     = 16,
+    RTC_IRQn                      = 17,
+    EINT0_IRQn                    = 18,
+    EINT1_IRQn                    = 19,
+    EINT2_IRQn                    = 20,
+    EINT3_IRQn                    = 21,
+    ADC_IRQn                      = 22,
+    BOD_IRQn                      = 23,
+    USB_IRQn                      = 24,
+    CAN_IRQn                      = 25,
+    DMA_IRQn                      = 26,
+    I2S_IRQn                      = 27,
+    ENET_IRQn                     = 28,
+    RIT_IRQn                      = 29,
+    MCPWM_IRQn                    = 30,
+    QEI_IRQn                      = 31,
+    PLL1_IRQn                     = 32,
+} IRQn_Type;
+
+#define __NVIC_PRIO_BITS          5
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+
+// peripheral addresses are only used by mbed's PinNames.h to number the pins
+#define LPC_GPIO_BASE         (0x2009C000UL)
+#define LPC_GPIO0_BASE        (LPC_GPIO_BASE + 0x00000)
+#define LPC_GPIO1_BASE        (LPC_GPIO_BASE + 0x00020)
+#define LPC_GPIO2_BASE        (LPC_GPIO_BASE + 0x00040)
+#define LPC_GPIO3_BASE        (LPC_GPIO_BASE + 0x00060)
+#define LPC_GPIO4_BASE        (LPC_GPIO_BASE + 0x00080)
+#define LPC_PINCON_BASE       (0x4002C000UL)
+
+// A register whose accesses have side effects in the simulated hardware, like timer counters or GPIO set/clear
+struct sim_reg {
+    sim_reg& operator=(uint32_t v);
+    sim_reg& operator|=(uint32_t v) { return *this = ((uint32_t)*this | v); }
+    sim_reg& operator&=(uint32_t v) { return *this = ((uint32_t)*this & v); }
+    operator uint32_t() const;
+
+    uint32_t value;
+
+private:
+    sim_reg& operator=(const sim_reg&);
+};
+
+typedef struct
+{
+    volatile uint32_t FIODIR;
+    uint32_t RESERVED0[3];
+    volatile uint32_t FIOMASK;
+    sim_reg FIOPIN;
+    sim_reg FIOSET;
+    sim_reg FIOCLR;
+} LPC_GPIO_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t IR;
+    sim_reg TCR;
+    sim_reg TC;
+    volatile uint32_t PR;
+    volatile uint32_t PC;
+    volatile uint32_t MCR;
+    volatile uint32_t MR0;
+    volatile uint32_t MR1;
+    volatile uint32_t MR2;
+    volatile uint32_t MR3;
+    volatile uint32_t CCR;
+    volatile uint32_t CR0;
+    volatile uint32_t CR1;
+    volatile uint32_t EMR;
+    volatile uint32_t CTCR;
+} LPC_TIM_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t RICOMPVAL;
+    volatile uint32_t RIMASK;
+    volatile uint32_t RICTRL;
+    volatile uint32_t RICOUNTER;
+} LPC_RIT_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t PCONP;
+    volatile uint32_t PCLKSEL0;
+    volatile uint32_t PCLKSEL1;
+} LPC_SC_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t PINSEL[11];
+    volatile uint32_t PINMODE0;
+    volatile uint32_t PINMODE1;
+    volatile uint32_t PINMODE2;
+    volatile uint32_t PINMODE3;
+    volatile uint32_t PINMODE4;
+    volatile uint32_t PINMODE5;
+    volatile uint32_t PINMODE6;
+    volatile uint32_t PINMODE7;
+    volatile uint32_t PINMODE8;
+    volatile uint32_t PINMODE9;
+    volatile uint32_t PINMODE_OD0;
+    volatile uint32_t PINMODE_OD1;
+    volatile uint32_t PINMODE_OD2;
+    volatile uint32_t PINMODE_OD3;
+    volatile uint32_t PINMODE_OD4;
+} LPC_PINCON_TypeDef;
+
+typedef struct
+{
+    volatile uint8_t  WDMOD;
+    volatile uint32_t WDTC;
+    volatile uint8_t  WDFEED;
+    volatile uint32_t WDTV;
+    volatile uint32_t WDCLKSEL;
+} LPC_WDT_TypeDef;
+
+// An ITM stimulus port write of one size, sent on to the SWO output of the simulator, the port always reads as ready
+template<typename T> struct sim_stimulus {
+    sim_stimulus& operator=(T v);
+    operator uint32_t() const { return 1; }
+};
+
+typedef struct
+{
+    struct {
+        sim_stimulus<uint8_t>  u8;
+        sim_stimulus<uint16_t> u16;
+        sim_stimulus<uint32_t> u32;
+        uint8_t RESERVED;
+    } PORT[32];
+    volatile uint32_t TER;
+    volatile uint32_t TPR;
+    volatile uint32_t TCR;
+} ITM_Type;
+
+#define ITM_TCR_ITMENA            1
+
+typedef struct
+{
+    volatile uint32_t CPUID;
+    volatile uint32_t ICSR;
+    volatile uint32_t VTOR;
+    volatile uint32_t AIRCR;
+    volatile uint32_t SCR;
+    volatile uint32_t CCR;
+} SCB_Type;
+
+#define SCB_ICSR_PENDSVSET_Msk    (1UL << 28)
+
+typedef struct
+{
+    volatile uint32_t DHCSR;
+    volatile uint32_t DCRSR;
+    volatile uint32_t DCRDR;
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+// CYCCNT reads the simulated clock once the counter is enabled
+typedef struct
+{
+    volatile uint32_t CTRL;
+    sim_reg CYCCNT;
+} DWT_Type;
+
+#define CoreDebug_DEMCR_TRCENA    (1 << 24)
+#define DWT_CTRL_CYCCNTENA        1
+
+extern LPC_GPIO_TypeDef   sim_gpio[5];
+extern LPC_TIM_TypeDef    sim_tim[4];
+extern LPC_RIT_TypeDef    sim_rit;
+extern LPC_SC_TypeDef     sim_sc;
+extern LPC_PINCON_TypeDef sim_pincon;
+extern LPC_WDT_TypeDef    sim_wdt;
+extern ITM_Type           sim_itm;
+extern SCB_Type           sim_scb;
+extern CoreDebug_Type     sim_coredebug;
+extern DWT_Type           sim_dwt;
+
+#define LPC_GPIO0   (&sim_gpio[0])
+#define LPC_GPIO1   (&sim_gpio[1])
+#define LPC_GPIO2   (&sim_gpio[2])
+#define LPC_GPIO3   (&sim_gpio[3])
+#define LPC_GPIO4   (&sim_gpio[4])
+#define LPC_TIM0    (&sim_tim[0])
+#define LPC_TIM1    (&sim_tim[1])
+#define LPC_TIM2    (&sim_tim[2])
+#define LPC_TIM3    (&sim_tim[3])
+#define LPC_RIT     (&sim_rit)
+#define LPC_SC      (&sim_sc)
+#define LPC_PINCON  (&sim_pincon)
+#define LPC_WDT     (&sim_wdt)
+#define ITM         (&sim_itm)
+#define SCB         (&sim_scb)
+#define CoreDebug   (&sim_coredebug)
+#define DWT         (&sim_dwt)
+
+// Interrupts only ever run when the simulator advances time, so masking them is just a flag
+extern uint32_t sim_primask;
+
+static inline void __disable_irq(void) { sim_primask = 1; }
+static inline void __enable_irq(void) { sim_primask = 0; }
+static inline uint32_t __get_PRIMASK(void) { return sim_primask; }
+static inline void __set_PRIMASK(uint32_t primask) { sim_primask = primask; }
+static inline void __NOP(void) {}
+static inline void __DSB(void) {}
+static inline void __ISB(void) {}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t NVIC_GetPriority(IRQn_Type IRQn);
+void NVIC_SetPriorityGrouping(uint32_t PriorityGroup);
+void NVIC_SystemReset(void);
+
+#endif
@@ -0,0 +1,347 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The simulated hardware: GPIO ports, TIMER0-3, the RIT and the NVIC, driven by a virtual clock.
+//
+// Time only passes in sim_run(), which is called when the firmware idles, and when the firmware reads a timer counter
+// (so busy waits on a counter terminate). Interrupt handlers take no simulated time unless given one with sim_set_handler_cycles(),
+// and are run to completion in priority order, so a higher priority interrupt that becomes due while a handler spins on a counter
+// or takes its time runs once that handler returns.
+// A match that resets its counter does so on the same count, so a timer period is exactly its match value.
+
+#include "Hal.h"
+
+#include "sLPC17xx.h"
+#include "system_LPC17xx.h"
+#include "mri.h"
+#include "mbed.h"
+#include "MRI_Hooks.h"
+#include "platform_memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+uint32_t SystemCoreClock = SIM_CORE_CLOCK;
+uint32_t sim_primask;
+
+LPC_GPIO_TypeDef   sim_gpio[5];
+LPC_TIM_TypeDef    sim_tim[4];
+LPC_RIT_TypeDef    sim_rit;
+LPC_SC_TypeDef     sim_sc;
+LPC_PINCON_TypeDef sim_pincon;
+LPC_WDT_TypeDef    sim_wdt;
+ITM_Type           sim_itm;
+SCB_Type           sim_scb;
+CoreDebug_Type     sim_coredebug;
+DWT_Type           sim_dwt;
+
+// The AHB SRAM banks, what the firmware's AHB0 and AHB1 pools are made of, see build/mbed_custom.cpp.
+// The pool of AHB1 starts after the statics the linker puts there, the Ethernet buffers and the uip tables,
+// which the sim has none of but are left out of it so a queue that fits here fits on the board.
+#define SIM_AHB1_STATICS 6000
+static uint8_t     sim_ahb_sram[2][16 * 1024];
+static MemoryPool  sim_ahb0(sim_ahb_sram[0], sizeof(sim_ahb_sram[0]));
+static MemoryPool  sim_ahb1(sim_ahb_sram[1] + SIM_AHB1_STATICS, sizeof(sim_ahb_sram[1]) - SIM_AHB1_STATICS);
+MemoryPool*        _AHB0 = &sim_ahb0;
+MemoryPool*        _AHB1 = &sim_ahb1;
+
+extern "C" {
+    void TIMER0_IRQHandler(void) __attribute__((weak));
+    void TIMER1_IRQHandler(void) __attribute__((weak));
+    void TIMER2_IRQHandler(void) __attribute__((weak));
+    void TIMER3_IRQHandler(void) __attribute__((weak));
+    void RIT_IRQHandler(void) __attribute__((weak));
+    void PendSV_Handler(void) __attribute__((weak));
+}
+
+// indexed by exception number, which is IRQn + 16
+#define NUM_EXCEPTIONS (16 + PLL1_IRQn + 1)
+static bool     irq_enabled[NUM_EXCEPTIONS];
+static bool     irq_pending[NUM_EXCEPTIONS];
+static uint32_t irq_priority[NUM_EXCEPTIONS];
+static uint64_t handler_cycles[NUM_EXCEPTIONS];
+
+static uint64_t now;
+static bool in_handler;
+static sim_gpio_hook_t gpio_hook;
+static FILE* swo_file;
+
+uint64_t sim_time() { return now; }
+void sim_set_gpio_hook(sim_gpio_hook_t hook) { gpio_hook = hook; }
+// a probe capturing the SWO output enables the ITM and all the stimulus ports
+void sim_set_swo_file(FILE* fp)
+{
+    swo_file = fp;
+    sim_itm.TCR = fp != NULL ? ITM_TCR_ITMENA : 0;
+    sim_itm.TER = fp != NULL ? 0xFFFFFFFF : 0;
+}
+void sim_set_handler_cycles(int irqn, uint64_t cycles) { handler_cycles[irqn + 16] = cycles; }
+
+static inline int exception_number(IRQn_Type IRQn) { return (int)IRQn + 16; }
+
+// Timers are clocked at SystemCoreClock/4, returns the number of timer counts until the next MR0 match
+static uint64_t counts_to_match(const LPC_TIM_TypeDef *tim)
+{
+    uint32_t tc = tim->TC.value;
+    uint32_t mr = tim->MR0;
+    if((tim->MCR & 2) && tc < mr) return mr - tc;
+    uint32_t d = mr - tc;
+    return d == 0 ? (1ULL << 32) : d;
+}
+
+static inline bool timer_running(const LPC_TIM_TypeDef *tim) { return (tim->TCR.value & 3) == 1; }
+
+static void advance_timer(int i, uint64_t counts)
+{
+    LPC_TIM_TypeDef *tim = &sim_tim[i];
+    while(counts > 0) {
+        uint64_t d = counts_to_match(tim);
+        if(counts < d) {
+            tim->TC.value += counts;
+            return;
+        }
+        counts -= d;
+        tim->TC.value = (tim->MCR & 2) ? 0 : tim->MR0;
+        if(tim->MCR & 1) {
+            tim->IR |= 1;
+            irq_pending[exception_number((IRQn_Type)(TIMER0_IRQn + i))] = true;
+        }
+    }
+}
+
+// The RIT is clocked at SystemCoreClock
+static uint64_t cycles_to_rit_match()
+{
+    uint32_t d = sim_rit.RICOMPVAL - sim_rit.RICOUNTER;
+    return d == 0 ? (1ULL << 32) : d;
+}
+
+static void advance_rit(uint64_t cycles)
+{
+    while(cycles > 0) {
+        uint64_t d = cycles_to_rit_match();
+        if(cycles < d) {
+            sim_rit.RICOUNTER += cycles;
+            return;
+        }
+        cycles -= d;
+        sim_rit.RICOUNTER = (sim_rit.RICTRL & 2) ? 0 : sim_rit.RICOMPVAL;
+        sim_rit.RICTRL |= 1;
+        irq_pending[exception_number(RIT_IRQn)] = true;
+    }
+}
+
+// Move the clock forward, counting the timers and marking interrupts pending, but without running any handler
+static void advance(uint64_t cycles)
+{
+    for (int i = 0; i < 4; i++) {
+        if(timer_running(&sim_tim[i])) {
+            advance_timer(i, (now + cycles) / 4 - now / 4);
+        }
+    }
+    if(sim_rit.RICTRL & 8) {
+        advance_rit(cycles);
+    }
+    now += cycles;
+}
+
+// Number of cycles until the next event that can raise an interrupt
+static uint64_t cycles_to_next_event()
+{
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < 4; i++) {
+        if(timer_running(&sim_tim[i]) && (sim_tim[i].MCR & 1)) {
+            uint64_t d = (now / 4 + counts_to_match(&sim_tim[i])) * 4 - now;
+            if(d < next) next = d;
+        }
+    }
+    if(sim_rit.RICTRL & 8) {
+        uint64_t d = cycles_to_rit_match();
+        if(d < next) next = d;
+    }
+    return next;
+}
+
+static void (*handler_for(int exception))(void)
+{
+    switch(exception - 16) {
+        case PendSV_IRQn: return PendSV_Handler;
+        case TIMER0_IRQn: return TIMER0_IRQHandler;
+        case TIMER1_IRQn: return TIMER1_IRQHandler;
+        case TIMER2_IRQn: return TIMER2_IRQHandler;
+        case TIMER3_IRQn: return TIMER3_IRQHandler;
+        case RIT_IRQn:    return RIT_IRQHandler;
+    }
+    return NULL;
+}
+
+// Run every pending interrupt, highest priority (lowest value) first, ties go to the lowest exception number
+static void dispatch()
+{
+    if(in_handler) return;
+    in_handler = true;
+    while(!sim_primask) {
+        if(sim_scb.ICSR & SCB_ICSR_PENDSVSET_Msk) {
+            sim_scb.ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+            irq_pending[exception_number(PendSV_IRQn)] = true;
+        }
+
+        int best = -1;
+        for (int e = 0; e < NUM_EXCEPTIONS; e++) {
+            if(irq_pending[e] && irq_enabled[e] && (best < 0 || irq_priority[e] < irq_priority[best])) best = e;
+        }
+        if(best < 0) break;
+
+        irq_pending[best] = false;
+        void (*handler)(void) = handler_for(best);
+        if(handler != NULL) handler();
+        advance(handler_cycles[best]);
+    }
+    in_handler = false;
+}
+
+void sim_run(uint64_t cycles)
+{
+    uint64_t end = now + cycles;
+    dispatch();
+    while(now < end) {
+        uint64_t step = cycles_to_next_event();
+        if(step > end - now) step = end - now;
+        advance(step);
+        dispatch();
+    }
+}
+
+static int gpio_port(const sim_reg *reg, const sim_reg LPC_GPIO_TypeDef::*field)
+{
+    for (int p = 0; p < 5; p++) {
+        if(reg == &(sim_gpio[p].*field)) return p;
+    }
+    return -1;
+}
+
+static void gpio_output(int port, uint32_t level)
+{
+    uint32_t before = sim_gpio[port].FIOPIN.value;
+    sim_gpio[port].FIOPIN.value = level;
+    if(gpio_hook != NULL && before != level) gpio_hook(port, before, level);
+}
+
+sim_reg& sim_reg::operator=(uint32_t v)
+{
+    int p;
+    if((p = gpio_port(this, &LPC_GPIO_TypeDef::FIOSET)) >= 0) {
+        gpio_output(p, sim_gpio[p].FIOPIN.value | (v & ~sim_gpio[p].FIOMASK));
+
+    }else if((p = gpio_port(this, &LPC_GPIO_TypeDef::FIOCLR)) >= 0) {
+        gpio_output(p, sim_gpio[p].FIOPIN.value & ~(v & ~sim_gpio[p].FIOMASK));
+
+    }else if((p = gpio_port(this, &LPC_GPIO_TypeDef::FIOPIN)) >= 0) {
+        uint32_t mask = sim_gpio[p].FIOMASK;
+        gpio_output(p, (sim_gpio[p].FIOPIN.value & mask) | (v & ~mask));
+
+    }else{
+        this->value = v;
+        // counter reset holds the counter at zero
+        for (int i = 0; i < 4; i++) {
+            if(this == &sim_tim[i].TCR && (v & 2)) sim_tim[i].TC.value = 0;
+        }
+    }
+    return *this;
+}
+
+sim_reg::operator uint32_t() const
+{
+    // set and clear registers read as zero
+    if(gpio_port(this, &LPC_GPIO_TypeDef::FIOSET) >= 0 || gpio_port(this, &LPC_GPIO_TypeDef::FIOCLR) >= 0) return 0;
+
+    if(this == &sim_dwt.CYCCNT) {
+        bool running = (sim_coredebug.DEMCR & CoreDebug_DEMCR_TRCENA) && (sim_dwt.CTRL & DWT_CTRL_CYCCNTENA);
+        return running ? (uint32_t)now : this->value;
+    }
+
+    // reading a running counter takes one count, so polling loops see time pass
+    for (int i = 0; i < 4; i++) {
+        if(this == &sim_tim[i].TC && timer_running(&sim_tim[i])) {
+            uint32_t tc = this->value;
+            advance(4 - now % 4);
+            return tc;
+        }
+    }
+    return this->value;
+}
+
+// An instrumentation packet: the port and payload size in the header byte, then the payload little endian
+template<typename T> sim_stimulus<T>& sim_stimulus<T>::operator=(T v)
+{
+    if(swo_file != NULL) {
+        const size_t port_size = sizeof(sim_itm.PORT[0]);
+        int port = ((const uint8_t*)this - (const uint8_t*)&sim_itm.PORT[0]) / port_size;
+        putc((port << 3) | (sizeof(T) == 4 ? 3 : sizeof(T)), swo_file);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            putc((v >> (8 * i)) & 0xFF, swo_file);
+        }
+    }
+    return *this;
+}
+
+template struct sim_stimulus<uint8_t>;
+template struct sim_stimulus<uint16_t>;
+template struct sim_stimulus<uint32_t>;
+
+void NVIC_EnableIRQ(IRQn_Type IRQn) { irq_enabled[exception_number(IRQn)] = true; }
+void NVIC_DisableIRQ(IRQn_Type IRQn) { irq_enabled[exception_number(IRQn)] = false; }
+void NVIC_SetPendingIRQ(IRQn_Type IRQn) { irq_pending[exception_number(IRQn)] = true; }
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn) { return irq_pending[exception_number(IRQn)] ? 1 : 0; }
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn) { irq_pending[exception_number(IRQn)] = false; }
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority) { irq_priority[exception_number(IRQn)] = priority; }
+uint32_t NVIC_GetPriority(IRQn_Type IRQn) { return irq_priority[exception_number(IRQn)]; }
+void NVIC_SetPriorityGrouping(uint32_t PriorityGroup) {}
+
+void NVIC_SystemReset(void)
+{
+    fprintf(stderr, "sim: system reset requested\n");
+    exit(3);
+}
+
+// the core exceptions are always enabled
+static struct core_exceptions {
+    core_exceptions() { irq_enabled[exception_number(PendSV_IRQn)] = true; }
+} core_exceptions;
+
+extern "C" {
+
+void __debugbreak(void)
+{
+    fprintf(stderr, "sim: __debugbreak() at %llu cycles\n", (unsigned long long)now);
+    abort();
+}
+
+uint32_t us_ticker_read(void)
+{
+    return now / (SystemCoreClock / 1000000);
+}
+
+void wait_us(int us)
+{
+    sim_run((uint64_t)us * (SystemCoreClock / 1000000));
+}
+
+void wait_ms(int ms)
+{
+    wait_us(ms * 1000);
+}
+
+void wait(float s)
+{
+    wait_us(s * 1000000.0F);
+}
+
+void set_high_on_debug(int port, int pin) {}
+void set_low_on_debug(int port, int pin) {}
+
+}
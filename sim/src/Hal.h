@@ -0,0 +1,26 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Simulated LPC1768 running at 100MHz, timers are clocked at a quarter of that
+#define SIM_CORE_CLOCK 100000000UL
+
+// Called with the old and new pin levels of a GPIO port whenever an output changes
+typedef void (*sim_gpio_hook_t)(int port, uint32_t before, uint32_t after);
+
+uint64_t sim_time();                    // in core clock cycles since reset
+void sim_run(uint64_t cycles);          // let time pass, running every interrupt that becomes due
+void sim_set_gpio_hook(sim_gpio_hook_t hook);
+void sim_set_swo_file(FILE* fp);        // write the ITM stimulus port writes to this file as an SWO capture would have them
+void sim_set_handler_cycles(int irqn, uint64_t cycles);    // time this interrupt's handler takes after it has run
+
+#endif
@@ -0,0 +1,106 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Stands in for src/libs/ConfigSources/FirmConfigSource.cpp: instead of the config.default linked into the firmware,
+// the "firm" config is the machine config given to the simulator, with any overrides from the command line applied.
+// There is no SD card, so the FileConfigSource is never used and only stubbed out.
+
+#include "libs/Kernel.h"
+#include "ConfigValue.h"
+#include "FirmConfigSource.h"
+#include "FileConfigSource.h"
+#include "ConfigCache.h"
+#include "utils.h"
+#include "SimConfig.h"
+
+using namespace std;
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+static vector<string> config_lines;
+
+static string key_of(const string& line)
+{
+    size_t begin = line.find_first_not_of(" \t");
+    if(begin == string::npos || line[begin] == '#') return "";
+    size_t end = line.find_first_of(" \t\r\n#", begin);
+    return line.substr(begin, end == string::npos ? string::npos : end - begin);
+}
+
+bool sim_config_load(const char* filename)
+{
+    FILE *fp = fopen(filename, "r");
+    if(fp == NULL) return false;
+
+    char buf[256];
+    while(fgets(buf, sizeof buf, fp) != NULL) {
+        config_lines.push_back(buf);
+    }
+    fclose(fp);
+    return true;
+}
+
+// Replaces the value of the key if it is already set, so the config cache does not warn about duplicates
+void sim_config_set(const string& key, const string& value)
+{
+    string line = key + " " + value;
+    for (auto &l : config_lines) {
+        if(key_of(l) == key) {
+            l = line;
+            return;
+        }
+    }
+    config_lines.push_back(line);
+}
+
+FirmConfigSource::FirmConfigSource(const char* name){
+    this->name_checksum = get_checksum(name);
+}
+
+void FirmConfigSource::transfer_values_to_cache( ConfigCache* cache ){
+    for (auto &line : config_lines) {
+        process_line_from_ascii_config(line, cache);
+    }
+}
+
+bool FirmConfigSource::is_named( uint16_t check_sum ){
+    return check_sum == this->name_checksum;
+}
+
+bool FirmConfigSource::write( string setting, string value ){
+    return false;
+}
+
+string FirmConfigSource::read( uint16_t check_sums[3] ){
+    string value = "";
+    for (auto &line : config_lines) {
+        value = process_line_from_ascii_config(line, check_sums);
+        if(!value.empty()) return value;
+    }
+    return value;
+}
+
+FileConfigSource::FileConfigSource(string config_file, const char *name){
+    this->name_checksum = get_checksum(name);
+    this->config_file = config_file;
+    this->config_file_found = false;
+}
+
+void FileConfigSource::transfer_values_to_cache( ConfigCache *cache ){}
+
+bool FileConfigSource::is_named( uint16_t check_sum ){
+    return check_sum == this->name_checksum;
+}
+
+bool FileConfigSource::write( string setting, string value ){
+    return false;
+}
+
+string FileConfigSource::read( uint16_t check_sums[3] ){
+    return "";
+}
@@ -0,0 +1,157 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Stands in for src/libs/Kernel.cpp: the same event dispatch and step ticker setup, but only the motion modules are loaded,
+// there is no serial console, ADC or slow ticker. Keep the step ticker configuration in sync with the firmware kernel.
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/Config.h"
+#include "libs/nuts_bolts.h"
+#include "libs/utils.h"
+#include "libs/StreamOutput.h"
+#include "libs/StreamOutputPool.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+
+#include "libs/StepTicker.h"
+#include "libs/IsrProfiler.h"
+#include "modules/communication/GcodeDispatch.h"
+#include "modules/robot/Planner.h"
+#include "modules/robot/Robot.h"
+#include "modules/robot/Stepper.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/robot/Pauser.h"
+
+#include "sLPC17xx.h"
+
+#include <stdio.h>
+
+#define base_stepping_frequency_checksum            CHECKSUM("base_stepping_frequency")
+#define microseconds_per_step_pulse_checksum        CHECKSUM("microseconds_per_step_pulse")
+#define acceleration_ticks_per_second_checksum      CHECKSUM("acceleration_ticks_per_second")
+#define port_batched_stepping_checksum              CHECKSUM("port_batched_stepping")
+#define step_ticker_engine_checksum                 CHECKSUM("step_ticker_engine")
+#define event_checksum                              CHECKSUM("event")
+#define bresenham_checksum                          CHECKSUM("bresenham")
+#define max_steps_per_tick_checksum                 CHECKSUM("max_steps_per_tick")
+#define isr_profiler_enable_checksum                CHECKSUM("isr_profiler_enable")
+#define event_profiler_enable_checksum              CHECKSUM("event_profiler_enable")
+
+Kernel* Kernel::instance;
+
+// kernel messages go to stderr, from the start like the serial console's, so the warnings of the modules loading reach it
+class StderrStream : public StreamOutput {
+    public:
+        int puts(const char* str) { return fputs(str, stderr); }
+};
+static StderrStream stderr_stream;
+
+Kernel::Kernel(){
+    instance= this; // setup the Singleton instance of the kernel
+
+    this->serial= NULL;
+    this->slow_ticker= NULL;
+    this->adc= NULL;
+    this->temperature_control_pool= NULL;
+    this->debug= 0;
+    this->use_leds= false;
+
+    this->config = new Config();
+    this->config->config_cache_load();
+
+    this->streams = new StreamOutputPool();
+    this->streams->append_stream(&stderr_stream);
+
+    this->current_path   = "/";
+
+    this->add_module( this->config, "Config" );
+
+    this->step_ticker = new StepTicker();
+
+    NVIC_SetPriorityGrouping(0);
+    NVIC_SetPriority(TIMER0_IRQn, 2);
+    NVIC_SetPriority(TIMER1_IRQn, 1);
+    NVIC_SetPriority(TIMER2_IRQn, 4);
+    NVIC_SetPriority(PendSV_IRQn, 3);
+    NVIC_SetPriority(RIT_IRQn, 3);
+
+    // Configure the step ticker
+    this->base_stepping_frequency = this->config->value(base_stepping_frequency_checksum)->by_default(100000)->as_number();
+    float microseconds_per_step_pulse = this->config->value(microseconds_per_step_pulse_checksum)->by_default(5)->as_number();
+    this->acceleration_ticks_per_second = THEKERNEL->config->value(acceleration_ticks_per_second_checksum)->by_default(1000)->as_number();
+
+    this->step_ticker->set_reset_delay( microseconds_per_step_pulse );
+    this->step_ticker->set_frequency( this->base_stepping_frequency );
+    this->step_ticker->set_acceleration_ticks_per_second(acceleration_ticks_per_second); // must be set after set_frequency
+    this->step_ticker->set_port_batching(this->config->value(port_batched_stepping_checksum)->by_default(false)->as_bool());
+    int engine_checksum = get_checksum(this->config->value(step_ticker_engine_checksum)->by_default("fixed")->as_string());
+    this->step_ticker->set_event_driven(engine_checksum == event_checksum);
+    this->step_ticker->set_bresenham(engine_checksum == bresenham_checksum);
+    int max_steps_per_tick = this->config->value(max_steps_per_tick_checksum)->by_default(1)->as_number();
+    if( this->step_ticker->set_max_steps_per_tick(max_steps_per_tick) < max_steps_per_tick ){
+        this->streams->printf("WARNING: max_steps_per_tick is %d instead of %d, it needs the fixed engine without port batching, and the step pulses of a burst with their gaps must fit in a tick\n",
+                              this->step_ticker->get_max_steps_per_tick(), max_steps_per_tick);
+    }
+
+    IsrProfiler::enable(this->config->value(isr_profiler_enable_checksum)->by_default(false)->as_bool());
+    // and this with the eventstats command, when it has been built in
+    EventProfiler::enable(this->config->value(event_profiler_enable_checksum)->by_default(false)->as_bool());
+
+    // Core modules
+    this->add_module( new GcodeDispatch(),                         "GcodeDispatch" );
+    this->add_module( this->robot          = new Robot(),          "Robot"         );
+    this->add_module( this->stepper        = new Stepper(),        "Stepper"       );
+    this->add_module( this->conveyor       = new Conveyor(),       "Conveyor"      );
+    this->add_module( this->pauser         = new Pauser(),         "Pauser"        );
+
+    this->planner = new Planner();
+}
+
+void Kernel::register_for_event(_EVENT_ENUM id_event, Module *mod){
+    EventProfiler::add(mod, id_event);
+    if(id_event == ON_GCODE_RECEIVED) {
+        this->gcode_hooks.add_any(mod);
+        return;
+    }
+    if(id_event == ON_CONSOLE_LINE_RECEIVED) {
+        this->console_hooks.add_any(mod);
+        return;
+    }
+    this->hooks[id_event].push_back(mod);
+}
+
+// Adds a hook for ON_GCODE_RECEIVED of a single G or M code
+void Kernel::register_for_gcode(Module *mod, char letter, unsigned int code){
+    EventProfiler::add(mod, ON_GCODE_RECEIVED);
+    this->gcode_hooks.add_code(mod, letter, code);
+}
+
+void Kernel::register_for_command(Module *mod, const char *command){
+    EventProfiler::add(mod, ON_CONSOLE_LINE_RECEIVED);
+    this->console_hooks.add_command(mod, command);
+}
+
+void Kernel::call_event(_EVENT_ENUM id_event){
+    for (auto m : hooks[id_event]) {
+        EventProfiler::call_handler(m, id_event, this);
+    }
+}
+
+void Kernel::call_event(_EVENT_ENUM id_event, void * argument){
+    if(id_event == ON_GCODE_RECEIVED) {
+        this->gcode_hooks.call(static_cast<Gcode*>(argument));
+        return;
+    }
+    if(id_event == ON_CONSOLE_LINE_RECEIVED) {
+        this->console_hooks.call(static_cast<SerialMessage*>(argument));
+        return;
+    }
+    for (auto m : hooks[id_event]) {
+        EventProfiler::call_handler(m, id_event, argument);
+    }
+}
@@ -0,0 +1,126 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StepTrace.h"
+
+StepTraceWriter::StepTraceWriter()
+{
+    this->fp = NULL;
+    this->clock = 0;
+    this->steps = 0;
+    for (int i = 0; i < 5; i++) this->levels[i] = 0;
+}
+
+StepTraceWriter::~StepTraceWriter()
+{
+    close();
+}
+
+// Actuators must all be added before the trace is opened
+void StepTraceWriter::add_actuator(int step_port, int step_pin, bool step_inverting, int dir_port, int dir_pin, bool dir_inverting)
+{
+    actuator_t a;
+    a.step.port = step_port;
+    a.step.mask = 1U << step_pin;
+    a.step.inverting = step_inverting;
+    a.dir.port = dir_port;
+    a.dir.mask = 1U << dir_pin;
+    a.dir.inverting = dir_inverting;
+    this->actuators.push_back(a);
+}
+
+bool StepTraceWriter::open(const char* filename, uint32_t clock)
+{
+    this->fp = fopen(filename, "wb");
+    if(this->fp == NULL) return false;
+
+    this->clock = clock;
+    step_trace_header_t header;
+    header.magic = STEP_TRACE_MAGIC;
+    header.version = STEP_TRACE_VERSION;
+    header.clock = clock;
+    header.actuators = this->actuators.size();
+    fwrite(&header, sizeof(header), 1, this->fp);
+    return true;
+}
+
+void StepTraceWriter::close()
+{
+    if(this->fp != NULL) {
+        fclose(this->fp);
+        this->fp = NULL;
+    }
+}
+
+void StepTraceWriter::write_record(uint64_t time, int actuator, STEP_TRACE_EVENT event, bool dir)
+{
+    if(this->fp == NULL) return;
+    step_trace_record_t r;
+    r.time = time;
+    r.actuator = actuator;
+    r.event = event;
+    r.dir = dir ? 1 : 0;
+    r.reserved = 0;
+    fwrite(&r, sizeof(r), 1, this->fp);
+}
+
+// Direction changes are recorded before steps, a driver samples dir on the step edge
+void StepTraceWriter::on_gpio_change(int port, uint32_t before, uint32_t after, uint64_t time)
+{
+    this->levels[port] = after;
+    for (size_t i = 0; i < this->actuators.size(); i++) {
+        const actuator_t &a = this->actuators[i];
+        if(a.dir.port == port && level(a.dir, before) != level(a.dir, after)) {
+            write_record(time, i, STEP_TRACE_DIR, level(a.dir, after));
+        }
+    }
+    for (size_t i = 0; i < this->actuators.size(); i++) {
+        const actuator_t &a = this->actuators[i];
+        if(a.step.port == port && !level(a.step, before) && level(a.step, after)) {
+            write_record(time, i, STEP_TRACE_STEP, level(a.dir, this->levels[a.dir.port]));
+            this->steps++;
+        }
+    }
+}
+
+bool read_step_trace(const char* filename, step_trace_t& trace, std::string& error)
+{
+    FILE *fp = fopen(filename, "rb");
+    if(fp == NULL) {
+        error = std::string("cannot open ") + filename;
+        return false;
+    }
+
+    step_trace_header_t header;
+    if(fread(&header, sizeof(header), 1, fp) != 1 || header.magic != STEP_TRACE_MAGIC || header.version != STEP_TRACE_VERSION) {
+        error = std::string(filename) + " is not a step trace";
+        fclose(fp);
+        return false;
+    }
+
+    trace.clock = header.clock;
+    trace.actuators.assign(header.actuators, actuator_trace_t());
+    for (auto &a : trace.actuators) {
+        a.position = 0;
+        a.dir_changes = 0;
+    }
+
+    step_trace_record_t r;
+    while(fread(&r, sizeof(r), 1, fp) == 1) {
+        if(r.actuator >= trace.actuators.size()) continue;
+        actuator_trace_t &a = trace.actuators[r.actuator];
+        if(r.event == STEP_TRACE_STEP) {
+            a.step_times.push_back(r.time);
+            a.position += r.dir ? -1 : 1;
+        }else if(r.event == STEP_TRACE_DIR) {
+            a.dir_changes++;
+        }
+    }
+
+    fclose(fp);
+    return true;
+}
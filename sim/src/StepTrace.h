@@ -0,0 +1,90 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STEPTRACE_H
+#define STEPTRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// A step trace is the binary step/direction timeline of every actuator, as seen on the step and dir pins.
+// It is a header followed by one record per event, in time order, all little endian.
+
+#define STEP_TRACE_MAGIC   0x54534D53 // "SMST"
+#define STEP_TRACE_VERSION 1
+
+struct step_trace_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t clock;         // time units per second
+    uint32_t actuators;
+};
+
+enum STEP_TRACE_EVENT {
+    STEP_TRACE_STEP = 1,    // leading edge of a step pulse
+    STEP_TRACE_DIR  = 2,    // direction pin changed
+};
+
+struct step_trace_record_t {
+    uint64_t time;
+    uint8_t  actuator;
+    uint8_t  event;
+    uint8_t  dir;           // logical direction, 1 is towards negative positions
+    uint8_t  reserved;
+} __attribute__((packed));
+
+// Records the step and dir pins of the actuators from the simulated GPIO ports
+class StepTraceWriter {
+    public:
+        StepTraceWriter();
+        ~StepTraceWriter();
+
+        bool open(const char* filename, uint32_t clock);
+        void add_actuator(int step_port, int step_pin, bool step_inverting, int dir_port, int dir_pin, bool dir_inverting);
+        void close();
+
+        void on_gpio_change(int port, uint32_t before, uint32_t after, uint64_t time);
+
+        uint32_t get_steps() const { return steps; }
+
+    private:
+        struct pin_t {
+            uint8_t port;
+            uint32_t mask;
+            bool inverting;
+        };
+        struct actuator_t {
+            pin_t step;
+            pin_t dir;
+        };
+        void write_record(uint64_t time, int actuator, STEP_TRACE_EVENT event, bool dir);
+        static bool level(const pin_t& pin, uint32_t port_level) { return ((port_level & pin.mask) != 0) ^ pin.inverting; }
+
+        std::vector<actuator_t> actuators;
+        uint32_t levels[5];     // last seen level of each GPIO port
+        FILE* fp;
+        uint32_t clock;
+        uint32_t steps;
+};
+
+// The steps of one actuator read back from a trace
+struct actuator_trace_t {
+    std::vector<uint64_t> step_times;
+    int64_t position;       // net steps, counting direction
+    uint32_t dir_changes;
+};
+
+struct step_trace_t {
+    uint32_t clock;
+    std::vector<actuator_trace_t> actuators;
+};
+
+bool read_step_trace(const char* filename, step_trace_t& trace, std::string& error);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// decimaltest: checks the number parsers of src/libs/decimal.h against the C library and times them, on the host.
+//   decimaltest [-n count] [-s seed] [file]...
+// decimal_strtof must give the same bits and the same end as strtof from every position of every line of the files,
+// and for count random numbers printed the way CAM programs and slicers print them. decimal_strtofixed is checked
+// against the long double value of the same numbers, except where that is too close to a tie to be sure of the rounding.
+// Gcode::get_int and get_uint must give the integer strtol and strtoul give for the value of a word.
+
+#include "decimal.h"
+#include "Gcode.h"
+#include "MemoryPool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+static int mismatches = 0;
+
+// the pool the gcodes keep their words in, like the firmware's AHB0
+static uint8_t ahb0_sram[16 * 1024];
+static MemoryPool ahb0(ahb0_sram, sizeof(ahb0_sram));
+MemoryPool* _AHB0 = &ahb0;
+
+// the pool breaks into the debugger when it is corrupted
+extern "C" void __debugbreak(void)
+{
+    fprintf(stderr, "decimaltest: __debugbreak()\n");
+    abort();
+}
+
+static double host_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void check_strtof(const char* str)
+{
+    char *end, *fast_end;
+    float r = strtof(str, &end);
+    float fast = decimal_strtof(str, &fast_end);
+    if(memcmp(&r, &fast, sizeof(float)) != 0 || end != fast_end) {
+        if(mismatches++ < 20) {
+            printf("decimal_strtof(\"%s\") is %.9g ending at %d, strtof %.9g ending at %d\n",
+                   str, fast, (int)(fast_end - str), r, (int)(end - str));
+        }
+    }
+}
+
+static void check_strtofixed(const char* str, int decimals)
+{
+    char *end, *fixed_end;
+    long double exact = strtold(str, &end) * powl(10.0L, decimals);
+    int32_t fixed = decimal_strtofixed(str, decimals, &fixed_end);
+    if(strpbrk(str, "eExXiInN") != NULL) return;
+
+    long double rounded = exact < 0 ? -floorl(-exact + 0.5L) : floorl(exact + 0.5L);
+    if(fabsl(fabsl(exact - truncl(exact)) - 0.5L) < 1e-6L) return;
+    if(rounded > INT32_MAX) rounded = INT32_MAX;
+    if(rounded < INT32_MIN) rounded = INT32_MIN;
+    if((long double)fixed != rounded || end != fixed_end) {
+        if(mismatches++ < 20) {
+            printf("decimal_strtofixed(\"%s\", %d) is %ld ending at %d, expected %.0Lf ending at %d\n",
+                   str, decimals, (long)fixed, (int)(fixed_end - str), rounded, (int)(end - str));
+        }
+    }
+}
+
+// line is a gcode, letter one of its words with the integer value expected
+static void check_gcode_int(const char* line, char letter, uint32_t expected, bool strip_parameters= false)
+{
+    Gcode gcode(line, nullptr);
+    if(strip_parameters) gcode.strip_parameters();
+    if(gcode.get_uint(letter) != expected || gcode.get_int(letter) != (int)expected) {
+        if(mismatches++ < 20) {
+            printf("Gcode(\"%s\").get_uint('%c') is %lu, get_int %d, expected %lu\n",
+                   line, letter, (unsigned long)gcode.get_uint(letter), gcode.get_int(letter), (unsigned long)expected);
+        }
+    }
+}
+
+// line is a G0-G3 gcode, command what is left of it once its XYZIJK parameters are stripped
+static void check_gcode_strip(const char* line, const char* command)
+{
+    Gcode gcode(line, nullptr);
+    gcode.strip_parameters();
+    if(strcmp(gcode.get_command(), command) != 0) {
+        if(mismatches++ < 20) printf("Gcode(\"%s\") stripped is \"%s\", expected \"%s\"\n", line, gcode.get_command(), command);
+    }
+}
+
+// A number as a CAM program, a slicer or a person would write it
+static std::string random_number()
+{
+    char buf[64];
+    int magnitude = rand() % 7;
+    double v = (rand() / (double)RAND_MAX) * pow(10.0, magnitude - 2);
+    if(rand() % 3 == 0) v = -v;
+    switch(rand() % 8) {
+        case 0: snprintf(buf, sizeof(buf), "%.0f", v); break;
+        case 1: snprintf(buf, sizeof(buf), "%.9f", v); break;
+        case 2: snprintf(buf, sizeof(buf), "%g", v); break;
+        case 3: snprintf(buf, sizeof(buf), "%+.4f", v); break;
+        default: snprintf(buf, sizeof(buf), "%.*f", 1 + rand() % 6, v); break;
+    }
+    std::string s(buf);
+    // some drop the leading zero or the trailing zeros
+    if(rand() % 4 == 0) {
+        size_t zero = s.find("0.");
+        if(zero != std::string::npos && (zero == 0 || !isdigit(s[zero - 1]))) s.erase(zero, 1);
+    }
+    if(s.find('.') != std::string::npos && s.find('e') == std::string::npos && rand() % 4 == 0) {
+        s.erase(s.find_last_not_of('0') + 1);
+    }
+    return s;
+}
+
+static double time_parser(const std::vector<std::string>& numbers, bool fast)
+{
+    float sum = 0;
+    double start = host_seconds();
+    for (int pass = 0; pass < 10; pass++) {
+        for (auto &s : numbers) {
+            sum += fast ? decimal_strtof(s.c_str(), nullptr) : strtof(s.c_str(), nullptr);
+        }
+    }
+    double t = host_seconds() - start;
+    // keep the sum so the calls are not optimized away
+    if(sum == 1.2345F) printf(" ");
+    return t / (10.0 * numbers.size()) * 1e9;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-n count] [-s seed] [file]...\n", name);
+    fprintf(stderr, "  -n  random numbers checked, default 1000000\n");
+    fprintf(stderr, "  -s  seed of the random numbers, default 1\n");
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    int count = 1000000;
+    unsigned int seed = 1;
+
+    int opt;
+    while((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch(opt) {
+            case 'n': count = atoi(optarg); break;
+            case 's': seed = strtoul(optarg, NULL, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    srand(seed);
+
+    // every position of every line, so letters, separators and comments are parsed too
+    long positions = 0;
+    for (int i = optind; i < argc; i++) {
+        FILE* fp = fopen(argv[i], "r");
+        if(fp == NULL) {
+            fprintf(stderr, "cannot read %s\n", argv[i]);
+            return 2;
+        }
+        char line[512];
+        while(fgets(line, sizeof(line), fp) != NULL) {
+            for (char* p = line; *p; p++) {
+                check_strtof(p);
+                check_strtofixed(p, 3);
+                positions++;
+            }
+        }
+        fclose(fp);
+    }
+
+    const char* edge_cases[] = {"", "-", "+", ".", "-.", "0", "-0", "-0.0", "+.5", "5.", "00012.3400", "1e3", "1E-2", "2.5e", "0x1A",
+                                "inf", "-nan", "16777216", "16777217", "0.1", "0.3", "1.0000001", "123456789", "1234567891",
+                                "0.00000000001", "0.000000000010", "99999.99999", "3.4028235e38", "1e-46", " \t7.25", "X10",
+                                "2147483.647", "2147483.6475", "-2147483.648", "-2147483.6485", "99999999999", "2.675", "-2.675"};
+    for (auto s : edge_cases) {
+        check_strtof(s);
+        for (int d = 0; d <= 6; d++) check_strtofixed(s, d);
+    }
+
+    // the plane M500 saves, the float bits of its coefficients, see ThreePointStrategy
+    check_gcode_int("M561 A3212836864 B1065353216 C4286578687 D2147483648", 'A', 3212836864UL);
+    check_gcode_int("M561 A3212836864 B1065353216 C4286578687 D2147483648", 'C', 4286578687UL);
+    check_gcode_int("M561 A3212836864 B1065353216 C4286578687 D2147483648", 'D', 2147483648UL);
+    check_gcode_int("M117 S-12 P7", 'S', (uint32_t)-12);
+    check_gcode_int("G1 X1.5 S16777217 Y2 F3000", 'S', 16777217, true);
+    check_gcode_int("G1 X1.5 S16777217 Y2 F3000", 'F', 3000, true);
+    check_gcode_int("G1 E1 X10 P2 Z-0.5 F123456789", 'F', 123456789, true);
+    check_gcode_int("G1 X1 F3000 Y2 E5 Z3 P42", 'E', 5, true);
+    check_gcode_int("G1 X1 F3000 Y2 E5 Z3 P42", 'P', 42, true);
+    check_gcode_strip("G1 X1.5 Y2 F3000", "   F3000");
+    check_gcode_strip("G1 X1Y2Z3 E5", "  E5");
+    check_gcode_strip("G2 E1 X10 I2 J-1 F600", " E1    F600");
+
+    std::vector<std::string> numbers;
+    for (int i = 0; i < count; i++) {
+        numbers.push_back(random_number());
+        check_strtof(numbers.back().c_str());
+        check_strtofixed(numbers.back().c_str(), rand() % 7);
+    }
+
+    printf("%ld positions of files, %d edge cases, gcode integers and %d random numbers checked, %d mismatches\n",
+           positions, (int)(sizeof(edge_cases) / sizeof(edge_cases[0])), count, mismatches);
+    if(!numbers.empty()) {
+        printf("strtof %.1f ns, decimal_strtof %.1f ns per number\n", time_parser(numbers, false), time_parser(numbers, true));
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,648 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// fixedtest: checks the integer math of src/libs/fixedpoint.h and of the planner against the float math it replaced,
+// on the host.
+//   fixedtest [-n count] [-r seed] [-b] [-c config [-s key=value]... [-p sequences]]
+// isqrt32 and isqrt64 must give the exact root, muldiv and muldiv_ceil the exact quotient, and Planner::move_length the
+// length and unit vector of a move to within the rounding of their units. For count random ramps quadratic_interpolate
+// must be within a step per second of the exact rate, and the steps of the ramp, timed the way the acceleration tick
+// changes the rate, must be within a step interval of where the float version put them.
+// With a config it also plans random sequences of moves with the Planner, and with a copy of the float planner it
+// replaced, and times the steps of both plans the same way: every step must be within a step interval of where the
+// float planner put it. With -b it times the versions of quadratic_interpolate instead, on this host, which has an FPU
+// and a 64 bit divide so it shows less of a difference than the LPC1768 would.
+
+#include "fixedpoint.h"
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/Config.h"
+#include "libs/StepTicker.h"
+#include "libs/StepperMotor.h"
+#include "modules/robot/Block.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/robot/Planner.h"
+#include "modules/robot/Robot.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+
+#include "system_LPC17xx.h"
+
+#include "Hal.h"
+#include "SimConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#define ACCELERATION_TICKS_PER_SECOND 1000
+#define MIN_STEP_RATE 100
+#define MAX_STEP_RATE 100000
+
+static int mismatches = 0;
+
+// The float version the acceleration tick used before
+static int float_quadratic_interpolate(float x, float x1, float v1, float x2, float v2)
+{
+    if (x <= x1)
+        return v1;
+    else if (x >= x2)
+        return v2;
+
+    float y1 = v1 * v1;
+    float y2 = v2 * v2;
+    float y = (y2 - y1) * (x - x1) / (x2 - x1) + y1;
+    return sqrtf(y);
+}
+
+// The Stepper works out the reciprocal once per ramp, here it is done every time
+static uint32_t fixed_interpolate(uint32_t x, uint32_t x1, uint32_t v1, uint32_t x2, uint32_t v2)
+{
+    return quadratic_interpolate(x, x1, v1, x2, v2, reciprocal(x2 - x1));
+}
+
+static void check_isqrt(uint64_t x)
+{
+    uint64_t root = isqrt64(x);
+    bool exact = root * root <= x && (root == UINT32_MAX || (root + 1) * (root + 1) > x);
+    if(x <= UINT32_MAX && isqrt32(x) != root) exact = false;
+    if(!exact && mismatches++ < 20) {
+        printf("isqrt of %llu is %llu\n", (unsigned long long)x, (unsigned long long)root);
+    }
+}
+
+static uint32_t random_rate()
+{
+    return MIN_STEP_RATE + rand() % (MAX_STEP_RATE - MIN_STEP_RATE);
+}
+
+// The time of every step of a ramp, with the rate set at each acceleration tick like Stepper::trapezoid_generator_tick
+// does, and never below min_rate
+template <typename interpolate_t>
+static std::vector<double> step_times(uint32_t steps, uint32_t v1, uint32_t v2, interpolate_t interpolate)
+{
+    std::vector<double> times;
+    double t = 0, tick_end = 0;
+    double made = 0;            // of the next step
+    while(times.size() < steps) {
+        tick_end += 1.0 / ACCELERATION_TICKS_PER_SECOND;
+        uint32_t rate = std::max((uint32_t)interpolate(times.size(), 0, v1, steps, v2), (uint32_t)MIN_STEP_RATE);
+        while(times.size() < steps) {
+            double next = t + (1.0 - made) / rate;
+            if(next > tick_end) {
+                made += (tick_end - t) * rate;
+                t = tick_end;
+                break;
+            }
+            times.push_back(next);
+            t = next;
+            made = 0;
+        }
+    }
+    return times;
+}
+
+static void check_ramp(uint32_t steps, uint32_t v1, uint32_t v2, double& max_rate_error, double& max_step_error)
+{
+    for (int i = 0; i < 8; i++) {
+        uint32_t x = rand() % (steps + 1);
+        long double exact = sqrtl((long double)v1 * v1 + ((long double)v2 * v2 - (long double)v1 * v1) * x / steps);
+        double error = fabsl(fixed_interpolate(x, 0, v1, steps, v2) - exact);
+        if(error > max_rate_error) max_rate_error = error;
+        if(error >= 1.0 && mismatches++ < 20) {
+            printf("quadratic_interpolate(%lu, 0, %lu, %lu, %lu) is %lu, exact %.3Lf\n", (unsigned long)x, (unsigned long)v1,
+                   (unsigned long)steps, (unsigned long)v2, (unsigned long)fixed_interpolate(x, 0, v1, steps, v2), exact);
+        }
+    }
+
+    // ramps that would take more than a second are not worth the time
+    if(steps > std::min(v1, v2)) return;
+    std::vector<double> fixed = step_times(steps, v1, v2, fixed_interpolate);
+    std::vector<double> reference = step_times(steps, v1, v2, [](uint32_t x, uint32_t x1, uint32_t v1, uint32_t x2, uint32_t v2) {
+        return (uint32_t)float_quadratic_interpolate(x, x1, v1, x2, v2);
+    });
+    for (size_t i = 1; i < fixed.size() && i < reference.size(); i++) {
+        double interval = reference[i] - reference[i - 1];
+        double error = fabs(fixed[i] - reference[i]) / interval;
+        if(error > max_step_error) max_step_error = error;
+        if(error >= 1.0 && mismatches++ < 20) {
+            printf("ramp of %lu steps from %lu to %lu steps/s: step %d at %.6f s, %.6f s with float math\n", (unsigned long)steps,
+                   (unsigned long)v1, (unsigned long)v2, (int)i, fixed[i], reference[i]);
+        }
+    }
+}
+
+// Nanoseconds per call of interpolate over the ramps, each given its reciprocal worked out beforehand like the
+// Stepper does
+template <typename interpolate_t>
+static double time_ramps(const std::vector<uint32_t>& ramps, const std::vector<reciprocal_t>& reciprocals, interpolate_t interpolate)
+{
+    const int rounds = 200;
+    uint32_t sum = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int n = 0; n < rounds; n++) {
+        for (size_t i = 0; i < ramps.size(); i += 4) {
+            sum += interpolate(ramps[i], 0, ramps[i + 2], ramps[i + 1], ramps[i + 3], reciprocals[i / 4]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if(sum == 1) printf(" ");  // keeps the calls from being optimized away
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / (rounds * (ramps.size() / 4));
+}
+
+static void bench(int count)
+{
+    // position, length, v1 and v2 of each ramp
+    std::vector<uint32_t> ramps;
+    std::vector<reciprocal_t> reciprocals;
+    for (int i = 0; i < count; i++) {
+        uint32_t steps = 1 + rand() % (rand() % 2 ? 1000 : 100000);
+        ramps.push_back(rand() % (steps + 1));
+        ramps.push_back(steps);
+        ramps.push_back(random_rate());
+        ramps.push_back(random_rate());
+        reciprocals.push_back(reciprocal(steps));
+    }
+
+    double none = time_ramps(ramps, reciprocals, [](uint32_t x, uint32_t x1, uint32_t v1, uint32_t x2, uint32_t v2, const reciprocal_t& r) {
+        return x + v1 + v2 + x2 + r.value;
+    });
+    double fixed = time_ramps(ramps, reciprocals, quadratic_interpolate);
+    double divided = time_ramps(ramps, reciprocals, [](uint32_t x, uint32_t x1, uint32_t v1, uint32_t x2, uint32_t v2, const reciprocal_t& r) {
+        return quadratic_interpolate(x, x1, v1, x2, v2, reciprocal(x2 - x1));
+    });
+    double floats = time_ramps(ramps, reciprocals, [](uint32_t x, uint32_t x1, uint32_t v1, uint32_t x2, uint32_t v2, const reciprocal_t& r) {
+        return (uint32_t)float_quadratic_interpolate(x, x1, v1, x2, v2);
+    });
+    printf("ns per call on this host, less %.1f ns of loop:\n", none);
+    printf("  quadratic_interpolate                        %6.1f\n", fixed - none);
+    printf("  quadratic_interpolate, reciprocal every call %6.1f\n", divided - none);
+    printf("  float version                                %6.1f\n", floats - none);
+}
+
+static void check_muldiv(uint64_t a, uint32_t b, uint64_t c)
+{
+    unsigned __int128 product = (unsigned __int128)a * b;
+    if(product > UINT64_MAX) return;    // saturates, see mul_saturate64()
+    unsigned __int128 floor = product / c;
+    unsigned __int128 ceil = floor + (product % c != 0);
+    uint32_t expected_floor = std::min(floor, (unsigned __int128)UINT32_MAX);
+    uint32_t expected_ceil = std::min(ceil, (unsigned __int128)UINT32_MAX);
+    if((muldiv(a, b, c) != expected_floor || muldiv_ceil(a, b, c) != expected_ceil) && mismatches++ < 20) {
+        printf("muldiv(%llu, %lu, %llu) is %lu and %lu rounded up, exact %lu and %lu\n", (unsigned long long)a, (unsigned long)b,
+               (unsigned long long)c, (unsigned long)muldiv(a, b, c), (unsigned long)muldiv_ceil(a, b, c),
+               (unsigned long)expected_floor, (unsigned long)expected_ceil);
+    }
+}
+
+static float random_mm(float largest)
+{
+    return largest * ((float)rand() / RAND_MAX * 2.0F - 1.0F);
+}
+
+// The length must be within a unit and 2^-28 of itself from the exact one, the unit vector within 4 units
+static void check_move_length(const float deltas[3])
+{
+    int32_t unit_vec[3];
+    uint32_t length = Planner::move_length(deltas, unit_vec);
+    double exact = sqrt((double)deltas[0] * deltas[0] + (double)deltas[1] * deltas[1] + (double)deltas[2] * deltas[2]);
+    bool close = fabs(length - exact * MM_ONE) <= 1.0 + exact * MM_ONE / (1 << 28);
+    for (int i = 0; i < 3; i++) {
+        if(fabs(unit_vec[i] - deltas[i] / exact * (1 << UNIT_VECTOR_SHIFT)) > 4.0) close = false;
+    }
+    if(!close && mismatches++ < 20) {
+        printf("move_length of %g %g %g is %.9f, exact %.9f, unit vector %.9f %.9f %.9f\n", deltas[0], deltas[1], deltas[2],
+               (double)length / MM_ONE, exact, (double)unit_vec[0] / (1 << UNIT_VECTOR_SHIFT), (double)unit_vec[1] / (1 << UNIT_VECTOR_SHIFT),
+               (double)unit_vec[2] / (1 << UNIT_VECTOR_SHIFT));
+    }
+}
+
+#define acceleration_checksum          CHECKSUM("acceleration")
+#define z_acceleration_checksum        CHECKSUM("z_acceleration")
+#define junction_deviation_checksum    CHECKSUM("junction_deviation")
+#define z_junction_deviation_checksum  CHECKSUM("z_junction_deviation")
+#define minimum_planner_speed_checksum CHECKSUM("minimum_planner_speed")
+#define planner_queue_size_checksum    CHECKSUM("planner_queue_size")
+
+class SimIdle : public Module {
+    public:
+        void on_module_loaded() { register_for_event(ON_IDLE); }
+        void on_idle(void* argument) { sim_run(SystemCoreClock / 10000); }
+};
+
+// What the Stepper follows of a block, see Stepper::trapezoid_generator_tick()
+struct plan_t {
+    uint32_t steps, initial_rate, final_rate, max_rate, nominal_rate, accelerate_until, decelerate_after, rate_delta;
+};
+
+// The plans of the blocks as they begin, when the planner can not change them anymore
+class PlanRecorder : public Module {
+    public:
+        void on_module_loaded() { register_for_event(ON_BLOCK_BEGIN); }
+        void on_block_begin(void* argument) {
+            Block* block = static_cast<Block*>(argument);
+            plans.push_back({block->steps_event_count, block->initial_rate, block->final_rate, block->max_rate, block->nominal_rate,
+                             block->accelerate_until, block->decelerate_after, block->rate_delta});
+        }
+        std::vector<plan_t> plans;
+};
+
+// The float planner Planner::append_block(), Planner::recalculate() and the Block passes were, without S-curves
+struct float_block_t {
+    unsigned int steps_event_count, nominal_rate, initial_rate, final_rate, max_rate, accelerate_until, decelerate_after;
+    float nominal_speed, millimeters, entry_speed, exit_speed, rate_delta, acceleration, max_entry_speed;
+    bool recalculate_flag, nominal_length_flag;
+
+    float estimate_acceleration_distance(float initialrate, float targetrate, float acceleration)
+    {
+        return( ((targetrate * targetrate) - (initialrate * initialrate)) / (2.0F * acceleration));
+    }
+
+    float intersection_distance(float initialrate, float finalrate, float acceleration, float distance)
+    {
+        return((2 * acceleration * distance - initialrate * initialrate + finalrate * finalrate) / (4 * acceleration));
+    }
+
+    float max_allowable_speed(float acceleration, float target_velocity, float distance)
+    {
+        return sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance);
+    }
+
+    void calculate_trapezoid(float entryspeed, float exitspeed)
+    {
+        float nominal_rate = (float)this->nominal_rate / STEP_RATE_ONE;
+        float initial_rate = std::min(nominal_rate * entryspeed / this->nominal_speed, nominal_rate);
+        float final_rate   = std::min(nominal_rate * exitspeed  / this->nominal_speed, nominal_rate);
+        this->initial_rate = initial_rate * STEP_RATE_ONE;
+        this->final_rate   = final_rate * STEP_RATE_ONE;
+
+        float acceleration_per_second = this->rate_delta * THEKERNEL->acceleration_ticks_per_second;
+        int accelerate_steps = ceilf( this->estimate_acceleration_distance( initial_rate, nominal_rate, acceleration_per_second ) );
+        int decelerate_steps = floorf( this->estimate_acceleration_distance( nominal_rate, final_rate,  -acceleration_per_second ) );
+        int plateau_steps = this->steps_event_count - accelerate_steps - decelerate_steps;
+        if (plateau_steps < 0) {
+            accelerate_steps = ceilf(this->intersection_distance(initial_rate, final_rate, acceleration_per_second, this->steps_event_count));
+            accelerate_steps = std::max( accelerate_steps, 0 );
+            accelerate_steps = std::min( accelerate_steps, int(this->steps_event_count) );
+            max_rate = this->max_allowable_speed(-acceleration_per_second, final_rate, this->steps_event_count - this->decelerate_after) * STEP_RATE_ONE;
+            plateau_steps = 0;
+        } else {
+            max_rate = this->nominal_rate;
+        }
+        this->accelerate_until = accelerate_steps;
+        this->decelerate_after = accelerate_steps + plateau_steps;
+        this->exit_speed = exitspeed;
+    }
+
+    float reverse_pass(float exit_speed)
+    {
+        if (this->entry_speed != this->max_entry_speed) {
+            if ((!this->nominal_length_flag) && (this->max_entry_speed > exit_speed)) {
+                float max_entry_speed = max_allowable_speed(-this->acceleration, exit_speed, this->millimeters);
+                this->entry_speed = std::min(max_entry_speed, this->max_entry_speed);
+                return this->entry_speed;
+            }
+            else
+                this->entry_speed = this->max_entry_speed;
+        }
+        return this->entry_speed;
+    }
+
+    float forward_pass(float prev_max_exit_speed)
+    {
+        if (prev_max_exit_speed > nominal_speed)
+            prev_max_exit_speed = nominal_speed;
+        if (prev_max_exit_speed > max_entry_speed)
+            prev_max_exit_speed = max_entry_speed;
+        if (prev_max_exit_speed <= entry_speed) {
+            entry_speed = prev_max_exit_speed;
+            recalculate_flag = false;
+        }
+        return max_exit_speed();
+    }
+
+    float max_exit_speed()
+    {
+        if (nominal_length_flag)
+            return nominal_speed;
+        return std::min(max_allowable_speed(-this->acceleration, this->entry_speed, this->millimeters), nominal_speed);
+    }
+};
+
+struct float_planner_t {
+    float acceleration, z_acceleration, junction_deviation, z_junction_deviation, minimum_planner_speed;
+    float previous_unit_vec[3];
+    std::vector<float_block_t> blocks;      // of the sequence, the queue is empty before it
+
+    void append_block(const int steps[3], float rate_mm_s, float distance, const float unit_vec[3])
+    {
+        float_block_t block = {};
+        block.decelerate_after = 0;
+        float acceleration = this->acceleration, junction_deviation = this->junction_deviation;
+        if (steps[0] == 0 && steps[1] == 0) {
+            if (this->z_acceleration > 0.0F) acceleration = this->z_acceleration;
+            if (this->z_junction_deviation >= 0.0F) junction_deviation = this->z_junction_deviation;
+        }
+        block.acceleration = acceleration;
+        block.steps_event_count = std::max(abs(steps[0]), std::max(abs(steps[1]), abs(steps[2])));
+        block.millimeters = distance;
+        block.nominal_speed = rate_mm_s;
+        block.nominal_rate = ceilf(block.steps_event_count * rate_mm_s * STEP_RATE_ONE / distance);
+
+        uint32_t max_step_rate = THEKERNEL->step_ticker->get_max_step_rate() * STEP_RATE_ONE;
+        if (block.nominal_rate > max_step_rate) {
+            block.nominal_speed *= (float)max_step_rate / block.nominal_rate;
+            block.nominal_rate = max_step_rate;
+        }
+        block.rate_delta = (block.steps_event_count * acceleration) / (distance * THEKERNEL->acceleration_ticks_per_second);
+
+        float vmax_junction = minimum_planner_speed;
+        if (!blocks.empty()) {
+            float previous_nominal_speed = blocks.back().nominal_speed;
+            if (previous_nominal_speed > 0.0F && junction_deviation > 0.0F) {
+                float cos_theta = - this->previous_unit_vec[0] * unit_vec[0]
+                                    - this->previous_unit_vec[1] * unit_vec[1]
+                                    - this->previous_unit_vec[2] * unit_vec[2] ;
+                if (cos_theta < 0.95F) {
+                    vmax_junction = std::min(previous_nominal_speed, block.nominal_speed);
+                    if (cos_theta > -0.95F) {
+                        float sin_theta_d2 = sqrtf(0.5F * (1.0F - cos_theta));
+                        vmax_junction = std::min(vmax_junction, sqrtf(acceleration * junction_deviation * sin_theta_d2 / (1.0F - sin_theta_d2)));
+                    }
+                }
+            }
+        }
+        block.max_entry_speed = vmax_junction;
+        float v_allowable = block.max_allowable_speed(-block.acceleration, minimum_planner_speed, block.millimeters);
+        block.entry_speed = std::min(vmax_junction, v_allowable);
+        block.nominal_length_flag = (block.nominal_speed <= v_allowable);
+        block.recalculate_flag = true;
+        memcpy(this->previous_unit_vec, unit_vec, sizeof(previous_unit_vec));
+
+        blocks.push_back(block);
+        recalculate();
+    }
+
+    // the newest block is the head and the first one of the sequence the tail, like in Planner::recalculate()
+    void recalculate()
+    {
+        int head = blocks.size() - 1;
+        int i = head;
+        float entry_speed = minimum_planner_speed;
+        if (head > 0) {
+            while (i != 0 && blocks[i].recalculate_flag) {
+                entry_speed = blocks[i].reverse_pass(entry_speed);
+                i--;
+            }
+            float exit_speed = blocks[i].max_exit_speed();
+            while (i != head) {
+                i++;
+                exit_speed = blocks[i].forward_pass(exit_speed);
+                blocks[i - 1].calculate_trapezoid(blocks[i - 1].entry_speed, blocks[i].entry_speed);
+            }
+        }
+        blocks[head].calculate_trapezoid(blocks[head].entry_speed, minimum_planner_speed);
+    }
+};
+
+// The rate of a plan halfway through step pos, in steps per second: the square of the rate changes linearly along the
+// ramps, and it is never below half a tick of acceleration, like Stepper::trapezoid_generator_tick() has it
+static double plan_rate(const plan_t& p, uint32_t pos)
+{
+    double x = pos + 0.5;
+    double rate;
+    if (x < p.accelerate_until) {
+        double v1 = std::max(p.initial_rate, p.rate_delta / 2), v2 = p.max_rate;
+        rate = sqrt(v1 * v1 + (v2 * v2 - v1 * v1) * x / p.accelerate_until);
+    } else if (x > p.decelerate_after) {
+        double v1 = p.max_rate, v2 = std::max(p.final_rate, p.rate_delta / 2);
+        rate = sqrt(v1 * v1 + (v2 * v2 - v1 * v1) * (x - p.decelerate_after) / (p.steps - p.decelerate_after));
+    } else {
+        rate = p.nominal_rate;
+    }
+    return std::max(rate, (double)(p.rate_delta / 2)) / STEP_RATE_ONE;
+}
+
+// The time of every step of the main stepper of the blocks, one after the other. The steps are timed from the rates
+// of the plans at each step, not through the acceleration ticks: the tick samples the rate at the step it falls on, so
+// a rate that is 1/256 step per second off can move a step of a short block by a large part of a tick, which would hide
+// the differences of the planners behind those of where the ticks fall.
+static std::vector<double> plan_step_times(const std::vector<plan_t>& plans)
+{
+    std::vector<double> times;
+    double t = 0;
+    for (const plan_t& p : plans) {
+        for (uint32_t pos = 0; pos < p.steps; pos++) {
+            t += 1.0 / plan_rate(p, pos);
+            times.push_back(t);
+        }
+    }
+    return times;
+}
+
+// Plans random sequences of moves with the Planner and with the float planner, and compares the times of their steps.
+// The sequences are shorter than the queue, so every block is planned with the whole sequence before the first one
+// begins, and they end at rest for the next sequence. The steps of each block are timed from its first one, and may be
+// up to two step intervals apart: both planners round where the ramps end to whole steps, and a short block that is
+// planned again takes its peak rate from where the last plan decelerated, so a rate a little off can move a ramp end by
+// a step, and the steps after it by an interval. The float planner is as far from itself computed in doubles.
+static void check_planner(int sequences, double& max_step_error, double& max_end_error)
+{
+    float_planner_t reference;
+    reference.acceleration = THEKERNEL->config->value(acceleration_checksum)->by_default(100.0F )->as_number();
+    reference.z_acceleration = THEKERNEL->config->value(z_acceleration_checksum)->by_default(0.0F )->as_number();
+    reference.junction_deviation = THEKERNEL->config->value(junction_deviation_checksum)->by_default(0.05F)->as_number();
+    reference.z_junction_deviation = THEKERNEL->config->value(z_junction_deviation_checksum)->by_default(-1)->as_number();
+    reference.minimum_planner_speed = THEKERNEL->config->value(minimum_planner_speed_checksum)->by_default(0.0f)->as_number();
+    int queue_size = THEKERNEL->config->value(planner_queue_size_checksum)->by_default(32)->as_number();
+
+    PlanRecorder* recorder = new PlanRecorder();
+    THEKERNEL->add_module(recorder, "PlanRecorder");
+    std::vector<StepperMotor*>& actuators = THEKERNEL->robot->actuators;
+    float position[3] = {0, 0, 0};
+
+    for (int n = 0; n < sequences; n++) {
+        reference.blocks.clear();
+        recorder->plans.clear();
+
+        // short and long moves in the plane, at times with the z axis, or alone on it
+        int moves = 1 + rand() % (queue_size - 2);
+        float largest = (rand() % 2) ? 1.0F : 20.0F;
+        for (int m = 0; m < moves; m++) {
+            float target[3], deltas[3];
+            do {
+                int kind = rand() % 8;
+                deltas[0] = (kind == 0) ? 0.0F : random_mm(largest);
+                deltas[1] = (kind == 0) ? 0.0F : random_mm(largest);
+                deltas[2] = (kind <= 1) ? random_mm(1.0F) : 0.0F;
+            } while(fabsf(deltas[0]) + fabsf(deltas[1]) + fabsf(deltas[2]) < 0.05F);
+            float rate_mm_s = 1.0F + rand() % 300;
+
+            int steps[3];
+            for (int i = 0; i < 3; i++) {
+                target[i] = position[i] + deltas[i];
+                steps[i] = actuators[i]->steps_to_target(target[i]);
+            }
+
+            float distance = sqrtf(powf(deltas[0], 2) + powf(deltas[1], 2) + powf(deltas[2], 2));
+            float float_unit_vec[3];
+            for (int i = 0; i < 3; i++) float_unit_vec[i] = deltas[i] / distance;
+            reference.append_block(steps, rate_mm_s, distance, float_unit_vec);
+
+            int32_t unit_vec[3];
+            uint32_t length = Planner::move_length(deltas, unit_vec);
+            uint32_t rate = mm_to_fixed(rate_mm_s);
+            THEKERNEL->planner->append_block(target, rate, length, unit_vec, UINT32_MAX, false);
+            memcpy(position, target, sizeof(position));
+        }
+        THEKERNEL->conveyor->wait_for_empty_queue();
+
+        std::vector<plan_t> float_plans;
+        for (float_block_t& b : reference.blocks) {
+            float_plans.push_back({b.steps_event_count, b.initial_rate, b.final_rate, b.max_rate, b.nominal_rate,
+                                   b.accelerate_until, b.decelerate_after, (uint32_t)(b.rate_delta * STEP_RATE_ONE)});
+        }
+        std::vector<double> fixed = plan_step_times(recorder->plans);
+        std::vector<double> floats = plan_step_times(float_plans);
+        if(fixed.size() != floats.size()) {
+            if(mismatches++ < 20) printf("sequence %d: %d steps planned, %d by the float planner\n", n, (int)fixed.size(), (int)floats.size());
+            continue;
+        }
+        size_t block_end = 0, block = 0;
+        double fixed_start = 0, float_start = 0;
+        for (size_t i = 0; i < fixed.size(); i++) {
+            if(i == block_end) {
+                fixed_start = (i > 0) ? fixed[i - 1] : 0.0;
+                float_start = (i > 0) ? floats[i - 1] : 0.0;
+                block_end += float_plans[block++].steps;
+            }
+            double interval = floats[i] - (i > 0 ? floats[i - 1] : 0.0);
+            double error = fabs((fixed[i] - fixed_start) - (floats[i] - float_start)) / interval;
+            if(error > max_step_error) max_step_error = error;
+            if(error >= 2.0 && mismatches++ < 20) {
+                printf("sequence %d of %d moves: step %d at %.6f s, %.6f s with the float planner\n", n, moves, (int)i, fixed[i], floats[i]);
+            }
+        }
+        if(!fixed.empty()) max_end_error = std::max(max_end_error, fabs(fixed.back() - floats.back()) / floats.back());
+    }
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-n count] [-r seed] [-b] [-c config [-s key=value]... [-p sequences]]\n", name);
+    fprintf(stderr, "  -n  random ramps, numbers and moves checked, default 20000\n");
+    fprintf(stderr, "  -r  seed of the random numbers, default 1\n");
+    fprintf(stderr, "  -b  time quadratic_interpolate against the float version instead of checking it\n");
+    fprintf(stderr, "  -c  machine config file, the planner is checked against the float one with it\n");
+    fprintf(stderr, "  -s  set or override a config value, e.g. acceleration=500\n");
+    fprintf(stderr, "  -p  random sequences of moves planned, default 500\n");
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    int count = 20000;
+    int sequences = 500;
+    unsigned int seed = 1;
+    bool timing = false;
+    const char* config_file = NULL;
+    std::vector<std::pair<std::string, std::string>> overrides;
+
+    int opt;
+    while((opt = getopt(argc, argv, "n:r:bc:s:p:")) != -1) {
+        switch(opt) {
+            case 'n': count = atoi(optarg); break;
+            case 'r': seed = strtoul(optarg, NULL, 10); break;
+            case 'b': timing = true; break;
+            case 'c': config_file = optarg; break;
+            case 'p': sequences = atoi(optarg); break;
+            case 's': {
+                const char* eq = strchr(optarg, '=');
+                if(eq == NULL) usage(argv[0]);
+                overrides.push_back(std::make_pair(std::string(optarg, eq - optarg), std::string(eq + 1)));
+                break;
+            }
+            default: usage(argv[0]);
+        }
+    }
+    if(optind != argc || (config_file == NULL && !overrides.empty())) usage(argv[0]);
+    srand(seed);
+    if(timing) {
+        bench(count);
+        return 0;
+    }
+
+    // every square and its neighbours up to 2^20, the largest ones and random ones
+    for (uint64_t r = 0; r <= (1 << 20); r++) {
+        check_isqrt(r * r);
+        check_isqrt(r * r + 1);
+        if(r > 0) check_isqrt(r * r - 1);
+    }
+    for (uint64_t x = UINT64_MAX; x > UINT64_MAX - 1000; x--) check_isqrt(x);
+    for (uint64_t x = UINT32_MAX - 1000; x < (uint64_t)UINT32_MAX + 1000; x++) check_isqrt(x);
+    for (int i = 0; i < count; i++) check_isqrt(((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand());
+
+    // accelerating and decelerating ramps, short and long
+    double max_rate_error = 0, max_step_error = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t steps = 1 + rand() % (rand() % 2 ? 1000 : 100000);
+        check_ramp(steps, random_rate(), random_rate(), max_rate_error, max_step_error);
+    }
+
+    // products that fit in 64 bits and quotients that do not fit in 32, with divisors of every size
+    for (int i = 0; i < count; i++) {
+        uint64_t a = (((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand()) >> (rand() % 64);
+        uint32_t b = ((uint32_t)rand() << 1 ^ rand()) >> (rand() % 32);
+        uint64_t c = (((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand()) >> (rand() % 64);
+        check_muldiv(a, b, c | 1);
+    }
+
+    // moves along the axes and in any direction, from a fraction of the unit to the longest ones
+    for (int i = 0; i < count; i++) {
+        float largest = powf(2.0F, rand() % 32 - 16);
+        float deltas[3] = {random_mm(largest), random_mm(largest), random_mm(largest)};
+        if(rand() % 4 == 0) deltas[rand() % 3] = 0.0F;
+        if(rand() % 8 == 0) deltas[rand() % 3] = 0.0F;
+        check_move_length(deltas);
+    }
+
+    printf("isqrt, muldiv, move_length and %d random ramps checked, %d mismatches\n", count, mismatches);
+    printf("rate at most %.3f steps/s from exact, steps at most %.3f step intervals from the float version\n",
+           max_rate_error, max_step_error);
+
+    if(config_file != NULL) {
+        if(!sim_config_load(config_file)) {
+            fprintf(stderr, "cannot read config file %s\n", config_file);
+            return 2;
+        }
+        for (auto &o : overrides) {
+            sim_config_set(o.first, o.second);
+        }
+
+        Kernel* kernel = new Kernel();
+        kernel->add_module( new SimIdle(), "SimIdle" );
+        kernel->step_ticker->start();
+
+        int before = mismatches;
+        double max_plan_error = 0, max_end_error = 0;
+        check_planner(sequences, max_plan_error, max_end_error);
+        kernel->config->config_cache_clear();
+        printf("%d random sequences of moves planned, %d mismatches\n", sequences, mismatches - before);
+        printf("steps at most %.3f step intervals from the float planner, sequences end at most %.6f%% apart\n",
+               max_plan_error, max_end_error * 100);
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// smoothiesim: runs a G-code file through the motion modules on simulated hardware and records the step timeline.
+// Lines are fed like the Player does, one per main loop, and simulated time passes whenever the firmware idles.
+// Feed holds can be pressed and released at given times, like the pause button would.
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/Config.h"
+#include "libs/SerialMessage.h"
+#include "libs/StreamOutput.h"
+#include "libs/StreamOutputPool.h"
+#include "libs/StepTicker.h"
+#include "libs/Pin.h"
+#include "libs/IsrProfiler.h"
+#include "libs/EventProfiler.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/robot/Pauser.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+
+#include "system_LPC17xx.h"
+
+#include "Hal.h"
+#include "SimConfig.h"
+#include "StepTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#define alpha_step_pin_checksum              CHECKSUM("alpha_step_pin")
+#define beta_step_pin_checksum               CHECKSUM("beta_step_pin")
+#define gamma_step_pin_checksum              CHECKSUM("gamma_step_pin")
+#define alpha_dir_pin_checksum               CHECKSUM("alpha_dir_pin")
+#define beta_dir_pin_checksum                CHECKSUM("beta_dir_pin")
+#define gamma_dir_pin_checksum               CHECKSUM("gamma_dir_pin")
+
+// Time passes while the firmware is idle, and the feed holds begin and end when their time has come
+class SimIdle : public Module {
+    public:
+        SimIdle(uint64_t cycles, const std::vector<std::pair<uint64_t, uint64_t>>& holds) : cycles(cycles), holds(holds), held(false) {}
+        void on_module_loaded() { register_for_event(ON_IDLE); }
+        void on_idle(void* argument)
+        {
+            sim_run(cycles);
+            if(holds.empty()) return;
+            if(!held && sim_time() >= holds.front().first) {
+                held = true;
+                THEKERNEL->pauser->take();
+            }
+            if(held && sim_time() >= holds.front().second) {
+                held = false;
+                holds.erase(holds.begin());
+                THEKERNEL->pauser->release();
+            }
+        }
+
+    private:
+        uint64_t cycles;
+        std::vector<std::pair<uint64_t, uint64_t>> holds;  // begin and end, in core clock cycles
+        bool held;
+};
+
+static StepTraceWriter trace;
+
+static void record_gpio(int port, uint32_t before, uint32_t after)
+{
+    trace.on_gpio_change(port, before, after, sim_time());
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s -c config [-s key=value]... [-i idle_us] [-l isr_us] [-p start_ms:end_ms]... [-o trace] [-w swo] file.gcode\n", name);
+    fprintf(stderr, "  -c  machine config file\n");
+    fprintf(stderr, "  -s  set or override a config value\n");
+    fprintf(stderr, "  -i  simulated microseconds that pass each time the firmware idles, default 100\n");
+    fprintf(stderr, "  -l  simulated microseconds the step tick interrupt takes, the interrupts that fall due meanwhile wait for it\n");
+    fprintf(stderr, "  -p  hold the feed from start_ms to end_ms of simulated time\n");
+    fprintf(stderr, "  -o  write the step/direction timeline to this file\n");
+    fprintf(stderr, "  -w  write the ITM motion trace to this file, as a probe would capture it from the SWO pin\n");
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    const char* config_file = NULL;
+    const char* trace_file = NULL;
+    const char* swo_file = NULL;
+    float idle_us = 100;
+    float isr_us = 0;
+    std::vector<std::pair<std::string, std::string>> overrides;
+    std::vector<std::pair<uint64_t, uint64_t>> holds;
+
+    int opt;
+    while((opt = getopt(argc, argv, "c:s:i:l:p:o:w:")) != -1) {
+        switch(opt) {
+            case 'c': config_file = optarg; break;
+            case 'i': idle_us = atof(optarg); break;
+            case 'l': isr_us = atof(optarg); break;
+            case 'p': {
+                float start_ms, end_ms;
+                if(sscanf(optarg, "%f:%f", &start_ms, &end_ms) != 2 || end_ms < start_ms) usage(argv[0]);
+                uint64_t cycles_per_ms = SystemCoreClock / 1000;
+                holds.push_back(std::make_pair((uint64_t)(start_ms * cycles_per_ms), (uint64_t)(end_ms * cycles_per_ms)));
+                break;
+            }
+            case 'o': trace_file = optarg; break;
+            case 'w': swo_file = optarg; break;
+            case 's': {
+                const char* eq = strchr(optarg, '=');
+                if(eq == NULL) usage(argv[0]);
+                overrides.push_back(std::make_pair(std::string(optarg, eq - optarg), std::string(eq + 1)));
+                break;
+            }
+            default: usage(argv[0]);
+        }
+    }
+    if(config_file == NULL || optind != argc - 1) usage(argv[0]);
+
+    if(!sim_config_load(config_file)) {
+        fprintf(stderr, "cannot read config file %s\n", config_file);
+        return 2;
+    }
+    for (auto &o : overrides) {
+        sim_config_set(o.first, o.second);
+    }
+    FILE* gcode_file = fopen(argv[optind], "r");
+    if(gcode_file == NULL) {
+        fprintf(stderr, "cannot read %s\n", argv[optind]);
+        return 2;
+    }
+
+    FILE* swo = NULL;
+    if(swo_file != NULL) {
+        swo = fopen(swo_file, "wb");
+        if(swo == NULL) {
+            fprintf(stderr, "cannot write %s\n", swo_file);
+            return 2;
+        }
+        sim_set_swo_file(swo);
+    }
+
+    Kernel* kernel = new Kernel();
+    std::sort(holds.begin(), holds.end());
+    kernel->add_module( new SimIdle(idle_us * (SystemCoreClock / 1000000.0F), holds), "SimIdle" );
+
+    // the actuators are recorded from their pins, like a logic analyzer would
+    uint16_t step_pins[3] = {alpha_step_pin_checksum, beta_step_pin_checksum, gamma_step_pin_checksum};
+    uint16_t dir_pins[3] = {alpha_dir_pin_checksum, beta_dir_pin_checksum, gamma_dir_pin_checksum};
+    for (int i = 0; i < 3; i++) {
+        Pin step, dir;
+        step.from_string(kernel->config->value(step_pins[i])->by_default("nc")->as_string());
+        dir.from_string(kernel->config->value(dir_pins[i])->by_default("nc")->as_string());
+        trace.add_actuator(step.port_number, step.pin, step.inverting, dir.port_number, dir.pin, dir.inverting);
+    }
+    if(trace_file != NULL && !trace.open(trace_file, SystemCoreClock)) {
+        fprintf(stderr, "cannot write %s\n", trace_file);
+        return 2;
+    }
+    sim_set_gpio_hook(record_gpio);
+    sim_set_handler_cycles(TIMER0_IRQn, isr_us * (SystemCoreClock / 1000000.0F));
+
+    kernel->config->config_cache_clear();
+    kernel->step_ticker->start();
+
+    char buf[256];
+    while(fgets(buf, sizeof buf, gcode_file) != NULL) {
+        struct SerialMessage message;
+        message.message = buf;
+        message.stream = &(StreamOutput::NullStream);
+        kernel->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+        kernel->call_event(ON_MAIN_LOOP);
+        kernel->call_event(ON_IDLE);
+    }
+    fclose(gcode_file);
+
+    // run until the last block has been stepped out, then let the last step pulse end
+    // the main loop runs again, it queues the line that may have been held back for merging
+    kernel->call_event(ON_MAIN_LOOP);
+    while(!kernel->conveyor->is_queue_empty()) {
+        kernel->conveyor->wait_for_empty_queue();
+        kernel->call_event(ON_MAIN_LOOP);
+    }
+    sim_run(SystemCoreClock / 1000);
+
+    trace.close();
+    if(swo != NULL) {
+        sim_set_swo_file(NULL);
+        fclose(swo);
+    }
+    printf("%u steps in %.6f seconds of simulated time\n", trace.get_steps(), (double)sim_time() / SystemCoreClock);
+    if(IsrProfiler::is_enabled()) IsrProfiler::dump_and_reset(kernel->streams);
+#ifdef EVENT_PROFILER
+    if(EventProfiler::enabled) EventProfiler::dump_and_reset(kernel->streams, 10);
+#endif
+    return 0;
+}
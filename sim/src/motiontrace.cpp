@@ -0,0 +1,266 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// motiontrace: decodes the motion trace the firmware writes to the ITM stimulus ports, see src/libs/MotionTrace.h
+//   motiontrace [-f clock_mhz] [-a acceleration_ticks_per_second] [-c profile.csv] capture.swo
+// The capture is the raw SWO byte stream, as saved by a probe or by smoothiesim -w. The trace is cut into the acceleration
+// ticks by its time records, the velocity of each actuator is the steps it made in a tick. A tick that was cut short when
+// the acceleration tick was synchronized to a step is merged into the next one. Reported are the blocks, the steps
+// of each actuator, ticks where a moving actuator made no step although its rate asks for some (stutters) and the time the
+// step ticker had no block to execute between two blocks (planner starvation).
+
+#include "MotionTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+
+#define MAX_ACTUATORS (1 << (32 - MOTION_TRACE_ACTUATOR_SHIFT))
+
+// a tick is a stutter when the rate of a moving actuator asks for at least this many steps in it, but there were none
+#define STUTTER_MIN_STEPS 2.0
+
+struct actuator_t {
+    bool seen;
+    bool direction;             // true is negative
+    bool moving;                // between a move and its finish
+    uint32_t rate;              // steps per second
+    uint32_t tick_steps;        // steps made in the current tick
+    int64_t position;
+    uint64_t steps;
+    uint32_t moves;
+    double peak_velocity;       // steps per second
+    uint32_t stutters;
+};
+
+struct decoder_t {
+    double clock;               // cycles per second
+    uint32_t min_tick;          // cycles
+    FILE* csv;
+
+    actuator_t actuators[MAX_ACTUATORS];
+    int num_actuators;
+
+    bool have_time;
+    uint32_t last_cycles;
+    uint64_t time;              // cycles since the first time record
+    uint64_t ticks;
+
+    uint32_t block;             // the block being executed, 0 if none
+    uint32_t blocks;
+    bool starving;              // a block ended and the next has not begun yet
+    uint64_t starved_since;
+    uint64_t starved_time;
+    uint32_t starvations;
+
+    uint32_t overflows;
+    uint32_t dropped;           // records the firmware could not write, the FIFO was full
+    uint32_t bad_bytes;
+    uint32_t unknown_records;
+};
+
+static actuator_t& actuator(decoder_t& d, int index)
+{
+    actuator_t &a = d.actuators[index];
+    if(!a.seen) {
+        a.seen = true;
+        d.num_actuators = std::max(d.num_actuators, index + 1);
+    }
+    return a;
+}
+
+// A time record ends the current tick
+static void end_tick(decoder_t& d, uint32_t cycles)
+{
+    if(!d.have_time) {
+        d.have_time = true;
+        d.last_cycles = cycles;
+        for (int i = 0; i < MAX_ACTUATORS; i++) d.actuators[i].tick_steps = 0;
+        return;
+    }
+
+    uint32_t dt = cycles - d.last_cycles;
+    if(dt < d.min_tick) return;
+    d.last_cycles = cycles;
+    double seconds = dt / d.clock;
+
+    if(d.csv != NULL) fprintf(d.csv, "%.6f,%u", d.time / d.clock, d.block);
+    for (int i = 0; i < d.num_actuators; i++) {
+        actuator_t &a = d.actuators[i];
+        double velocity = a.tick_steps / seconds;
+        a.peak_velocity = std::max(a.peak_velocity, velocity);
+        if(a.moving && a.tick_steps == 0 && a.rate * seconds >= STUTTER_MIN_STEPS) a.stutters++;
+        if(d.csv != NULL) fprintf(d.csv, ",%u,%.1f", a.moving ? a.rate : 0, a.direction ? -velocity : velocity);
+        a.tick_steps = 0;
+    }
+    if(d.csv != NULL) fprintf(d.csv, "\n");
+
+    d.time += dt;
+    d.ticks++;
+}
+
+static void record(decoder_t& d, int port, uint32_t value)
+{
+    int index = value >> MOTION_TRACE_ACTUATOR_SHIFT;
+    uint32_t v = value & MOTION_TRACE_VALUE_MASK;
+
+    switch(port) {
+        case MOTION_TRACE_STEP: {
+            actuator_t &a = actuator(d, value & 0xFF);
+            a.steps++;
+            a.tick_steps++;
+            a.position += a.direction ? -1 : 1;
+            break;
+        }
+        case MOTION_TRACE_MOVE: {
+            actuator_t &a = actuator(d, index);
+            a.direction = (v & MOTION_TRACE_DIRECTION_BIT) != 0;
+            a.moving = (v & ~MOTION_TRACE_DIRECTION_BIT) != 0;
+            a.moves++;
+            break;
+        }
+        case MOTION_TRACE_RATE:
+            actuator(d, index).rate = v;
+            break;
+        case MOTION_TRACE_FINISHED:
+            actuator(d, value & 0xFF).moving = false;
+            break;
+        case MOTION_TRACE_BLOCK:
+            if(d.starving) {
+                d.starving = false;
+                // less than a tick between two blocks is just the time it takes to start the next one
+                if(d.time - d.starved_since > 0) {
+                    d.starvations++;
+                    d.starved_time += d.time - d.starved_since;
+                }
+            }
+            d.block = value;
+            d.blocks++;
+            break;
+        case MOTION_TRACE_BLOCK_END:
+            d.block = 0;
+            d.starving = true;
+            d.starved_since = d.time;
+            break;
+        case MOTION_TRACE_TIME:
+            end_tick(d, value);
+            break;
+        case MOTION_TRACE_DROPPED:
+            d.dropped = value;
+            break;
+        default:
+            // port 0 is used for text
+            if(port != 0) d.unknown_records++;
+    }
+}
+
+// Reads the ITM packets of the SWO stream, see the ARMv7-M architecture reference manual, appendix D4
+static void decode(decoder_t& d, FILE* fp)
+{
+    int c;
+    while((c = getc(fp)) != EOF) {
+        if(c == 0x00) {
+            // synchronization, zeros ended by 0x80
+            while((c = getc(fp)) == 0x00) ;
+            if(c != 0x80 && c != EOF) d.bad_bytes++;
+
+        }else if(c == 0x70) {
+            d.overflows++;
+
+        }else if((c & 0x03) != 0) {
+            // a source packet, instrumentation or hardware (DWT) with a 1, 2 or 4 byte payload
+            int size = (c & 0x03) == 3 ? 4 : (c & 0x03);
+            uint32_t value = 0;
+            for (int i = 0; i < size; i++) {
+                int b = getc(fp);
+                if(b == EOF) return;
+                value |= (uint32_t)b << (8 * i);
+            }
+            if((c & 0x04) == 0) record(d, c >> 3, value);
+
+        }else if((c & 0x0F) == 0 || (c & 0x0B) == 0x08 || c == 0x94 || c == 0xB4) {
+            // local timestamp, extension or global timestamp, followed by bytes while the continuation bit is set
+            bool more = (c & 0x80) != 0;
+            while(more && (c = getc(fp)) != EOF) more = (c & 0x80) != 0;
+
+        }else{
+            d.bad_bytes++;
+        }
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: motiontrace [-f clock_mhz] [-a acceleration_ticks_per_second] [-c profile.csv] capture.swo\n");
+    fprintf(stderr, "  -f  core clock of the board in MHz, default 100\n");
+    fprintf(stderr, "  -a  acceleration_ticks_per_second of the config, default 1000\n");
+    fprintf(stderr, "  -c  write the rate and velocity of each actuator for every acceleration tick to this file\n");
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    decoder_t d;
+    memset(&d, 0, sizeof(d));
+    d.clock = 100e6;
+    const char* csv_file = NULL;
+    double ticks_per_second = 1000;
+
+    int opt;
+    while((opt = getopt(argc, argv, "f:a:c:")) != -1) {
+        switch(opt) {
+            case 'f': d.clock = atof(optarg) * 1e6; break;
+            case 'a': ticks_per_second = atof(optarg); break;
+            case 'c': csv_file = optarg; break;
+            default: usage();
+        }
+    }
+    if(optind != argc - 1 || d.clock <= 0 || ticks_per_second <= 0) usage();
+    d.min_tick = d.clock / ticks_per_second / 2;
+
+    FILE* fp = fopen(argv[optind], "rb");
+    if(fp == NULL) {
+        fprintf(stderr, "cannot read %s\n", argv[optind]);
+        return 2;
+    }
+    decode(d, fp);
+
+    // the actuators are only known once the whole trace has been read, so the profile is written by a second pass
+    if(csv_file != NULL) {
+        decoder_t p;
+        memset(&p, 0, sizeof(p));
+        p.clock = d.clock;
+        p.min_tick = d.min_tick;
+        p.num_actuators = d.num_actuators;
+        p.csv = fopen(csv_file, "w");
+        if(p.csv == NULL) {
+            fprintf(stderr, "cannot write %s\n", csv_file);
+            return 2;
+        }
+        fprintf(p.csv, "time,block");
+        for (int i = 0; i < p.num_actuators; i++) fprintf(p.csv, ",rate%d,velocity%d", i, i);
+        fprintf(p.csv, "\n");
+        rewind(fp);
+        decode(p, fp);
+        fclose(p.csv);
+    }
+    fclose(fp);
+
+    printf("%llu ticks, %.6f s, %u blocks\n", (unsigned long long)d.ticks, d.time / d.clock, d.blocks);
+    for (int i = 0; i < d.num_actuators; i++) {
+        actuator_t &a = d.actuators[i];
+        printf("  actuator %d: %8llu steps, position %8lld, %5u moves, peak velocity %9.1f steps/s, %u stutters\n",
+               i, (unsigned long long)a.steps, (long long)a.position, a.moves, a.peak_velocity, a.stutters);
+    }
+    printf("planner starved %u times for %.6f s\n", d.starvations, d.starved_time / d.clock);
+    if(d.overflows > 0) printf("%u ITM overflows, records were lost\n", d.overflows);
+    if(d.dropped > 0) printf("%u records dropped by the firmware, the stimulus port FIFO was full\n", d.dropped);
+    if(d.bad_bytes > 0 || d.unknown_records > 0) printf("%u bytes not understood, %u unknown records\n", d.bad_bytes, d.unknown_records);
+    return 0;
+}
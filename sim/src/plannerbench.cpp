@@ -0,0 +1,168 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// plannerbench: measures how many blocks per second the planner can append to a full queue, on the host.
+//   plannerbench -c config [-s key=value]... [-n blocks]
+// The queue is kept full by the simulated step ticker, only the time spent in Planner::append_block is counted, not the
+// time waiting for a free block. Run it with -s planner_queue_size=N to see how the planner scales with the queue size.
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/Config.h"
+#include "libs/StepTicker.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/robot/Planner.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+
+#include "system_LPC17xx.h"
+
+#include "Hal.h"
+#include "SimConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+#define planner_queue_size_checksum CHECKSUM("planner_queue_size")
+
+class SimIdle : public Module {
+    public:
+        void on_module_loaded() { register_for_event(ON_IDLE); }
+        void on_idle(void* argument) { sim_run(SystemCoreClock / 10000); }
+};
+
+static double host_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// A point of the path relative to where it starts, the z axis is not moved
+typedef void (*path_t)(int i, float* point);
+
+// a circle of 5mm radius cut into 0.2mm segments, the junctions are not speed limited
+static void circle_path(int i, float* point)
+{
+    float a = i * 0.04F;
+    point[0] = 5.0F * cosf(a) - 5.0F;
+    point[1] = 5.0F * sinf(a);
+}
+
+// 0.05mm segments on a straight line, too short to reach 300mm/s within the queue so every block stays decel limited
+static void line_path(int i, float* point)
+{
+    point[0] = i * 0.05F;
+    point[1] = 0.0F;
+}
+
+// 0.5mm segments turning by 90 degrees at every junction, each block enters at its junction speed
+static void zigzag_path(int i, float* point)
+{
+    point[0] = (i / 2) * 0.5F;
+    point[1] = ((i + 1) / 2) * 0.5F;
+}
+
+static float position[3] = {0, 0, 0};
+
+// Appends the blocks of a path, returns the time spent in the planner
+static double run_path(path_t path, float rate_mm_s, int blocks)
+{
+    float previous[3], target[3];
+    double planner_time = 0;
+
+    memcpy(previous, position, sizeof(previous));
+    memcpy(target, position, sizeof(target));
+    for (int i = 1; i <= blocks; i++) {
+        float point[2];
+        path(i, point);
+        target[0] = position[0] + point[0];
+        target[1] = position[1] + point[1];
+        float deltas[3];
+        for (int j = 0; j < 3; j++) deltas[j] = target[j] - previous[j];
+        int32_t unit_vec[3];
+        uint32_t distance = Planner::move_length(deltas, unit_vec);
+        uint32_t rate = mm_to_fixed(rate_mm_s);
+
+        // wait for a free block outside of the measurement, like Conveyor::queue_head_block does
+        while (THEKERNEL->conveyor->is_queue_full()) {
+            THEKERNEL->conveyor->ensure_running();
+            THEKERNEL->call_event(ON_IDLE);
+        }
+
+        double start = host_seconds();
+        THEKERNEL->planner->append_block(target, rate, distance, unit_vec, rate, false);
+        planner_time += host_seconds() - start;
+
+        memcpy(previous, target, sizeof(previous));
+    }
+    memcpy(position, target, sizeof(position));
+    THEKERNEL->conveyor->wait_for_empty_queue();
+    return planner_time;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s -c config [-s key=value]... [-n blocks]\n", name);
+    fprintf(stderr, "  -c  machine config file\n");
+    fprintf(stderr, "  -s  set or override a config value, e.g. planner_queue_size=64\n");
+    fprintf(stderr, "  -n  blocks appended for each path, default 10000\n");
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    const char* config_file = NULL;
+    int blocks = 10000;
+    std::vector<std::pair<std::string, std::string>> overrides;
+
+    int opt;
+    while((opt = getopt(argc, argv, "c:s:n:")) != -1) {
+        switch(opt) {
+            case 'c': config_file = optarg; break;
+            case 'n': blocks = atoi(optarg); break;
+            case 's': {
+                const char* eq = strchr(optarg, '=');
+                if(eq == NULL) usage(argv[0]);
+                overrides.push_back(std::make_pair(std::string(optarg, eq - optarg), std::string(eq + 1)));
+                break;
+            }
+            default: usage(argv[0]);
+        }
+    }
+    if(config_file == NULL || optind != argc || blocks <= 0) usage(argv[0]);
+
+    if(!sim_config_load(config_file)) {
+        fprintf(stderr, "cannot read config file %s\n", config_file);
+        return 2;
+    }
+    for (auto &o : overrides) {
+        sim_config_set(o.first, o.second);
+    }
+
+    Kernel* kernel = new Kernel();
+    kernel->add_module( new SimIdle(), "SimIdle" );
+    int queue_size = kernel->config->value(planner_queue_size_checksum)->by_default(32)->as_number();
+    kernel->config->config_cache_clear();
+    kernel->step_ticker->start();
+
+    struct { const char* name; path_t path; float rate_mm_s; } paths[] = {
+        {"circle", circle_path, 100.0F}, {"zigzag", zigzag_path, 100.0F}, {"line", line_path, 300.0F}
+    };
+    for (auto &p : paths) {
+        double t = run_path(p.path, p.rate_mm_s, blocks);
+        printf("queue %3d, %-6s: %d blocks appended in %.3f s, %.0f blocks/s\n", queue_size, p.name, blocks, t, blocks / t);
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// simtrace: reports on a step trace, or compares it against a golden trace
+//   simtrace report trace
+//   simtrace diff [-t tolerance_us] golden trace
+// diff fails when an actuator makes a different number of steps, ends somewhere else, or a step moves by more than the tolerance.
+
+#include "StepTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+
+// the peak step rate is averaged over this many step intervals, so a single late step does not count as a peak
+#define PEAK_RATE_STEPS 8
+
+struct actuator_stats_t {
+    uint32_t steps;
+    int64_t position;
+    double peak_rate;           // steps per second
+    double min_interval;        // seconds
+};
+
+struct trace_stats_t {
+    std::vector<actuator_stats_t> actuators;
+    double move_time;           // from the first to the last step of any actuator, in seconds
+};
+
+static trace_stats_t analyze(const step_trace_t& trace)
+{
+    trace_stats_t stats;
+    uint64_t first = UINT64_MAX, last = 0;
+
+    for (auto &a : trace.actuators) {
+        actuator_stats_t s;
+        s.steps = a.step_times.size();
+        s.position = a.position;
+        s.peak_rate = 0;
+        s.min_interval = 0;
+
+        const std::vector<uint64_t> &t = a.step_times;
+        if(!t.empty()) {
+            first = std::min(first, t.front());
+            last = std::max(last, t.back());
+        }
+
+        uint64_t min_interval = UINT64_MAX;
+        for (size_t i = 1; i < t.size(); i++) {
+            min_interval = std::min(min_interval, t[i] - t[i - 1]);
+        }
+        if(min_interval != UINT64_MAX) s.min_interval = (double)min_interval / trace.clock;
+
+        size_t n = std::min<size_t>(PEAK_RATE_STEPS, t.size() > 0 ? t.size() - 1 : 0);
+        for (size_t i = n; n > 0 && i < t.size(); i++) {
+            uint64_t span = t[i] - t[i - n];
+            if(span > 0) s.peak_rate = std::max(s.peak_rate, (double)n * trace.clock / span);
+        }
+
+        stats.actuators.push_back(s);
+    }
+
+    stats.move_time = (last >= first && first != UINT64_MAX) ? (double)(last - first) / trace.clock : 0;
+    return stats;
+}
+
+static void print_stats(const char* name, const trace_stats_t& stats)
+{
+    printf("%s: total move time %.6f s\n", name, stats.move_time);
+    for (size_t i = 0; i < stats.actuators.size(); i++) {
+        const actuator_stats_t &s = stats.actuators[i];
+        printf("  actuator %u: %8u steps, position %8lld, peak rate %9.1f steps/s, min interval %8.2f us\n",
+               (unsigned)i, s.steps, (long long)s.position, s.peak_rate, s.min_interval * 1e6);
+    }
+}
+
+static bool load(const char* filename, step_trace_t& trace)
+{
+    std::string error;
+    if(!read_step_trace(filename, trace, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+static int report(const char* filename)
+{
+    step_trace_t trace;
+    if(!load(filename, trace)) return 2;
+    print_stats(filename, analyze(trace));
+    return 0;
+}
+
+static int diff(const char* golden_file, const char* trace_file, double tolerance_us)
+{
+    step_trace_t golden, trace;
+    if(!load(golden_file, golden) || !load(trace_file, trace)) return 2;
+
+    trace_stats_t golden_stats = analyze(golden);
+    trace_stats_t trace_stats = analyze(trace);
+    print_stats("golden", golden_stats);
+    print_stats("trace ", trace_stats);
+
+    if(golden.actuators.size() != trace.actuators.size()) {
+        printf("FAIL: %u actuators in golden, %u in trace\n", (unsigned)golden.actuators.size(), (unsigned)trace.actuators.size());
+        return 1;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < golden.actuators.size(); i++) {
+        const actuator_trace_t &g = golden.actuators[i];
+        const actuator_trace_t &t = trace.actuators[i];
+
+        if(g.step_times.size() != t.step_times.size() || g.position != t.position) {
+            printf("FAIL: actuator %u made %u steps to %lld, golden made %u steps to %lld\n", (unsigned)i,
+                   (unsigned)t.step_times.size(), (long long)t.position, (unsigned)g.step_times.size(), (long long)g.position);
+            ok = false;
+            continue;
+        }
+
+        // steps are compared in order, the golden and the trace are in their own time base
+        double worst = 0, sum = 0;
+        size_t worst_step = 0;
+        for (size_t s = 0; s < g.step_times.size(); s++) {
+            double d = fabs((double)g.step_times[s] / golden.clock - (double)t.step_times[s] / trace.clock) * 1e6;
+            sum += d;
+            if(d > worst) {
+                worst = d;
+                worst_step = s;
+            }
+        }
+        if(!g.step_times.empty()) {
+            printf("  actuator %u: step timing deviation max %.2f us (step %u), mean %.3f us\n", (unsigned)i, worst, (unsigned)worst_step, sum / g.step_times.size());
+        }
+        if(worst > tolerance_us) {
+            printf("FAIL: actuator %u step %u is %.2f us away from the golden trace\n", (unsigned)i, (unsigned)worst_step, worst);
+            ok = false;
+        }
+    }
+
+    printf("move time %+.6f s, %s\n", trace_stats.move_time - golden_stats.move_time, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: simtrace report trace\n");
+    fprintf(stderr, "       simtrace diff [-t tolerance_us] golden trace\n");
+    exit(2);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) usage();
+
+    if(strcmp(argv[1], "report") == 0 && argc == 3) {
+        return report(argv[2]);
+    }
+
+    if(strcmp(argv[1], "diff") == 0) {
+        double tolerance_us = 0;
+        int opt;
+        optind = 2;
+        while((opt = getopt(argc, argv, "t:")) != -1) {
+            if(opt == 't') tolerance_us = atof(optarg);
+            else usage();
+        }
+        if(optind != argc - 2) usage();
+        return diff(argv[optind], argv[optind + 1], tolerance_us);
+    }
+
+    usage();
+    return 2;
+}
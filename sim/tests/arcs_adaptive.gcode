@@ -0,0 +1,6 @@
+; a large and a small radius arc, cut into segments by their chord error
+G21
+G90
+G1 X20 Y0 F6000
+G3 X0 Y20 I-20 J0 F6000
+G2 X0 Y20 I0 J-1 F1500
@@ -0,0 +1,7 @@
+; full and partial arcs in both directions, cut into segments by the robot
+G21
+G90
+G1 X6 Y3 F6000
+G2 X6 Y3 I-3 J0 F3000
+G3 X9 Y6 I3 J0
+G2 X12 Y3 I0 J-3 F6000
@@ -0,0 +1,6 @@
+; steps above base_stepping_frequency, made in bursts of up to max_steps_per_tick pulses in a tick
+G21
+G90
+G1 X40 F18000
+G1 X40 Y20 F18000
+G1 X0 Y0 Z0.5 F30000
@@ -0,0 +1,6 @@
+; bursts of the step tick that is held up until its next tick, whose steps must be added to the bursts that are still going
+G21
+G90
+G1 X40 F18000
+G1 X40 Y20 F18000
+G1 X0 Y0 Z0.5 F30000
@@ -0,0 +1,205 @@
+; short colinear segments as CAM output has them, merged with -s line_coalescing_tolerance
+G21
+G90
+G1 X0 Y0 F3000
+G1 X0.050 Y0.000
+G1 X0.100 Y0.000
+G1 X0.150 Y0.000
+G1 X0.200 Y0.000
+G1 X0.250 Y0.000
+G1 X0.300 Y0.000
+G1 X0.350 Y0.000
+G1 X0.400 Y0.000
+G1 X0.450 Y0.000
+G1 X0.500 Y0.000
+G1 X0.550 Y0.000
+G1 X0.600 Y0.000
+G1 X0.650 Y0.000
+G1 X0.700 Y0.000
+G1 X0.750 Y0.000
+G1 X0.800 Y0.000
+G1 X0.850 Y0.000
+G1 X0.900 Y0.000
+G1 X0.950 Y0.000
+G1 X1.000 Y0.000
+G1 X1.050 Y0.000
+G1 X1.100 Y0.000
+G1 X1.150 Y0.000
+G1 X1.200 Y0.000
+G1 X1.250 Y0.000
+G1 X1.300 Y0.000
+G1 X1.350 Y0.000
+G1 X1.400 Y0.000
+G1 X1.450 Y0.000
+G1 X1.500 Y0.000
+G1 X1.550 Y0.000
+G1 X1.600 Y0.000
+G1 X1.650 Y0.000
+G1 X1.700 Y0.000
+G1 X1.750 Y0.000
+G1 X1.800 Y0.000
+G1 X1.850 Y0.000
+G1 X1.900 Y0.000
+G1 X1.950 Y0.000
+G1 X2.000 Y0.000
+G1 X2.050 Y0.000
+G1 X2.100 Y0.000
+G1 X2.150 Y0.000
+G1 X2.200 Y0.000
+G1 X2.250 Y0.000
+G1 X2.300 Y0.000
+G1 X2.350 Y0.000
+G1 X2.400 Y0.000
+G1 X2.450 Y0.000
+G1 X2.500 Y0.000
+G1 X2.550 Y0.000
+G1 X2.600 Y0.000
+G1 X2.650 Y0.000
+G1 X2.700 Y0.000
+G1 X2.750 Y0.000
+G1 X2.800 Y0.000
+G1 X2.850 Y0.000
+G1 X2.900 Y0.000
+G1 X2.950 Y0.000
+G1 X3.000 Y0.000
+G1 X3.050 Y0.000
+G1 X3.100 Y0.000
+G1 X3.150 Y0.000
+G1 X3.200 Y0.000
+G1 X3.250 Y0.000
+G1 X3.300 Y0.000
+G1 X3.350 Y0.000
+G1 X3.400 Y0.000
+G1 X3.450 Y0.000
+G1 X3.500 Y0.000
+G1 X3.550 Y0.000
+G1 X3.600 Y0.000
+G1 X3.650 Y0.000
+G1 X3.700 Y0.000
+G1 X3.750 Y0.000
+G1 X3.800 Y0.000
+G1 X3.850 Y0.000
+G1 X3.900 Y0.000
+G1 X3.950 Y0.000
+G1 X4.000 Y0.000
+G1 X4.050 Y0.000
+G1 X4.100 Y0.000
+G1 X4.150 Y0.000
+G1 X4.200 Y0.000
+G1 X4.250 Y0.000
+G1 X4.300 Y0.000
+G1 X4.350 Y0.000
+G1 X4.400 Y0.000
+G1 X4.450 Y0.000
+G1 X4.500 Y0.000
+G1 X4.550 Y0.000
+G1 X4.600 Y0.000
+G1 X4.650 Y0.000
+G1 X4.700 Y0.000
+G1 X4.750 Y0.000
+G1 X4.800 Y0.000
+G1 X4.850 Y0.000
+G1 X4.900 Y0.000
+G1 X4.950 Y0.000
+G1 X5.000 Y0.000
+G1 X5.050 Y0.000
+G1 X5.100 Y0.000
+G1 X5.150 Y0.000
+G1 X5.200 Y0.000
+G1 X5.250 Y0.001
+G1 X5.300 Y0.001
+G1 X5.350 Y0.001
+G1 X5.400 Y0.002
+G1 X5.450 Y0.002
+G1 X5.500 Y0.002
+G1 X5.550 Y0.003
+G1 X5.600 Y0.004
+G1 X5.650 Y0.004
+G1 X5.700 Y0.005
+G1 X5.750 Y0.006
+G1 X5.800 Y0.006
+G1 X5.850 Y0.007
+G1 X5.900 Y0.008
+G1 X5.950 Y0.009
+G1 X6.000 Y0.010
+G1 X6.050 Y0.011
+G1 X6.100 Y0.012
+G1 X6.150 Y0.013
+G1 X6.200 Y0.014
+G1 X6.250 Y0.016
+G1 X6.300 Y0.017
+G1 X6.350 Y0.018
+G1 X6.400 Y0.020
+G1 X6.450 Y0.021
+G1 X6.500 Y0.022
+G1 X6.550 Y0.024
+G1 X6.600 Y0.026
+G1 X6.650 Y0.027
+G1 X6.700 Y0.029
+G1 X6.750 Y0.031
+G1 X6.800 Y0.032
+G1 X6.850 Y0.034
+G1 X6.900 Y0.036
+G1 X6.950 Y0.038
+G1 X6.999 Y0.040
+G1 X7.049 Y0.042
+G1 X7.099 Y0.044
+G1 X7.149 Y0.046
+G1 X7.199 Y0.048
+G1 X7.249 Y0.051
+G1 X7.299 Y0.053
+G1 X7.349 Y0.055
+G1 X7.399 Y0.058
+G1 X7.449 Y0.060
+G1 X7.499 Y0.062
+G1 X7.549 Y0.065
+G1 X7.599 Y0.068
+G1 X7.649 Y0.070
+G1 X7.699 Y0.073
+G1 X7.749 Y0.076
+G1 X7.799 Y0.078
+G1 X7.848 Y0.081
+G1 X7.898 Y0.084
+G1 X7.948 Y0.087
+G1 X7.998 Y0.090
+G1 X8.048 Y0.093
+G1 X8.098 Y0.096
+G1 X8.148 Y0.099
+G1 X8.198 Y0.102
+G1 X8.248 Y0.106
+G1 X8.298 Y0.109
+G1 X8.347 Y0.112
+G1 X8.397 Y0.116
+G1 X8.447 Y0.119
+G1 X8.497 Y0.122
+G1 X8.547 Y0.126
+G1 X8.597 Y0.130
+G1 X8.647 Y0.133
+G1 X8.697 Y0.137
+G1 X8.746 Y0.141
+G1 X8.796 Y0.144
+G1 X8.846 Y0.148
+G1 X8.896 Y0.152
+G1 X8.946 Y0.156
+G1 X8.996 Y0.160
+G1 X9.046 Y0.164
+G1 X9.095 Y0.168
+G1 X9.145 Y0.172
+G1 X9.195 Y0.176
+G1 X9.245 Y0.181
+G1 X9.295 Y0.185
+G1 X9.345 Y0.189
+G1 X9.394 Y0.193
+G1 X9.444 Y0.198
+G1 X9.494 Y0.202
+G1 X9.544 Y0.207
+G1 X9.594 Y0.211
+G1 X9.643 Y0.216
+G1 X9.693 Y0.221
+G1 X9.743 Y0.225
+G1 X9.793 Y0.230
+G1 X9.842 Y0.235
+G1 X9.892 Y0.240
+G1 X9.942 Y0.245
+G1 X9.992 Y0.250
+G1 X0 Y0
@@ -0,0 +1,205 @@
+; 0.05mm segments, the queue holds the whole line so the planner can reach the feed rate on it. The blocks are in AHB SRAM, the Conveyor warns if they do not fit there
+G21
+G90
+G1 X0 Y0 F6000
+G1 X0.050 Y0.000
+G1 X0.100 Y0.000
+G1 X0.150 Y0.000
+G1 X0.200 Y0.000
+G1 X0.250 Y0.000
+G1 X0.300 Y0.000
+G1 X0.350 Y0.000
+G1 X0.400 Y0.000
+G1 X0.450 Y0.000
+G1 X0.500 Y0.000
+G1 X0.550 Y0.000
+G1 X0.600 Y0.000
+G1 X0.650 Y0.000
+G1 X0.700 Y0.000
+G1 X0.750 Y0.000
+G1 X0.800 Y0.000
+G1 X0.850 Y0.000
+G1 X0.900 Y0.000
+G1 X0.950 Y0.000
+G1 X1.000 Y0.000
+G1 X1.050 Y0.000
+G1 X1.100 Y0.000
+G1 X1.150 Y0.000
+G1 X1.200 Y0.000
+G1 X1.250 Y0.000
+G1 X1.300 Y0.000
+G1 X1.350 Y0.000
+G1 X1.400 Y0.000
+G1 X1.450 Y0.000
+G1 X1.500 Y0.000
+G1 X1.550 Y0.000
+G1 X1.600 Y0.000
+G1 X1.650 Y0.000
+G1 X1.700 Y0.000
+G1 X1.750 Y0.000
+G1 X1.800 Y0.000
+G1 X1.850 Y0.000
+G1 X1.900 Y0.000
+G1 X1.950 Y0.000
+G1 X2.000 Y0.000
+G1 X2.050 Y0.000
+G1 X2.100 Y0.000
+G1 X2.150 Y0.000
+G1 X2.200 Y0.000
+G1 X2.250 Y0.000
+G1 X2.300 Y0.000
+G1 X2.350 Y0.000
+G1 X2.400 Y0.000
+G1 X2.450 Y0.000
+G1 X2.500 Y0.000
+G1 X2.550 Y0.000
+G1 X2.600 Y0.000
+G1 X2.650 Y0.000
+G1 X2.700 Y0.000
+G1 X2.750 Y0.000
+G1 X2.800 Y0.000
+G1 X2.850 Y0.000
+G1 X2.900 Y0.000
+G1 X2.950 Y0.000
+G1 X3.000 Y0.000
+G1 X3.050 Y0.000
+G1 X3.100 Y0.000
+G1 X3.150 Y0.000
+G1 X3.200 Y0.000
+G1 X3.250 Y0.000
+G1 X3.300 Y0.000
+G1 X3.350 Y0.000
+G1 X3.400 Y0.000
+G1 X3.450 Y0.000
+G1 X3.500 Y0.000
+G1 X3.550 Y0.000
+G1 X3.600 Y0.000
+G1 X3.650 Y0.000
+G1 X3.700 Y0.000
+G1 X3.750 Y0.000
+G1 X3.800 Y0.000
+G1 X3.850 Y0.000
+G1 X3.900 Y0.000
+G1 X3.950 Y0.000
+G1 X4.000 Y0.000
+G1 X4.050 Y0.000
+G1 X4.100 Y0.000
+G1 X4.150 Y0.000
+G1 X4.200 Y0.000
+G1 X4.250 Y0.000
+G1 X4.300 Y0.000
+G1 X4.350 Y0.000
+G1 X4.400 Y0.000
+G1 X4.450 Y0.000
+G1 X4.500 Y0.000
+G1 X4.550 Y0.000
+G1 X4.600 Y0.000
+G1 X4.650 Y0.000
+G1 X4.700 Y0.000
+G1 X4.750 Y0.000
+G1 X4.800 Y0.000
+G1 X4.850 Y0.000
+G1 X4.900 Y0.000
+G1 X4.950 Y0.000
+G1 X5.000 Y0.000
+G1 X5.050 Y0.000
+G1 X5.100 Y0.000
+G1 X5.150 Y0.000
+G1 X5.200 Y0.000
+G1 X5.250 Y0.000
+G1 X5.300 Y0.000
+G1 X5.350 Y0.000
+G1 X5.400 Y0.000
+G1 X5.450 Y0.000
+G1 X5.500 Y0.000
+G1 X5.550 Y0.000
+G1 X5.600 Y0.000
+G1 X5.650 Y0.000
+G1 X5.700 Y0.000
+G1 X5.750 Y0.000
+G1 X5.800 Y0.000
+G1 X5.850 Y0.000
+G1 X5.900 Y0.000
+G1 X5.950 Y0.000
+G1 X6.000 Y0.000
+G1 X6.050 Y0.000
+G1 X6.100 Y0.000
+G1 X6.150 Y0.000
+G1 X6.200 Y0.000
+G1 X6.250 Y0.000
+G1 X6.300 Y0.000
+G1 X6.350 Y0.000
+G1 X6.400 Y0.000
+G1 X6.450 Y0.000
+G1 X6.500 Y0.000
+G1 X6.550 Y0.000
+G1 X6.600 Y0.000
+G1 X6.650 Y0.000
+G1 X6.700 Y0.000
+G1 X6.750 Y0.000
+G1 X6.800 Y0.000
+G1 X6.850 Y0.000
+G1 X6.900 Y0.000
+G1 X6.950 Y0.000
+G1 X7.000 Y0.000
+G1 X7.050 Y0.000
+G1 X7.100 Y0.000
+G1 X7.150 Y0.000
+G1 X7.200 Y0.000
+G1 X7.250 Y0.000
+G1 X7.300 Y0.000
+G1 X7.350 Y0.000
+G1 X7.400 Y0.000
+G1 X7.450 Y0.000
+G1 X7.500 Y0.000
+G1 X7.550 Y0.000
+G1 X7.600 Y0.000
+G1 X7.650 Y0.000
+G1 X7.700 Y0.000
+G1 X7.750 Y0.000
+G1 X7.800 Y0.000
+G1 X7.850 Y0.000
+G1 X7.900 Y0.000
+G1 X7.950 Y0.000
+G1 X8.000 Y0.000
+G1 X8.050 Y0.000
+G1 X8.100 Y0.000
+G1 X8.150 Y0.000
+G1 X8.200 Y0.000
+G1 X8.250 Y0.000
+G1 X8.300 Y0.000
+G1 X8.350 Y0.000
+G1 X8.400 Y0.000
+G1 X8.450 Y0.000
+G1 X8.500 Y0.000
+G1 X8.550 Y0.000
+G1 X8.600 Y0.000
+G1 X8.650 Y0.000
+G1 X8.700 Y0.000
+G1 X8.750 Y0.000
+G1 X8.800 Y0.000
+G1 X8.850 Y0.000
+G1 X8.900 Y0.000
+G1 X8.950 Y0.000
+G1 X9.000 Y0.000
+G1 X9.050 Y0.000
+G1 X9.100 Y0.000
+G1 X9.150 Y0.000
+G1 X9.200 Y0.000
+G1 X9.250 Y0.000
+G1 X9.300 Y0.000
+G1 X9.350 Y0.000
+G1 X9.400 Y0.000
+G1 X9.450 Y0.000
+G1 X9.500 Y0.000
+G1 X9.550 Y0.000
+G1 X9.600 Y0.000
+G1 X9.650 Y0.000
+G1 X9.700 Y0.000
+G1 X9.750 Y0.000
+G1 X9.800 Y0.000
+G1 X9.850 Y0.000
+G1 X9.900 Y0.000
+G1 X9.950 Y0.000
+G1 X10.000 Y0.000
+G1 X10 Y1
@@ -0,0 +1,10 @@
+; a linear delta cut into segments by the kinematic error: pure Z moves stay whole, moves towards the edge do not
+G21
+G90
+G1 Z5 F6000
+G1 Z0
+G1 X10 Y0
+G1 X0 Y0
+G1 X60 Y0
+G1 X-30 Y40
+G1 X0 Y0
@@ -0,0 +1,132 @@
+; feed and rapid overrides on moves already in the queue, each M220 is read once the queue has filled up
+G21
+G90
+G1 X0 Y0 F6000
+G1 X2 Y0
+G1 X4 Y2
+G1 X6 Y0
+G1 X8 Y2
+G1 X10 Y0
+G1 X12 Y2
+G1 X14 Y0
+G1 X16 Y2
+G1 X18 Y0
+G1 X20 Y2
+G1 X22 Y0
+G1 X24 Y2
+G1 X26 Y0
+G1 X28 Y2
+G1 X30 Y0
+G1 X32 Y2
+G1 X34 Y0
+G1 X36 Y2
+G1 X38 Y0
+G1 X40 Y2
+G1 X42 Y0
+G1 X44 Y2
+G1 X46 Y0
+G1 X48 Y2
+G1 X50 Y0
+G1 X52 Y2
+G1 X54 Y0
+G1 X56 Y2
+G1 X58 Y0
+G1 X60 Y2
+G1 X62 Y0
+G1 X64 Y2
+G1 X66 Y0
+G1 X68 Y2
+G1 X70 Y0
+G1 X72 Y2
+G1 X74 Y0
+G1 X76 Y2
+G1 X78 Y0
+G1 X80 Y2
+M220 S150
+G0 X0 Y20
+G1 X2 Y20
+G1 X4 Y22
+G1 X6 Y20
+G1 X8 Y22
+G1 X10 Y20
+G1 X12 Y22
+G1 X14 Y20
+G1 X16 Y22
+G1 X18 Y20
+G1 X20 Y22
+G1 X22 Y20
+G1 X24 Y22
+G1 X26 Y20
+G1 X28 Y22
+G1 X30 Y20
+G1 X32 Y22
+G1 X34 Y20
+G1 X36 Y22
+G1 X38 Y20
+G1 X40 Y22
+G1 X42 Y20
+G1 X44 Y22
+G1 X46 Y20
+G1 X48 Y22
+G1 X50 Y20
+G1 X52 Y22
+G1 X54 Y20
+G1 X56 Y22
+G1 X58 Y20
+G1 X60 Y22
+G1 X62 Y20
+G1 X64 Y22
+G1 X66 Y20
+G1 X68 Y22
+G1 X70 Y20
+G1 X72 Y22
+G1 X74 Y20
+G1 X76 Y22
+G1 X78 Y20
+G1 X80 Y22
+M220 S50 R50
+G0 X0 Y40
+G0 X80 Y0
+G1 X0 Y0
+G1 X2 Y0
+G1 X4 Y2
+G1 X6 Y0
+G1 X8 Y2
+G1 X10 Y0
+G1 X12 Y2
+G1 X14 Y0
+G1 X16 Y2
+G1 X18 Y0
+G1 X20 Y2
+G1 X22 Y0
+G1 X24 Y2
+G1 X26 Y0
+G1 X28 Y2
+G1 X30 Y0
+G1 X32 Y2
+G1 X34 Y0
+G1 X36 Y2
+G1 X38 Y0
+G1 X40 Y2
+G1 X42 Y0
+G1 X44 Y2
+G1 X46 Y0
+G1 X48 Y2
+G1 X50 Y0
+G1 X52 Y2
+G1 X54 Y0
+G1 X56 Y2
+G1 X58 Y0
+G1 X60 Y2
+G1 X62 Y0
+G1 X64 Y2
+G1 X66 Y0
+G1 X68 Y2
+G1 X70 Y0
+G1 X72 Y2
+G1 X74 Y0
+G1 X76 Y2
+G1 X78 Y0
+G1 X80 Y2
+M220 S100 R100
+G0 X0 Y0
@@ -0,0 +1,47 @@
+; M220 back to 100 while an overridden block is executing, it is read once the queue has filled up. The blocks after
+; that one follow their planned profiles again, the same as without the M220 S50
+G21
+G90
+G1 X0 Y0 F6000
+M220 S50
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
+M220 S100
+G1 X20 Y0
+G1 X20 Y20
+G1 X0 Y20
+G1 X0 Y0
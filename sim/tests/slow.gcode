@@ -0,0 +1,7 @@
+; slow moves, where a fraction of a step per second is a large part of the rate
+G21
+G90
+G1 X0.5 F6
+G1 X0.6 Y0.3 F9
+G1 Z0.05 F1.5
+G1 X0 Y0 Z0 F12
@@ -0,0 +1,7 @@
+; a square with a feed rate change on every side
+G21
+G90
+G1 X10 Y0 F3000
+G1 X10 Y10 F6000
+G1 X0 Y10 F1500
+G1 X0 Y0 F12000
@@ -0,0 +1,19 @@
+; short segments with sharp corners and a main loop slower than the acceleration tick, segments run short and the
+; acceleration tick falls back to the trapezoid
+G21
+G90
+G1 X1 Y0.5 F6000
+G1 X2 Y0
+G1 X3 Y0.5
+G1 X4 Y0
+G1 X5 Y0.5
+G1 X6 Y0
+G1 X7 Y0.5
+G1 X8 Y0
+G1 X9 Y0.5
+G1 X10 Y0
+G1 X10.2 Y0.1
+G1 X10.4 Y0
+G1 X10.6 Y0.1
+G1 X10.8 Y0
+G1 X11 Y0.1
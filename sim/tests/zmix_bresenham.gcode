@@ -0,0 +1,7 @@
+; a slow Z axis alone and together with X and Y, the Z axis limits the move
+G21
+G90
+G1 Z0.5 F300
+G1 X5 Y5 Z1 F3000
+G1 X10 Z0.5
+G1 X0 Y0 Z0 F6000
@@ -3,6 +3,7 @@
 
 #include "libs/Kernel.h"
 #include "libs/utils.h"
+#include "libs/decimal.h"
 #include "libs/Pin.h"
 #include "Pwm.h"
 
@@ -71,7 +72,7 @@ float ConfigValue::as_number()
         char *endptr = NULL;
         string str = remove_non_number(this->value);
         const char *cp= str.c_str();
-        float result = strtof(cp, &endptr);
+        float result = decimal_strtof(cp, &endptr);
         if( endptr <= cp ) {
             printErrorandExit("config setting with value '%s' and checksums[%04X,%04X,%04X] is not a valid number, please see http://smoothieware.org/configuring-smoothie\r\n", this->value.c_str(), this->check_sums[0], this->check_sums[1], this->check_sums[2] );
         }
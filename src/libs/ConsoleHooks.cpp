@@ -0,0 +1,44 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "libs/ConsoleHooks.h"
+#include "libs/Module.h"
+#include "libs/EventProfiler.h"
+#include "libs/SerialMessage.h"
+
+#include <string.h>
+#include <strings.h>
+
+void ConsoleHooks::add_command(Module* module, const char* command)
+{
+    for (auto &c : commands) {
+        if(c.module == module && strcasecmp(c.command, command) == 0) return;
+    }
+    commands.push_back({command, module});
+}
+
+void ConsoleHooks::call(SerialMessage* message) const
+{
+    const char *line = message->message.c_str();
+
+    if(line[0] != '\0' && strchr("GMTN", line[0]) == NULL) {
+        // the first word, commands are not case sensitive
+        size_t length = strcspn(line, " \t\r\n");
+        bool claimed = false;
+        for (auto &c : commands) {
+            if(length > 0 && strncasecmp(line, c.command, length) == 0 && c.command[length] == '\0') {
+                EventProfiler::call_handler(c.module, ON_CONSOLE_LINE_RECEIVED, message);
+                claimed = true;
+            }
+        }
+        if(claimed) return;
+    }
+
+    for (auto m : any) {
+        EventProfiler::call_handler(m, ON_CONSOLE_LINE_RECEIVED, message);
+    }
+}
@@ -0,0 +1,36 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CONSOLEHOOKS_H
+#define CONSOLEHOOKS_H
+
+#include <vector>
+
+class Module;
+struct SerialMessage;
+
+// The modules that are called for ON_CONSOLE_LINE_RECEIVED. A line is looked at once: a line that begins with a G, M, T
+// or N is a gcode, any other line is a command if its first word is one a module has asked for, like "play" or "ls".
+// A command only goes to the modules that asked for it, gcodes and all the other lines go to the modules that asked for
+// every line, like GcodeDispatch. The modules are called in the order they asked in.
+class ConsoleHooks {
+    public:
+        void add_command(Module* module, const char* command);
+        void add_any(Module* module) { any.push_back(module); }
+        void call(SerialMessage* message) const;
+
+    private:
+        struct command_t {
+            const char* command;    // not copied, a string literal
+            Module*     module;
+        };
+
+        std::vector<command_t> commands;
+        std::vector<Module*> any;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EventProfiler.h"
+#include "StreamOutput.h"
+
+#ifdef EVENT_PROFILER
+
+#include "system_LPC17xx.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+volatile bool EventProfiler::enabled = false;
+std::vector<EventProfiler::stats_t> EventProfiler::stats;
+std::vector<std::pair<Module*, const char*>> EventProfiler::names;
+
+// in the order of _EVENT_ENUM
+static const char* const event_names[NUMBER_OF_DEFINED_EVENTS] = {
+    "main_loop", "console_line", "gcode_received", "gcode_execute", "speed_change", "block_begin", "block_end",
+    "play", "pause", "idle", "second_tick", "get_public_data", "set_public_data", "halt"
+};
+
+static bool before(Module* module_a, int event_a, Module* module_b, int event_b)
+{
+    return event_a < event_b || (event_a == event_b && module_a < module_b);
+}
+
+// Start the cycle counter and clear the stats, the counter is left running when turned off
+void EventProfiler::enable(bool on)
+{
+    if(on && !enabled) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+        __disable_irq();
+        for (auto &s : stats) {
+            s.count = 0;
+            s.max = 0;
+            s.total = 0;
+        }
+        __enable_irq();
+    }
+    enabled = on;
+}
+
+void EventProfiler::name_module(Module* module, const char* name)
+{
+    if(name != nullptr) names.push_back(std::make_pair(module, name));
+}
+
+void EventProfiler::add(Module* module, _EVENT_ENUM event)
+{
+    auto pos = std::lower_bound(stats.begin(), stats.end(), event, [module](const stats_t& s, int e) {
+        return before(s.module, s.event, module, e);
+    });
+    if(pos != stats.end() && pos->module == module && pos->event == event) return;
+
+    stats_t s = {module, (uint8_t)event, 0, 0, 0};
+    // the vector may move, an event called by an interrupt must not look at it meanwhile
+    __disable_irq();
+    stats.insert(pos, s);
+    __enable_irq();
+}
+
+void EventProfiler::record(Module* module, _EVENT_ENUM event, uint32_t cycles)
+{
+    auto pos = std::lower_bound(stats.begin(), stats.end(), event, [module](const stats_t& s, int e) {
+        return before(s.module, s.event, module, e);
+    });
+    if(pos == stats.end() || pos->module != module || pos->event != event) return;
+
+    pos->count++;
+    pos->total += cycles;
+    if(cycles > pos->max) pos->max = cycles;
+}
+
+const char* EventProfiler::module_name(Module* module)
+{
+    for (auto &n : names) {
+        if(n.first == module) return n.second;
+    }
+    // a module added without a name, find it in the map file
+    static char buf[12];
+    snprintf(buf, sizeof(buf), "0x%08lX", (unsigned long)module);
+    return buf;
+}
+
+// Print the handlers that took the most time since the last dump, and start over
+void EventProfiler::dump_and_reset(StreamOutput* stream, int top)
+{
+    if(!enabled) {
+        stream->printf("event profiler is off, turn it on with eventstats on\r\n");
+        return;
+    }
+
+    // take a copy so the handlers can not change it while it is printed
+    std::vector<stats_t> s(stats.size());
+    __disable_irq();
+    std::copy(stats.begin(), stats.end(), s.begin());
+    for (auto &i : stats) {
+        i.count = 0;
+        i.max = 0;
+        i.total = 0;
+    }
+    __enable_irq();
+
+    std::sort(s.begin(), s.end(), [](const stats_t& a, const stats_t& b) { return a.total > b.total; });
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    for (int i = 0; i < (int)s.size() && i < top && s[i].count > 0; i++) {
+        stream->printf("%-20s %-16s %8lu calls, total %10lu us, mean %8lu max %9lu cycles\r\n",
+                       module_name(s[i].module), event_names[s[i].event], (unsigned long)s[i].count,
+                       (unsigned long)(s[i].total / cycles_per_us), (unsigned long)(s[i].total / s[i].count), (unsigned long)s[i].max);
+    }
+}
+
+#else
+
+void EventProfiler::dump_and_reset(StreamOutput* stream, int top)
+{
+    stream->printf("event profiler is not built in, build with make EVENT_PROFILER=1\r\n");
+}
+
+#endif
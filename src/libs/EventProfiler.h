@@ -0,0 +1,71 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVENTPROFILER_H
+#define EVENTPROFILER_H
+
+#include "libs/Module.h"
+
+#ifdef EVENT_PROFILER
+#include "libs/LPC17xx/sLPC17xx.h"
+#include <stdint.h>
+#include <vector>
+#endif
+
+class StreamOutput;
+
+// Times the handler of each module for each event with the DWT cycle counter, to find the module that holds up the main
+// loop. It is only built when make is given EVENT_PROFILER=1, otherwise call_handler is the plain call and the rest is empty.
+// The time of a handler includes the events it calls and the interrupts that pre-empted it.
+class EventProfiler {
+    public:
+        static void dump_and_reset(StreamOutput* stream, int top);
+
+#ifdef EVENT_PROFILER
+        static void enable(bool on);
+        static void name_module(Module* module, const char* name);
+        static void add(Module* module, _EVENT_ENUM event);
+
+        static inline void call_handler(Module* module, _EVENT_ENUM event, void* argument) {
+            if(!enabled) {
+                (module->*kernel_callback_functions[event])(argument);
+                return;
+            }
+            uint32_t entry = DWT->CYCCNT;
+            (module->*kernel_callback_functions[event])(argument);
+            record(module, event, DWT->CYCCNT - entry);
+        }
+
+        static volatile bool enabled;
+
+    private:
+        struct stats_t {
+            Module*  module;
+            uint8_t  event;
+            uint32_t count;
+            uint32_t max;           // cycles
+            uint64_t total;
+        };
+
+        static void record(Module* module, _EVENT_ENUM event, uint32_t cycles);
+        static const char* module_name(Module* module);
+
+        // sorted by event then module, an entry is added when the module registers so none is added in an interrupt
+        static std::vector<stats_t> stats;
+        static std::vector<std::pair<Module*, const char*>> names;
+#else
+        static void enable(bool on) {}
+        static void name_module(Module* module, const char* name) {}
+        static void add(Module* module, _EVENT_ENUM event) {}
+
+        static inline void call_handler(Module* module, _EVENT_ENUM event, void* argument) {
+            (module->*kernel_callback_functions[event])(argument);
+        }
+#endif
+};
+
+#endif
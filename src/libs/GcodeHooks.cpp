@@ -0,0 +1,84 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "libs/GcodeHooks.h"
+#include "libs/Module.h"
+#include "libs/EventProfiler.h"
+#include "Gcode.h"
+
+#include <algorithm>
+
+// the codes that do not fit in a key are only seen by the modules that ask for every gcode
+#define max_code 0x7FFE
+
+void GcodeHooks::add_code(Module* module, char letter, unsigned int code)
+{
+    if(code > max_code) {
+        add(any_key, module);
+    } else {
+        add((letter == 'M' ? m_key : 0) | code, module);
+    }
+}
+
+void GcodeHooks::add(uint16_t key, Module* module)
+{
+    // a module keeps the place it had when it first asked for a gcode
+    uint16_t order = this->modules;
+    for (auto &h : hooks) {
+        if(h.module != module) continue;
+        if(h.key == key || h.key == any_key) return;
+        order = h.order;
+    }
+    if(order == this->modules) this->modules++;
+
+    hook_t hook = {key, order, module};
+    auto pos = std::upper_bound(hooks.begin(), hooks.end(), hook, [](const hook_t& a, const hook_t& b) {
+        return a.key < b.key || (a.key == b.key && a.order < b.order);
+    });
+    hooks.insert(pos, hook);
+}
+
+void GcodeHooks::find(uint16_t key, iterator& first, iterator& last) const
+{
+    hook_t hook = {key, 0, nullptr};
+    auto range = std::equal_range(hooks.begin(), hooks.end(), hook, [](const hook_t& a, const hook_t& b) { return a.key < b.key; });
+    first = range.first;
+    last = range.second;
+}
+
+void GcodeHooks::call(Gcode* gcode) const
+{
+    // the hooks for the G, for the M and for every gcode, each in the order of the modules
+    iterator first[3], last[3];
+    int n = 0;
+    if(gcode->has_g && gcode->g <= max_code) {
+        find(gcode->g, first[n], last[n]);
+        n++;
+    }
+    if(gcode->has_m && gcode->m <= max_code) {
+        find(m_key | gcode->m, first[n], last[n]);
+        n++;
+    }
+    find(any_key, first[n], last[n]);
+    n++;
+
+    // merged so a module that asked for both the G and the M of a line is called once, in its place
+    int called = -1;
+    while(true) {
+        int next = -1;
+        for (int i = 0; i < n; i++) {
+            if(first[i] != last[i] && (next < 0 || first[i]->order < first[next]->order)) next = i;
+        }
+        if(next < 0) break;
+
+        const hook_t &h = *first[next]++;
+        if(h.order != called) {
+            called = h.order;
+            EventProfiler::call_handler(h.module, ON_GCODE_RECEIVED, gcode);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GCODEHOOKS_H
+#define GCODEHOOKS_H
+
+#include <stdint.h>
+#include <vector>
+
+class Module;
+class Gcode;
+
+// The modules that are called for ON_GCODE_RECEIVED, looked up by the G or M code of the gcode.
+// A module either asks for single codes, or for every gcode, which it has to do when it handles lines with no G or M
+// like modal moves and tool changes. The modules are called in the order they first asked in, like the other events.
+class GcodeHooks {
+    public:
+        GcodeHooks() : modules(0) {}
+
+        void add_code(Module* module, char letter, unsigned int code);
+        void add_any(Module* module) { add(any_key, module); }
+        void call(Gcode* gcode) const;
+
+    private:
+        struct hook_t {
+            uint16_t key;       // the code, with m_key set for an M code
+            uint16_t order;     // of the module among those that have asked for gcodes
+            Module*  module;
+        };
+        typedef std::vector<hook_t>::const_iterator iterator;
+
+        static const uint16_t m_key   = 0x8000;
+        static const uint16_t any_key = 0xFFFF;
+
+        void add(uint16_t key, Module* module);
+        void find(uint16_t key, iterator& first, iterator& last) const;
+
+        // sorted by key, then by order
+        std::vector<hook_t> hooks;
+        uint16_t modules;
+};
+
+#endif
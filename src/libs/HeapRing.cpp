@@ -12,6 +12,7 @@ template<class kind> HeapRing<kind>::HeapRing()
 {
     head_i = tail_i = length = 0;
     ring = NULL;
+    provided = false;
 }
 
 template<class kind> HeapRing<kind>::HeapRing(unsigned int length)
@@ -20,6 +21,7 @@ template<class kind> HeapRing<kind>::HeapRing(unsigned int length)
     ring = new kind[length];
     // TODO: handle allocation failure
     this->length = length;
+    provided = false;
 }
 
 /*
@@ -29,7 +31,7 @@ template<class kind> HeapRing<kind>::HeapRing(unsigned int length)
 template<class kind> HeapRing<kind>::~HeapRing()
 {
     head_i = tail_i = length = 0;
-    if (ring)
+    if (ring && !provided)
         delete [] ring;
     ring = NULL;
 }
@@ -163,9 +165,10 @@ template<class kind> bool HeapRing<kind>::resize(unsigned int length)
 
                 __enable_irq();
 
-                if (ring)
+                if (ring && !provided)
                     delete [] ring;
                 ring = NULL;
+                provided = false;
 
                 return true;
             }
@@ -181,6 +184,7 @@ template<class kind> bool HeapRing<kind>::resize(unsigned int length)
         if (newring != NULL)
         {
             kind* oldring = ring;
+            bool oldprovided = provided;
 
             __disable_irq();
 
@@ -189,10 +193,11 @@ template<class kind> bool HeapRing<kind>::resize(unsigned int length)
                 ring = newring;
                 this->length = length;
                 head_i = tail_i = 0;
+                provided = false;
 
                 __enable_irq();
 
-                if (oldring)
+                if (oldring && !oldprovided)
                     delete [] oldring;
 
                 return true;
@@ -214,16 +219,18 @@ template<class kind> bool HeapRing<kind>::provide(kind* buffer, unsigned int len
     if (is_empty())
     {
         kind* oldring = ring;
+        bool oldprovided = provided;
 
         if ((buffer != NULL) && (length > 0))
         {
             ring = buffer;
             this->length = length;
             head_i = tail_i = 0;
+            provided = true;
 
             __enable_irq();
 
-            if (oldring)
+            if (oldring && !oldprovided)
                 delete [] oldring;
             return true;
         }
@@ -51,6 +51,7 @@ public:
      * int length - number of items in buffer (NOT size in bytes!)
      *
      * cause HeapRing to use a specific memory location instead of allocating its own
+     * the caller keeps ownership of the buffer, HeapRing never frees it
      *
      * returns true on success, or false if queue is not empty
      */
@@ -77,6 +78,7 @@ protected:
 
 private:
     kind* ring;
+    bool provided;  // ring came from provide(), so it is not ours to delete
 };
 
 #endif /* _HEAPRING_H */
@@ -0,0 +1,77 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IsrProfiler.h"
+#include "StreamOutput.h"
+
+#include <string.h>
+
+volatile bool IsrProfiler::enabled = false;
+isr_stats_t IsrProfiler::stats[ISR_COUNT];
+
+static const char* const isr_names[ISR_COUNT] = {"step", "unstep", "move finished", "acceleration", "slow ticker"};
+
+void IsrProfiler::reset(isr_stats_t& s)
+{
+    memset(&s, 0, sizeof(s));
+    s.min = UINT32_MAX;
+    s.jitter_min = UINT32_MAX;
+}
+
+// Start the cycle counter and clear the stats, the counter is left running when turned off
+void IsrProfiler::enable(bool on)
+{
+    if(on && !enabled) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+        for (int i = 0; i < ISR_COUNT; i++) {
+            reset(stats[i]);
+        }
+    }
+    enabled = on;
+}
+
+static void print_histogram(StreamOutput* stream, const char* name, const uint32_t* histogram)
+{
+    stream->printf("    %s:", name);
+    for (int i = 0; i < isr_histogram_bins; i++) {
+        if(histogram[i] != 0) stream->printf(" %s%lu:%lu", i == isr_histogram_bins - 1 ? ">=" : "", 1UL << i, (unsigned long)histogram[i]);
+    }
+    stream->printf("\r\n");
+}
+
+// Print the stats of every interrupt since the last dump, in cycles, and start over
+void IsrProfiler::dump_and_reset(StreamOutput* stream)
+{
+    if(!enabled) {
+        stream->printf("isr profiler is off, turn it on with isrstats on\r\n");
+        return;
+    }
+
+    for (int i = 0; i < ISR_COUNT; i++) {
+        // take a copy so the handler can not change it while it is printed
+        isr_stats_t s;
+        __disable_irq();
+        s = stats[i];
+        reset(stats[i]);
+        __enable_irq();
+
+        if(s.count == 0) {
+            stream->printf("%s: not run\r\n", isr_names[i]);
+            continue;
+        }
+        stream->printf("%s: %lu runs, time min %lu max %lu mean %lu cycles", isr_names[i],
+                       (unsigned long)s.count, (unsigned long)s.min, (unsigned long)s.max, (unsigned long)(s.total / s.count));
+        if(s.jitter_count > 0) {
+            stream->printf(", jitter min %lu max %lu mean %lu cycles",
+                           (unsigned long)s.jitter_min, (unsigned long)s.jitter_max, (unsigned long)(s.jitter_total / s.jitter_count));
+        }
+        stream->printf("\r\n");
+        print_histogram(stream, "time", s.histogram);
+        if(s.jitter_count > 0) print_histogram(stream, "jitter", s.jitter_histogram);
+    }
+}
@@ -0,0 +1,103 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ISRPROFILER_H
+#define ISRPROFILER_H
+
+#include "libs/LPC17xx/sLPC17xx.h"
+#include <stdint.h>
+
+class StreamOutput;
+
+// The interrupt handlers that are profiled
+enum isr_id_t {
+    ISR_STEP_TICK,          // TIMER0, StepTicker::TIMER0_IRQHandler
+    ISR_UNSTEP_TICK,        // TIMER1, StepTicker::unstep_tick
+    ISR_MOVE_FINISHED,      // PendSV, StepTicker::PendSV_IRQHandler
+    ISR_ACCELERATION_TICK,  // RIT, StepTicker::acceleration_tick
+    ISR_SLOW_TICK,          // TIMER2, SlowTicker::tick
+    ISR_COUNT
+};
+
+// bin n counts values of 2^n up to 2^(n+1)-1 cycles, the first bin also counts 0 and the last bin everything above
+#define isr_histogram_bins 16
+
+struct isr_stats_t {
+    uint32_t count;
+    uint32_t min, max;          // execution time in cycles, including any higher priority interrupt that pre-empted it
+    uint64_t total;
+    uint32_t jitter_min, jitter_max;    // change of the time between two entries from the previous one, in cycles
+    uint64_t jitter_total;
+    uint32_t jitter_count;
+    uint32_t last_entry;
+    uint32_t last_period;
+    uint32_t histogram[isr_histogram_bins];
+    uint32_t jitter_histogram[isr_histogram_bins];
+};
+
+// Measures the interrupt handlers with the DWT cycle counter
+class IsrProfiler {
+    public:
+        static void enable(bool on);
+        static bool is_enabled() { return enabled; }
+        static void dump_and_reset(StreamOutput* stream);
+
+        static inline void record(isr_id_t id, uint32_t entry, uint32_t exit) {
+            isr_stats_t &s = stats[id];
+            uint32_t t = exit - entry;
+            if(t < s.min) s.min = t;
+            if(t > s.max) s.max = t;
+            s.total += t;
+            s.histogram[bin(t)]++;
+
+            // the first entry has no period, the second no previous period to compare to
+            if(s.count > 0) {
+                uint32_t period = entry - s.last_entry;
+                if(s.count > 1) {
+                    uint32_t j = period > s.last_period ? period - s.last_period : s.last_period - period;
+                    if(j < s.jitter_min) s.jitter_min = j;
+                    if(j > s.jitter_max) s.jitter_max = j;
+                    s.jitter_total += j;
+                    s.jitter_count++;
+                    s.jitter_histogram[bin(j)]++;
+                }
+                s.last_period = period;
+            }
+            s.last_entry = entry;
+            s.count++;
+        }
+
+        static volatile bool enabled;
+
+    private:
+        static inline uint32_t bin(uint32_t cycles) {
+            uint32_t n = cycles == 0 ? 0 : 31 - __builtin_clz(cycles);
+            return n < isr_histogram_bins ? n : isr_histogram_bins - 1;
+        }
+        static void reset(isr_stats_t& s);
+
+        static isr_stats_t stats[ISR_COUNT];
+};
+
+// Profiles an interrupt handler from its construction to the end of the scope it is declared in
+// costs a load and a branch when the profiler is off
+class IsrProfile {
+    public:
+        IsrProfile(isr_id_t id) : id(id), on(IsrProfiler::enabled) {
+            if(on) entry = DWT->CYCCNT;
+        }
+        ~IsrProfile() {
+            if(on) IsrProfiler::record(id, entry, DWT->CYCCNT);
+        }
+
+    private:
+        isr_id_t id;
+        bool on;
+        uint32_t entry;
+};
+
+#endif
@@ -9,6 +9,7 @@
 #include "libs/Module.h"
 #include "libs/Config.h"
 #include "libs/nuts_bolts.h"
+#include "libs/utils.h"
 #include "libs/SlowTicker.h"
 #include "libs/Adc.h"
 #include "libs/StreamOutputPool.h"
@@ -17,6 +18,7 @@
 #include "ConfigValue.h"
 
 #include "libs/StepTicker.h"
+#include "libs/IsrProfiler.h"
 #include "libs/PublicData.h"
 #include "modules/communication/SerialConsole.h"
 #include "modules/communication/GcodeDispatch.h"
@@ -35,6 +37,13 @@
 #define base_stepping_frequency_checksum            CHECKSUM("base_stepping_frequency")
 #define microseconds_per_step_pulse_checksum        CHECKSUM("microseconds_per_step_pulse")
 #define acceleration_ticks_per_second_checksum      CHECKSUM("acceleration_ticks_per_second")
+#define port_batched_stepping_checksum              CHECKSUM("port_batched_stepping")
+#define step_ticker_engine_checksum                 CHECKSUM("step_ticker_engine")
+#define event_checksum                              CHECKSUM("event")
+#define bresenham_checksum                          CHECKSUM("bresenham")
+#define max_steps_per_tick_checksum                 CHECKSUM("max_steps_per_tick")
+#define isr_profiler_enable_checksum                CHECKSUM("isr_profiler_enable")
+#define event_profiler_enable_checksum              CHECKSUM("event_profiler_enable")
 
 Kernel* Kernel::instance;
 
@@ -85,11 +94,11 @@ Kernel::Kernel(){
         this->serial = new SerialConsole(USBTX, USBRX, this->config->value(uart0_checksum,baud_rate_setting_checksum)->by_default(DEFAULT_SERIAL_BAUD_RATE)->as_number());
     }
 
-    this->add_module( this->config );
-    this->add_module( this->serial );
+    this->add_module( this->config, "Config" );
+    this->add_module( this->serial, "SerialConsole" );
 
     // HAL stuff
-    add_module( this->slow_ticker = new SlowTicker());
+    add_module( this->slow_ticker = new SlowTicker(), "SlowTicker" );
 
     this->step_ticker = new StepTicker();
     this->adc = new Adc();
@@ -129,38 +138,79 @@ Kernel::Kernel(){
     this->step_ticker->set_reset_delay( microseconds_per_step_pulse );
     this->step_ticker->set_frequency( this->base_stepping_frequency );
     this->step_ticker->set_acceleration_ticks_per_second(acceleration_ticks_per_second); // must be set after set_frequency
+    this->step_ticker->set_port_batching(this->config->value(port_batched_stepping_checksum)->by_default(false)->as_bool());
+    // fixed steps at base_stepping_frequency, event schedules the timer for the next step of any motor,
+    // bresenham steps the other actuators of a block along with the one that makes the most steps
+    int engine_checksum = get_checksum(this->config->value(step_ticker_engine_checksum)->by_default("fixed")->as_string());
+    this->step_ticker->set_event_driven(engine_checksum == event_checksum);
+    this->step_ticker->set_bresenham(engine_checksum == bresenham_checksum);
+    // bursts of 2 or 4 steps in a tick of the fixed engine, for step rates above base_stepping_frequency
+    int max_steps_per_tick = this->config->value(max_steps_per_tick_checksum)->by_default(1)->as_number();
+    if( this->step_ticker->set_max_steps_per_tick(max_steps_per_tick) < max_steps_per_tick ){ // must be set after the engine
+        this->streams->printf("WARNING: max_steps_per_tick is %d instead of %d, it needs the fixed engine without port batching, and the step pulses of a burst with their gaps must fit in a tick\n",
+                              this->step_ticker->get_max_steps_per_tick(), max_steps_per_tick);
+    }
+
+    // can also be turned on and off with the isrstats command
+    IsrProfiler::enable(this->config->value(isr_profiler_enable_checksum)->by_default(false)->as_bool());
+    // and this with the eventstats command, when it has been built in
+    EventProfiler::enable(this->config->value(event_profiler_enable_checksum)->by_default(false)->as_bool());
 
     // Core modules
-    this->add_module( new GcodeDispatch() );
-    this->add_module( this->robot          = new Robot()         );
-    this->add_module( this->stepper        = new Stepper()       );
-    this->add_module( this->conveyor       = new Conveyor()      );
-    this->add_module( this->pauser         = new Pauser()        );
+    this->add_module( new GcodeDispatch(),                         "GcodeDispatch" );
+    this->add_module( this->robot          = new Robot(),          "Robot"         );
+    this->add_module( this->stepper        = new Stepper(),        "Stepper"       );
+    this->add_module( this->conveyor       = new Conveyor(),       "Conveyor"      );
+    this->add_module( this->pauser         = new Pauser(),         "Pauser"        );
 
     this->planner = new Planner();
 
 }
 
-// Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
-void Kernel::add_module(Module* module){
-    module->on_module_loaded();
-}
-
 // Adds a hook for a given module and event
 void Kernel::register_for_event(_EVENT_ENUM id_event, Module *mod){
+    EventProfiler::add(mod, id_event);
+    if(id_event == ON_GCODE_RECEIVED) {
+        this->gcode_hooks.add_any(mod);
+        return;
+    }
+    if(id_event == ON_CONSOLE_LINE_RECEIVED) {
+        this->console_hooks.add_any(mod);
+        return;
+    }
     this->hooks[id_event].push_back(mod);
 }
 
+// Adds a hook for ON_GCODE_RECEIVED of a single G or M code
+void Kernel::register_for_gcode(Module *mod, char letter, unsigned int code){
+    EventProfiler::add(mod, ON_GCODE_RECEIVED);
+    this->gcode_hooks.add_code(mod, letter, code);
+}
+
+// Adds a hook for ON_CONSOLE_LINE_RECEIVED of the lines that begin with a command
+void Kernel::register_for_command(Module *mod, const char *command){
+    EventProfiler::add(mod, ON_CONSOLE_LINE_RECEIVED);
+    this->console_hooks.add_command(mod, command);
+}
+
 // Call a specific event without arguments
 void Kernel::call_event(_EVENT_ENUM id_event){
     for (auto m : hooks[id_event]) {
-        (m->*kernel_callback_functions[id_event])(this);
+        EventProfiler::call_handler(m, id_event, this);
     }
 }
 
 // Call a specific event with an argument
 void Kernel::call_event(_EVENT_ENUM id_event, void * argument){
+    if(id_event == ON_GCODE_RECEIVED) {
+        this->gcode_hooks.call(static_cast<Gcode*>(argument));
+        return;
+    }
+    if(id_event == ON_CONSOLE_LINE_RECEIVED) {
+        this->console_hooks.call(static_cast<SerialMessage*>(argument));
+        return;
+    }
     for (auto m : hooks[id_event]) {
-        (m->*kernel_callback_functions[id_event])(argument);
+        EventProfiler::call_handler(m, id_event, argument);
     }
 }
@@ -11,6 +11,9 @@
 #define THEKERNEL Kernel::instance
 
 #include "Module.h"
+#include "GcodeHooks.h"
+#include "ConsoleHooks.h"
+#include "EventProfiler.h"
 #include <array>
 #include <vector>
 #include <string>
@@ -38,8 +41,15 @@ class Kernel {
         static Kernel* instance; // the Singleton instance of Kernel usable anywhere
         const char* config_override_filename(){ return "/sd/config-override"; }
 
-        void add_module(Module* module);
+        // We don't actually hold a list of modules we just call its on_module_loaded
+        // name labels the module in the eventstats report, it is not copied
+        void add_module(Module* module, const char* name = nullptr) {
+            EventProfiler::name_module(module, name);
+            module->on_module_loaded();
+        }
         void register_for_event(_EVENT_ENUM id_event, Module *module);
+        void register_for_gcode(Module *module, char letter, unsigned int code);
+        void register_for_command(Module *module, const char *command);
         void call_event(_EVENT_ENUM id_event);
         void call_event(_EVENT_ENUM id_event, void * argument);
 
@@ -67,6 +77,10 @@ class Kernel {
     private:
         // When a module asks to be called for a specific event ( a hook ), this is where that request is remembered
         std::array<std::vector<Module*>, NUMBER_OF_DEFINED_EVENTS> hooks;
+        // ON_GCODE_RECEIVED is not in hooks, it only calls the modules that asked for the code of the gcode
+        GcodeHooks gcode_hooks;
+        // nor is ON_CONSOLE_LINE_RECEIVED, a command only calls the modules that asked for it
+        ConsoleHooks console_hooks;
 
 };
 
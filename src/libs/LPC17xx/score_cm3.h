@@ -125,6 +125,7 @@
 
 /* Core Debug */
 #define CoreDebug_DEMCR_TRCENA (1 << 24)      /*!< DEMCR TRCENA enable          */
+#define DWT_CTRL_CYCCNTENA          1         /*!< DWT cycle counter enable     */
 #define ITM_TCR_ITMENA              1         /*!< ITM enable                   */
 
 
@@ -264,10 +265,24 @@ typedef struct
 } CoreDebug_Type;
 
 
+/* Data Watchpoint and Trace Register, up to the profiling counters */
+typedef struct
+{
+  __IO uint32_t CTRL;                         /*!< Control Register                                */
+  __IO uint32_t CYCCNT;                       /*!< Cycle Count Register                            */
+  __IO uint32_t CPICNT;                       /*!< CPI Count Register                              */
+  __IO uint32_t EXCCNT;                       /*!< Exception Overhead Count Register               */
+  __IO uint32_t SLEEPCNT;                     /*!< Sleep Count Register                            */
+  __IO uint32_t LSUCNT;                       /*!< LSU Count Register                              */
+  __IO uint32_t FOLDCNT;                      /*!< Folded-instruction Count Register               */
+} DWT_Type;
+
+
 /* Memory mapping of Cortex-M3 Hardware */
 #define SCS_BASE            (0xE000E000)                              /*!< System Control Space Base Address    */
 #define ITM_BASE            (0xE0000000)                              /*!< ITM Base Address                     */
 #define CoreDebug_BASE      (0xE000EDF0)                              /*!< Core Debug Base Address              */
+#define DWT_BASE            (0xE0001000)                              /*!< DWT Base Address                     */
 #define SysTick_BASE        (SCS_BASE +  0x0010)                      /*!< SysTick Base Address                 */
 #define NVIC_BASE           (SCS_BASE +  0x0100)                      /*!< NVIC Base Address                    */
 #define SCB_BASE            (SCS_BASE +  0x0D00)                      /*!< System Control Block Base Address    */
@@ -278,6 +293,7 @@ typedef struct
 #define NVIC                ((NVIC_Type *)          NVIC_BASE)        /*!< NVIC configuration struct            */
 #define ITM                 ((ITM_Type *)           ITM_BASE)         /*!< ITM configuration struct             */
 #define CoreDebug           ((CoreDebug_Type *)     CoreDebug_BASE)   /*!< Core Debug configuration struct      */
+#define DWT                 ((DWT_Type *)           DWT_BASE)         /*!< DWT configuration struct             */
 
 #if defined (__MPU_PRESENT) && (__MPU_PRESENT == 1)
   #define MPU_BASE          (SCS_BASE +  0x0D90)                      /*!< Memory Protection Unit               */
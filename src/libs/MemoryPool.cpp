@@ -63,6 +63,10 @@ void* MemoryPool::alloc(size_t nbytes)
     // start at the start
     _poolregion* p = ((_poolregion*) base);
 
+    // no allocation can be larger than the pool, this also keeps the size from overflowing
+    if (nbytes + sizeof(_poolregion) > size)
+        return NULL;
+
     // find the allocation size including our metadata
     uint16_t nsize = nbytes + sizeof(_poolregion);
 
@@ -108,7 +112,7 @@ void* MemoryPool::alloc(size_t nbytes)
         p = (_poolregion*) (((uint8_t*) p) + p->next);
 
         // make sure we don't walk off the end
-    } while (p <= (_poolregion*) (((uint8_t*)base) + size));
+    } while (p < (_poolregion*) (((uint8_t*)base) + size));
 
     // fell off the end of the region!
     return NULL;
@@ -37,3 +37,13 @@ void Module::register_for_event(_EVENT_ENUM event_id){
     // You add things to Smoothie by making a new class that inherits the Module class. See http://smoothieware.org/moduleexample for a crude introduction
     THEKERNEL->register_for_event(event_id, this);
 }
+
+void Module::register_for_gcode(char letter, unsigned int code){
+    // Most modules only handle a few G and M codes, this saves calling them for every line
+    THEKERNEL->register_for_gcode(this, letter, code);
+}
+
+void Module::register_for_command(const char *command){
+    // command must outlive the module, it is not copied
+    THEKERNEL->register_for_command(this, command);
+}
@@ -43,6 +43,10 @@ public:
     virtual void on_module_loaded() {};
 
     void register_for_event(_EVENT_ENUM event_id);
+    // on_gcode_received for this G or M code only, instead of register_for_event(ON_GCODE_RECEIVED) for every gcode
+    void register_for_gcode(char letter, unsigned int code);
+    // on_console_line_received for the lines that begin with this command, instead of every line
+    void register_for_command(const char *command);
 
     // event callbacks, not every module will implement all of these
     // there should be one for each _EVENT_ENUM
@@ -0,0 +1,82 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOTIONTRACE_H
+#define MOTIONTRACE_H
+
+#include "libs/LPC17xx/sLPC17xx.h"
+#include <stdint.h>
+
+// Binary trace of the motion events on the ITM stimulus ports, captured from the SWO pin with a debug probe
+// and decoded with sim/build/motiontrace. Nothing is written unless the probe has enabled the ITM and the port.
+// The ISRs can not wait for the SWO output, a record that finds the stimulus port FIFO full is dropped and counted,
+// the count is sent as a record of its own on the next acceleration tick so the decoder can tell the trace is incomplete.
+//
+// Each record is a single stimulus port write so records written at different interrupt levels can not be mixed up,
+// the port number is the record type. 32 bit records that are about an actuator have its index in the top 3 bits.
+#define MOTION_TRACE_STEP       1   // 8 bit: actuator, a step was output
+#define MOTION_TRACE_MOVE       2   // 32 bit: actuator, direction in bit 28, steps, a move was started
+#define MOTION_TRACE_RATE       3   // 32 bit: actuator, steps per second
+#define MOTION_TRACE_FINISHED   4   // 8 bit: actuator, its move has been finished
+#define MOTION_TRACE_BLOCK      5   // 32 bit: number of the block that begins, counted from reset
+#define MOTION_TRACE_BLOCK_END  6   // 32 bit: number of the block that all modules have released
+#define MOTION_TRACE_TIME       7   // 32 bit: DWT cycle counter, on every acceleration tick interrupt
+#define MOTION_TRACE_DROPPED    8   // 32 bit: records dropped since reset, when it has changed
+
+#define MOTION_TRACE_ACTUATOR_SHIFT 29
+#define MOTION_TRACE_DIRECTION_BIT  (1UL << 28)
+#define MOTION_TRACE_VALUE_MASK     ((1UL << MOTION_TRACE_ACTUATOR_SHIFT) - 1)
+
+// Records dropped because the FIFO was full. An increment interrupted by a higher priority ISR can be lost,
+// so this is a lower bound, but it is never 0 when records were dropped
+inline volatile uint32_t& motion_trace_dropped()
+{
+    static volatile uint32_t dropped;
+    return dropped;
+}
+
+// true if the port is enabled and its FIFO can take a write, counts the record as dropped if it can not
+static inline bool motion_trace_ready(int type)
+{
+    if((ITM->TCR & ITM_TCR_ITMENA) == 0 || (ITM->TER & (1UL << type)) == 0) return false;
+    if(ITM->PORT[type].u32 == 0) {
+        motion_trace_dropped()++;
+        return false;
+    }
+    return true;
+}
+
+static inline bool motion_trace(int type, uint8_t value)
+{
+    if(!motion_trace_ready(type)) return false;
+    ITM->PORT[type].u8 = value;
+    return true;
+}
+
+static inline bool motion_trace(int type, uint32_t value)
+{
+    if(!motion_trace_ready(type)) return false;
+    ITM->PORT[type].u32 = value;
+    return true;
+}
+
+static inline bool motion_trace(int type, int actuator, uint32_t value)
+{
+    if(!motion_trace_ready(type)) return false;
+    ITM->PORT[type].u32 = ((uint32_t)actuator << MOTION_TRACE_ACTUATOR_SHIFT) | (value & MOTION_TRACE_VALUE_MASK);
+    return true;
+}
+
+// Sends the dropped count if it changed since it was last sent
+static inline void motion_trace_report_dropped()
+{
+    static uint32_t reported;
+    uint32_t dropped = motion_trace_dropped();
+    if(dropped != reported && motion_trace(MOTION_TRACE_DROPPED, dropped)) reported = dropped;
+}
+
+#endif
@@ -12,6 +12,7 @@ using namespace std;
 #include "libs/Kernel.h"
 #include "SlowTicker.h"
 #include "StepTicker.h"
+#include "IsrProfiler.h"
 #include "libs/Hook.h"
 #include "modules/robot/Conveyor.h"
 #include "Pauser.h"
@@ -124,6 +125,7 @@ void SlowTicker::on_idle(void*)
 }
 
 extern "C" void TIMER2_IRQHandler (void){
+    IsrProfile profile(ISR_SLOW_TICK);
     if((LPC_TIM2->IR >> 0) & 1){  // If interrupt register set for MR0
         LPC_TIM2->IR |= 1 << 0;   // Reset it
     }
@@ -13,8 +13,11 @@
 #include "libs/Kernel.h"
 #include "StepperMotor.h"
 #include "StreamOutputPool.h"
+#include "IsrProfiler.h"
+#include "MotionTrace.h"
 #include "system_LPC17xx.h" // mbed.h lib
 #include <math.h>
+#include <string.h>
 #include <mri.h>
 
 #ifdef STEPTICKER_DEBUG_PIN
@@ -29,6 +32,15 @@ extern GPIO stepticker_debug_pin;
 
 StepTicker* StepTicker::global_step_ticker;
 
+// in event driven mode, the minimum number of timer counts between now and a match so it cannot be missed
+#define min_event_lead 25
+
+// the longest the step tick takes, in microseconds, see TIMER0_IRQHandler
+#define step_tick_isr_us 3.2F
+
+// GPIO ports indexed by Pin::port_number, used when step pins are batched per port
+static LPC_GPIO_TypeDef* const step_gpios[5] = {LPC_GPIO0, LPC_GPIO1, LPC_GPIO2, LPC_GPIO3, LPC_GPIO4};
+
 StepTicker::StepTicker(){
     StepTicker::global_step_ticker = this;
 
@@ -53,6 +65,10 @@ StepTicker::StepTicker(){
     LPC_RIT->RICTRL &= ~(8L); // disable
     //NVIC_SetVector(RIT_IRQn, (uint32_t)&_ritisr);
 
+    // the motion trace is timed by the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+
     // Default start values
     this->a_move_finished = false;
     this->do_move_finished = 0;
@@ -63,6 +79,18 @@ StepTicker::StepTicker(){
     this->num_motors= 0;
     this->active_motor.reset();
     this->tick_cnt= 0;
+    this->port_batching= false;
+    this->event_driven= false;
+    this->bresenham= false;
+    this->lead_motor= nullptr;
+    this->follower_motors= 0;
+    this->burst.reset();
+    this->max_steps_per_tick= 1;
+    this->burst_gap= false;
+    this->timer_frequency= SystemCoreClock/4; // SystemCoreClock/4 = Timer increments in a second
+    this->unstep_ports= 0;
+    memset(this->unstep_set, 0, sizeof(this->unstep_set));
+    memset(this->unstep_clr, 0, sizeof(this->unstep_clr));
 }
 
 StepTicker::~StepTicker() {
@@ -86,6 +114,76 @@ void StepTicker::set_frequency( uint32_t frequency ){
     }
 }
 
+// In event driven mode the timer runs freely and is matched against the time of the next step of any motor,
+// instead of ticking at the base stepping frequency
+void StepTicker::set_event_driven(bool enable)
+{
+    this->event_driven= enable;
+    if(enable) {
+        LPC_TIM0->MCR = 1;              // Match on MR0, do not reset
+    }else{
+        LPC_TIM0->MCR = 3;              // Match on MR0, reset on MR0
+        LPC_TIM0->MR0 = this->period;
+    }
+}
+
+// With the Bresenham engine the followers do not step at their own rate, they step along with the lead motor.
+// Set before their moves begin so none of them steps on its own meanwhile, nullptr when no block is running.
+void StepTicker::set_lead_motor(StepperMotor* lead, uint32_t followers)
+{
+    uint32_t primask= __get_PRIMASK();
+    __disable_irq();
+    this->lead_motor= lead;
+    this->follower_motors= followers;
+    __set_PRIMASK(primask);
+}
+
+// Let the fixed engine make up to steps pulses in a tick, for step rates above the base stepping frequency. The
+// pulses of a burst are as long and as far apart as the step pulse. A burst of n pulses has n - 1 gaps, and the last
+// pulse needs a gap too before the first pulse of the next tick, so it takes 2n step pulses of a tick with the time
+// of the step tick interrupt to spare.
+// Must be set after the frequency, the reset delay and the engine. Returns how many are allowed, 1, 2 or 4.
+uint8_t StepTicker::set_max_steps_per_tick(uint8_t steps)
+{
+    uint8_t n= 1;
+    if(!this->event_driven && !this->bresenham && !this->port_batching) {
+        uint32_t isr_time= ceilf(this->timer_frequency * (step_tick_isr_us / 1000000.0F));
+        while(n < 4 && n * 2 <= steps && 2 * n * LPC_TIM1->MR0 + isr_time <= this->period) n *= 2;
+    }
+    this->max_steps_per_tick= n;
+    return n;
+}
+
+// Convert a step rate, in 1/256 steps per second, into the number of timer counts between steps
+uint32_t StepTicker::rate_to_interval(uint32_t rate) const
+{
+    // a stopped motor steps so far in the future that it is not considered when scheduling
+    if(rate == 0) return 0x40000000;
+    return ((uint64_t)this->timer_frequency << STEP_RATE_SHIFT) / rate;
+}
+
+// Make sure the timer will fire in time for the next step of the given motor, may be called from any context
+void StepTicker::schedule_step(StepperMotor* motor)
+{
+    if(!this->active_motor[motor->index]) return;
+
+    uint32_t primask= __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t tc= LPC_TIM0->TC;
+    uint32_t mr= LPC_TIM0->MR0;
+    // it is too late to step in the past
+    if((int32_t)(motor->next_step_time - tc) < (int32_t)min_event_lead) {
+        motor->next_step_time= tc + min_event_lead;
+    }
+    // reprogram if this is the earliest step, once the match register has been passed the pending tick looks at every motor
+    if((int32_t)(motor->next_step_time - mr) < 0 && (int32_t)(mr - tc) > 0) {
+        LPC_TIM0->MR0 = motor->next_step_time;
+    }
+
+    __set_PRIMASK(primask);
+}
+
 // Set the reset delay
 void StepTicker::set_reset_delay( float microseconds ){
     uint32_t delay = floorf((SystemCoreClock/4.0F)*(microseconds/1000000.0F));  // SystemCoreClock/4 = Timer increments in a second
@@ -125,32 +223,98 @@ void StepTicker::signal_a_move_finished(){
     }
 }
 
+// Reset step pins a whole port at a time
+inline void StepTicker::batched_unstep_tick(){
+    uint8_t ports= this->unstep_ports;
+    this->unstep_ports= 0;
+    while(ports) {
+        int p= __builtin_ctz(ports);
+        ports &= ports - 1;
+        if(this->unstep_clr[p]) step_gpios[p]->FIOCLR = this->unstep_clr[p];
+        if(this->unstep_set[p]) step_gpios[p]->FIOSET = this->unstep_set[p];
+        this->unstep_clr[p]= 0;
+        this->unstep_set[p]= 0;
+    }
+}
+
 // Reset step pins on any motor that was stepped
 inline void StepTicker::unstep_tick(){
+    // the event driven and Bresenham engines step each motor itself
+    if(this->port_batching && !this->event_driven && !this->bresenham) {
+        batched_unstep_tick();
+        return;
+    }
+
+    // the gap after a pulse of a burst is over
+    if(this->burst_gap) {
+        this->burst_gap= false;
+        burst_step();
+        return;
+    }
+
     for (int i = 0; i < num_motors; i++) {
         if(this->unstep[i]){
             this->motor[i]->unstep();
         }
     }
     this->unstep.reset();
+
+    // the next pulses of the bursts are one step pulse later
+    if(this->burst.any()) {
+        this->burst_gap= true;
+        LPC_TIM1->TCR = 3;
+        LPC_TIM1->TCR = 1;
+    }
+}
+
+// Output the next pulse of every burst, and time its unstep
+void StepTicker::burst_step()
+{
+    for (int i = 0; i < num_motors; i++) {
+        if(!this->burst[i]) continue;
+        StepperMotor *motor= this->motor[i];
+        // a move that has finished drops the rest of its burst, unless it keeps moving into the next one
+        if(motor->moving && this->active_motor[i]) {
+            motor->step();
+            this->unstep[i]= 1;
+        }
+        if(--motor->burst_steps == 0 || !motor->moving) {
+            motor->burst_steps= 0;
+            this->burst[i]= 0;
+        }
+    }
+
+    if(this->unstep.any()) {
+        LPC_TIM1->TCR = 3;
+        LPC_TIM1->TCR = 1;
+    }
+
+    // a move that ends within a burst does not wait for the next step tick, which can be a whole step later
+    if(this->a_move_finished) signal_move_finished_pending();
 }
 
 extern "C" void TIMER1_IRQHandler (void){
+    IsrProfile profile(ISR_UNSTEP_TICK);
     LPC_TIM1->IR |= 1 << 0;
     StepTicker::global_step_ticker->unstep_tick();
 }
 
 // The actual interrupt handler where we do all the work
 extern "C" void TIMER0_IRQHandler (void){
+    IsrProfile profile(ISR_STEP_TICK);
     StepTicker::global_step_ticker->TIMER0_IRQHandler();
 }
 
 extern "C" void RIT_IRQHandler (void){
+    IsrProfile profile(ISR_ACCELERATION_TICK);
     LPC_RIT->RICTRL |= 1L;
+    motion_trace(MOTION_TRACE_TIME, (uint32_t)DWT->CYCCNT);
+    motion_trace_report_dropped();
     StepTicker::global_step_ticker->acceleration_tick();
 }
 
 extern "C" void PendSV_Handler(void) {
+    IsrProfile profile(ISR_MOVE_FINISHED);
     StepTicker::global_step_ticker->PendSV_IRQHandler();
 }
 
@@ -184,21 +348,37 @@ void StepTicker::TIMER0_IRQHandler (void){
     LPC_TIM0->IR |= 1 << 0;
     tick_cnt++; // count number of ticks
 
-    uint32_t freq = this->frequency;
-    // Step pins NOTE takes 1.2us when nothing to step, 1.8-2us for one motor stepped and 2.6us when two motors stepped, 3.167us when three motors stepped
-    for (uint32_t motor = 0; motor < num_motors; motor++){
-        // send tick to all active motors
-        if(this->active_motor[motor] && this->motor[motor]->tick(freq)){
-            // we stepped so schedule an unstep
-            this->unstep[motor]= 1;
+    bool stepped;
+    if(this->event_driven) {
+        stepped= event_tick();
+
+    }else if(this->bresenham) {
+        stepped= bresenham_tick();
+
+    }else if(this->max_steps_per_tick > 1) {
+        stepped= burst_tick();
+
+    }else if(this->port_batching) {
+        stepped= batched_tick();
+
+    }else{
+        uint32_t freq = this->frequency << STEP_RATE_SHIFT;
+        // Step pins NOTE takes 1.2us when nothing to step, 1.8-2us for one motor stepped and 2.6us when two motors stepped, 3.167us when three motors stepped
+        for (uint32_t motor = 0; motor < num_motors; motor++){
+            // send tick to all active motors
+            if(this->active_motor[motor] && this->motor[motor]->tick(freq)){
+                // we stepped so schedule an unstep
+                this->unstep[motor]= 1;
+            }
         }
+        stepped= this->unstep.any();
     }
 
     // We may have set a pin on in this tick, now we reset the timer to set it off
     // Note there could be a race here if we run another tick before the unsteps have happened,
     // right now it takes about 3-4us but if the unstep were near 10uS or greater it would be an issue
     // also it takes at least 2us to get here so even when set to 1us pulse width it will still be about 3us
-    if( this->unstep.any()){
+    if( stepped ){
         LPC_TIM1->TCR = 3;
         LPC_TIM1->TCR = 1;
     }
@@ -207,12 +387,22 @@ void StepTicker::TIMER0_IRQHandler (void){
     //     LPC_TIM1->TCR = 0; // disable interrupt, no point in it running if nothing to do
     // }
 
-    if(this->a_move_finished) {
-        this->a_move_finished= false;
+    signal_move_finished_pending();
+}
+
+// If a move finished, we have to tell the actuator to act accordingly.
+// The burst interrupt preempts this one and can take the last step of a move, so the flag is taken with interrupts off
+inline void StepTicker::signal_move_finished_pending()
+{
+    uint32_t primask= __get_PRIMASK();
+    __disable_irq();
+    bool finished= this->a_move_finished;
+    this->a_move_finished= false;
+    __set_PRIMASK(primask);
+    if(finished) {
         this->do_move_finished++; // Note this is an atomic variable because it is updated in two interrupts of different priorities so can be pre-empted
     }
 
-    // If a move finished in this tick, we have to tell the actuator to act accordingly
     if(this->do_move_finished.load() > 0){
         // we delegate the slow stuff to the pendsv handler which will run as soon as this interrupt exits
         //NVIC_SetPendingIRQ(PendSV_IRQn); this doesn't work
@@ -220,11 +410,176 @@ void StepTicker::TIMER0_IRQHandler (void){
     }
 }
 
+// Tick only the active motors, and output all the step pulses of a GPIO port with a single write.
+// The steps are accounted for once the pins are set, so the pulses are not held up by it
+// returns true if any motor stepped
+inline bool StepTicker::batched_tick()
+{
+    uint32_t set[5] = {0, 0, 0, 0, 0};
+    uint32_t clr[5] = {0, 0, 0, 0, 0};
+    uint8_t ports= 0;
+    uint32_t stepped= 0;
+    uint32_t freq = this->frequency << STEP_RATE_SHIFT;
+
+    uint32_t active= this->active_motor.to_ulong();
+    while(active) {
+        int m= __builtin_ctz(active);
+        active &= active - 1;
+        if(this->motor[m]->tick(freq, false)) {
+            stepped |= (1 << m);
+            const step_bit_t &b= this->step_bits[m];
+            if(b.inverting) clr[b.port] |= b.mask;
+            else set[b.port] |= b.mask;
+            ports |= (1 << b.port);
+        }
+    }
+
+    if(ports == 0) return false;
+
+    uint8_t p= ports;
+    while(p) {
+        int i= __builtin_ctz(p);
+        p &= p - 1;
+        if(set[i]) step_gpios[i]->FIOSET = set[i];
+        if(clr[i]) step_gpios[i]->FIOCLR = clr[i];
+        // the unstep does the opposite
+        this->unstep_clr[i] |= set[i];
+        this->unstep_set[i] |= clr[i];
+    }
+    this->unstep_ports |= ports;
+
+    while(stepped) {
+        int m= __builtin_ctz(stepped);
+        stepped &= stepped - 1;
+        this->motor[m]->step_taken();
+    }
+
+    return true;
+}
+
+// Step every motor whose step is due, then set the match register to the earliest pending step of any active motor.
+// A step too close to be matched in time is matched as soon as it can be instead, up to min_event_lead late, and
+// keeps its time so the steps after it are not late too
+// returns true if any motor stepped
+inline bool StepTicker::event_tick()
+{
+    bool stepped= false;
+    uint32_t now= LPC_TIM0->MR0; // the time this match was scheduled for
+
+    // the match register was moved after it had already matched, the step it was for is still to come
+    if((int32_t)(LPC_TIM0->TC - now) < 0) return false;
+
+    uint32_t next= now + 0x40000000;
+    uint32_t active= this->active_motor.to_ulong();
+    while(active) {
+        int m= __builtin_ctz(active);
+        active &= active - 1;
+        StepperMotor *motor= this->motor[m];
+        if((int32_t)(motor->next_step_time - now) <= 0) {
+            motor->tick_event();
+            this->unstep[m]= 1;
+            stepped= true;
+        }
+        if((int32_t)(motor->next_step_time - next) < 0) next= motor->next_step_time;
+    }
+
+    uint32_t earliest= LPC_TIM0->TC + min_event_lead;
+    LPC_TIM0->MR0 = ((int32_t)(next - earliest) > 0) ? next : earliest;
+
+    return stepped;
+}
+
+// Tick every active motor, one that is behind by more than a step makes them in a burst, the first pulse now and the
+// others from the unstep interrupt
+// returns true if any motor stepped
+inline bool StepTicker::burst_tick()
+{
+    uint32_t freq = this->frequency << STEP_RATE_SHIFT;
+
+    // The bursts of the last tick are not over when the unstep interrupt was held up. Restarting the unstep timer
+    // would cut them short and leave the new pulses to burst_step(), so the steps of this tick are added to the
+    // bursts instead, and output in the gaps that are still to come.
+    if(this->burst_gap || this->unstep.any()) {
+        for (uint32_t m = 0; m < num_motors; m++){
+            if(!this->active_motor[m]) continue;
+            StepperMotor *motor= this->motor[m];
+            uint8_t steps= motor->tick_burst(freq, this->max_steps_per_tick, false);
+            if(steps == 0) continue;
+            motor->burst_steps += steps;
+            this->burst[m]= 1;
+        }
+        return false;
+    }
+
+    for (uint32_t m = 0; m < num_motors; m++){
+        if(!this->active_motor[m]) continue;
+        StepperMotor *motor= this->motor[m];
+        uint8_t steps= motor->tick_burst(freq, this->max_steps_per_tick);
+        if(steps == 0) continue;
+        this->unstep[m]= 1;
+        if(steps > 1) {
+            motor->burst_steps= steps - 1;
+            this->burst[m]= 1;
+        }
+    }
+    return this->unstep.any();
+}
+
+// Tick the active motors that are not followers, and every time the lead motor steps add the steps of each follower
+// to its error term, which steps it once it is over half the steps of the lead. The followers then make exactly
+// their steps over the steps of the lead, with no rates of their own.
+// returns true if any motor stepped
+inline bool StepTicker::bresenham_tick()
+{
+    uint32_t freq = this->frequency << STEP_RATE_SHIFT;
+    StepperMotor *lead= this->lead_motor;
+    uint32_t followers= this->follower_motors & this->active_motor.to_ulong();
+
+    uint32_t active= this->active_motor.to_ulong() & ~followers;
+    while(active) {
+        int m= __builtin_ctz(active);
+        active &= active - 1;
+        StepperMotor *motor= this->motor[m];
+        if(!motor->tick(freq)) continue;
+        this->unstep[m]= 1;
+        if(motor != lead) continue;
+
+        int32_t half= lead->steps_to_move >> 1;
+        uint32_t f= followers;
+        while(f) {
+            int i= __builtin_ctz(f);
+            f &= f - 1;
+            StepperMotor *follower= this->motor[i];
+            follower->bresenham_error += follower->steps_to_move;
+            if(follower->bresenham_error > half && follower->moving) {
+                follower->bresenham_error -= lead->steps_to_move;
+                follower->step();
+                this->unstep[i]= 1;
+            }
+        }
+    }
+
+    return this->unstep.any();
+}
+
 // returns index of the stepper motor in the array and bitset
 int StepTicker::register_motor(StepperMotor* motor)
 {
     this->motor.push_back(motor);
     this->num_motors= this->motor.size();
+
+    // remember where the step pin is so it can be set together with the other pins on the same port
+    step_bit_t &b= this->step_bits[this->num_motors-1];
+    if(motor->step_pin.connected()) {
+        b.mask= 1U << motor->step_pin.pin;
+        b.port= motor->step_pin.port_number;
+        b.inverting= motor->step_pin.inverting;
+    }else{
+        b.mask= 0;
+        b.port= 0;
+        b.inverting= false;
+    }
+
     return this->num_motors-1;
 }
 
@@ -232,10 +587,20 @@ int StepTicker::register_motor(StepperMotor* motor)
 void StepTicker::add_motor_to_active_list(StepperMotor* motor)
 {
     bool enabled= active_motor.any(); // see if interrupt was previously enabled
+    bool was_active= active_motor[motor->index];
     active_motor[motor->index]= 1;
     if(!enabled) {
         LPC_TIM0->TCR = 1;               // Enable interrupt
     }
+
+    if(this->event_driven && !was_active) {
+        // first step is one interval from now at the current rate
+        motor->last_step_time= LPC_TIM0->TC;
+        motor->next_step_time= motor->last_step_time + motor->step_interval;
+        // nothing is scheduled while the timer was stopped
+        if(!enabled) LPC_TIM0->MR0 = motor->last_step_time + 0x40000000;
+        schedule_step(motor);
+    }
 }
 
 // Remove a stepper from the list of active motors
@@ -31,6 +31,17 @@ class StepTicker{
         void add_motor_to_active_list(StepperMotor* motor);
         void remove_motor_from_active_list(StepperMotor* motor);
         void set_acceleration_ticks_per_second(uint32_t acceleration_ticks_per_second);
+        void set_port_batching(bool enable) { port_batching= enable; }
+        void set_event_driven(bool enable);
+        bool is_event_driven() const { return event_driven; }
+        void set_bresenham(bool enable) { bresenham= enable; }
+        bool is_bresenham() const { return bresenham; }
+        void set_lead_motor(StepperMotor* lead, uint32_t followers);
+        uint8_t set_max_steps_per_tick(uint8_t steps);
+        uint8_t get_max_steps_per_tick() const { return max_steps_per_tick; }
+        uint32_t get_max_step_rate() const { return frequency * max_steps_per_tick; }
+        uint32_t rate_to_interval(uint32_t rate) const;
+        void schedule_step(StepperMotor* motor);
         uint32_t get_frequency() const { return frequency; }
         void unstep_tick();
         uint32_t get_tick_cnt() const { return tick_cnt; }
@@ -49,8 +60,17 @@ class StepTicker{
         friend class StepperMotor;
 
     private:
+        bool batched_tick();
+        bool event_tick();
+        bool bresenham_tick();
+        bool burst_tick();
+        void burst_step();
+        void signal_move_finished_pending();
+        void batched_unstep_tick();
+
         uint32_t frequency;
         uint32_t period;
+        uint32_t timer_frequency;
         volatile uint32_t tick_cnt;
         std::vector<std::function<void(void)>> acceleration_tick_handlers;
         std::vector<StepperMotor*> motor;
@@ -59,6 +79,29 @@ class StepTicker{
         std::atomic_uchar do_move_finished;
         uint8_t num_motors;
         volatile bool a_move_finished;
+
+        // used when step pins are output a whole GPIO port at a time
+        struct step_bit_t {
+            uint32_t mask;      // bit of the step pin in its port
+            uint8_t port;       // index of the GPIO port
+            bool inverting;
+        };
+        step_bit_t step_bits[32];
+        uint32_t unstep_set[5];     // per port, bits to set when unstepping (inverted step pins)
+        uint32_t unstep_clr[5];     // per port, bits to clear when unstepping
+        uint8_t unstep_ports;       // ports that have pending unsteps
+        bool port_batching;
+        bool event_driven;
+
+        // used by the Bresenham engine, the followers are a bit per motor index
+        bool bresenham;
+        StepperMotor* volatile lead_motor;
+        volatile uint32_t follower_motors;
+
+        // used when a motor can make more than one step in a tick of the fixed engine
+        std::bitset<32> burst;      // motors with pulses left of their burst
+        uint8_t max_steps_per_tick;
+        volatile bool burst_gap;    // the unstep timer is timing the gap before the next pulses
 };
 
 
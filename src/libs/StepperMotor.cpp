@@ -9,10 +9,11 @@
 #include "Kernel.h"
 #include "MRI_Hooks.h"
 #include "StepTicker.h"
+#include "MotionTrace.h"
 
 #include <math.h>
 
-// in steps/sec the default minimum speed (was 20steps/sec hardcoded)
+// in 1/256 steps/sec the default minimum speed (was 20steps/sec hardcoded)
 uint32_t StepperMotor::default_minimum_actuator_rate = 0;
 
 // A StepperMotor represents an actual stepper motor. It is used to generate steps that move the actual motor at a given speed
@@ -42,7 +43,12 @@ void StepperMotor::init()
     this->stepped = 0;
     this->steps_to_move = 0;
     this->tickcount = 0;
-    this->steps_per_second = 0;
+    this->rate = 0;
+    this->step_interval = THEKERNEL->step_ticker->rate_to_interval(0);
+    this->next_step_time = 0;
+    this->last_step_time = 0;
+    this->bresenham_error = 0;
+    this->burst_steps = 0;
     this->is_move_finished = true; // No move initially => same as finished
     
     steps_per_mm         = 1.0F;
@@ -60,11 +66,17 @@ void StepperMotor::init()
 // This is in highest priority interrupt so cannot be pre-empted
 void StepperMotor::step()
 {
-    ITM->PORT[this->index].u8 = 'S';
-    
     // output to pins 37t
     this->step_pin.set( 1 );
 
+    this->step_taken();
+}
+
+// Account for a step that has been output on the step pin, either by step() or by the StepTicker
+void StepperMotor::step_taken()
+{
+    motion_trace(MOTION_TRACE_STEP, (uint8_t)this->index);
+
     // we have moved a step 9t
     this->stepped++;
 
@@ -98,7 +110,7 @@ void StepperMotor::step()
 // If the move is finished, the StepTicker will call this ( because we asked it to in tick() )
 void StepperMotor::signal_move_finished()
 {
-    ITM->PORT[this->index].u8 = 'F';
+    motion_trace(MOTION_TRACE_FINISHED, (uint8_t)this->index);
     
     // signal it to whatever cares
     // in this call a new block may start, new moves set and new speeds
@@ -129,8 +141,6 @@ StepperMotor* StepperMotor::move( bool direction, unsigned int steps, uint32_t i
     // Disable irqs to prevent steps while we change values
     __disable_irq();
     
-    ITM->PORT[this->index].u8 = 'M';
-    
     // Take into account any predicted steps that were taken between previous move end and
     // the call of this function.
     if (this->is_move_finished && this->moving && this->stepped > this->steps_to_move)
@@ -166,6 +176,8 @@ StepperMotor* StepperMotor::move( bool direction, unsigned int steps, uint32_t i
     this->direction = direction;
     this->steps_to_move = steps;
     this->keep_moving = false;
+    this->bresenham_error = 0;
+    motion_trace(MOTION_TRACE_MOVE, this->index, (direction ? MOTION_TRACE_DIRECTION_BIT : 0) | steps);
     
     // Set initial rate for new move
     if (steps > stepped) {
@@ -186,17 +198,28 @@ StepperMotor* StepperMotor::move( bool direction, unsigned int steps, uint32_t i
     return this;
 }
 
-// Set the speed at which this stepper moves in steps/sec.
+// Set the speed at which this stepper moves in 1/256 steps/sec.
 StepperMotor* StepperMotor::set_rate( uint32_t rate )
 {
-    ITM->PORT[this->index].u8 = 'R';
-    
     if(rate < default_minimum_actuator_rate) {
         rate = default_minimum_actuator_rate;
     }
+    motion_trace(MOTION_TRACE_RATE, this->index, rate >> STEP_RATE_SHIFT);
 
     // How many steps we must output per second
-    this->steps_per_second = rate;
+    this->rate = rate;
+
+    if(THEKERNEL->step_ticker->is_event_driven()) {
+        // the next step is due one interval after the previous one at the new rate. The step interrupt must not
+        // step this motor between the two writes, it would miss the new time or step from a stale one
+        uint32_t interval = THEKERNEL->step_ticker->rate_to_interval(rate);
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        this->step_interval = interval;
+        this->next_step_time = this->last_step_time + interval;
+        if(this->moving) THEKERNEL->step_ticker->schedule_step(this);
+        __set_PRIMASK(primask);
+    }
 
     return this;
 }
@@ -18,6 +18,10 @@
 class StepTicker;
 class Hook;
 
+// Step rates are in 1/256 steps per second (Q24.8), so slow moves are not quantized to whole steps per second
+#define STEP_RATE_SHIFT 8
+#define STEP_RATE_ONE   (1 << STEP_RATE_SHIFT)
+
 class StepperMotor {
     public:
         StepperMotor();
@@ -25,11 +29,13 @@ class StepperMotor {
         ~StepperMotor();
 
         void step();
+        void step_taken();
         inline void unstep() { step_pin.set(0); };
 
         inline void enable(bool state) { en_pin.set(!state); };
 
         bool is_moving() { return moving; }
+        bool is_paused() const { return paused; }
         void move_finished();
         StepperMotor* move( bool direction, unsigned int steps, uint32_t initial_rate = 0);
         void signal_move_finished();
@@ -37,7 +43,7 @@ class StepperMotor {
         void pause();
         void unpause();
 
-        uint32_t get_steps_per_second()  const { return steps_per_second; }
+        uint32_t get_steps_per_second()  const { return rate >> STEP_RATE_SHIFT; }
         float get_steps_per_mm()  const { return steps_per_mm; }
         void change_steps_per_mm(float);
         void change_last_milestone(float);
@@ -51,8 +57,9 @@ class StepperMotor {
         uint32_t get_steps_to_move() const { return steps_to_move; }
         uint32_t get_stepped() const { return stepped; }
 
+        // in 1/256 steps per second
         StepperMotor* set_rate( uint32_t rate );
-        inline uint32_t get_rate() const { return steps_per_second; }
+        inline uint32_t get_rate() const { return rate; }
         
         template<typename T> void attach( T *optr, uint32_t ( T::*fptr )( uint32_t ) ){
             Hook* hook = new Hook();
@@ -75,7 +82,7 @@ class StepperMotor {
         Pin dir_pin;
         Pin en_pin;
 
-        uint32_t steps_per_second;
+        uint32_t rate; // in 1/256 steps per second
         float steps_per_mm;
         float max_rate; // this is not really rate it is in mm/sec, misnamed used in Robot and Extruder
         static uint32_t default_minimum_actuator_rate;
@@ -89,6 +96,17 @@ class StepperMotor {
         uint32_t signal_step;
 
         uint32_t tickcount;
+
+        // used by the event driven StepTicker, in timer counts
+        uint32_t step_interval;
+        uint32_t next_step_time;
+        uint32_t last_step_time;
+
+        // used by the Bresenham StepTicker when this motor follows another one
+        int32_t bresenham_error;
+
+        // pulses left of the burst the StepTicker is making, when the rate is above its frequency
+        uint8_t burst_steps;
         
         struct {
             bool direction:1;
@@ -99,18 +117,45 @@ class StepperMotor {
         };
 
         // Called a great many times per second, to step if we have to now
-        inline bool tick(uint32_t frequency) {
-            tickcount += steps_per_second;
+        // frequency is the tick frequency in 1/256 ticks per second, like the rate
+        // if step_now is false the caller outputs the step pulse, then calls step_taken()
+        inline bool tick(uint32_t frequency, bool step_now= true) {
+            tickcount += rate;
             
             if (tickcount > frequency)
             {
                 tickcount -= frequency;
-                step();
+                if (step_now) step();
                 return true;
             }
             
             return false;
         };
+
+        // Like tick(), for a StepTicker that can make up to max steps in a tick. Returns the number of steps due,
+        // only the first is output here, or none if step_now is false. A rate above max steps per tick is clipped.
+        inline uint8_t tick_burst(uint32_t frequency, uint8_t max, bool step_now= true) {
+            tickcount += rate;
+            if (tickcount <= frequency)
+                return 0;
+
+            uint8_t steps = 0;
+            do {
+                tickcount -= frequency;
+                steps++;
+            } while (tickcount > frequency && steps < max);
+            if (tickcount > frequency)
+                tickcount = frequency;
+            if (step_now) step();
+            return steps;
+        };
+
+        // Called by the event driven StepTicker when the next step of this motor is due
+        inline void tick_event() {
+            last_step_time = next_step_time;
+            next_step_time += step_interval;
+            step();
+        };
 };
 
 #endif
@@ -15,6 +15,9 @@ int StreamOutput::printf(const char *format, ...)
     if (size < 64) {
         buffer = b;
     } else {
+        // the first vsnprintf used up args
+        va_end(args);
+        va_start(args, format);
         buffer = new char[size];
         vsnprintf(buffer, size, format, args);
     }
@@ -0,0 +1,104 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "decimal.h"
+
+#include <stdlib.h>
+#include <ctype.h>
+
+// every power of ten up to 10^10 is exact in a float, 5^10 has less than 24 bits
+static const float powers_of_ten[] = {1e0F, 1e1F, 1e2F, 1e3F, 1e4F, 1e5F, 1e6F, 1e7F, 1e8F, 1e9F, 1e10F};
+
+float decimal_strtof(const char *str, char **endptr)
+{
+    const char *p = str;
+    while(isspace((unsigned char)*p)) p++;
+
+    bool negative = (*p == '-');
+    if(*p == '-' || *p == '+') p++;
+
+    // the digits, without the leading zeros, as an integer and the number of them after the decimal point
+    uint32_t mantissa = 0;
+    int significant = 0, decimals = 0;
+    bool digits = false, point = false;
+    for (;; p++) {
+        if(*p >= '0' && *p <= '9') {
+            digits = true;
+            if(point) decimals++;
+            if(mantissa != 0 || *p != '0') {
+                if(++significant > 9) return strtof(str, endptr);
+                mantissa = mantissa * 10 + (*p - '0');
+            }
+        } else if(*p == '.' && !point) {
+            point = true;
+        } else {
+            break;
+        }
+    }
+
+    // an exponent, a hex number, inf or nan
+    if(!digits || *p == 'e' || *p == 'E' || *p == 'x' || *p == 'X') return strtof(str, endptr);
+
+    while(decimals > 10 && mantissa % 10 == 0) {
+        mantissa /= 10;
+        decimals--;
+    }
+    // both are exact floats so the division is rounded correctly, like strtof does
+    if(mantissa > (1UL << 24) || decimals > 10) return strtof(str, endptr);
+
+    if(endptr != nullptr) *endptr = (char *)p;
+    float r = (float)mantissa / powers_of_ten[decimals];
+    return negative ? -r : r;
+}
+
+int32_t decimal_strtofixed(const char *str, int decimals, char **endptr)
+{
+    const char *p = str;
+    while(isspace((unsigned char)*p)) p++;
+
+    bool negative = (*p == '-');
+    if(*p == '-' || *p == '+') p++;
+
+    // 64 bits so the saturation is only needed once
+    const int64_t limit = (int64_t)INT32_MAX + 1;
+    int64_t value = 0;
+    int fraction = -1;          // digits after the decimal point, -1 before it
+    bool digits = false, round_up = false;
+    for (;; p++) {
+        if(*p >= '0' && *p <= '9') {
+            digits = true;
+            if(fraction < decimals) {
+                if(value <= limit) value = value * 10 + (*p - '0');
+                if(fraction >= 0) fraction++;
+            } else if(fraction == decimals) {
+                // the first digit that is dropped rounds
+                round_up = (*p >= '5');
+                fraction++;
+            }
+        } else if(*p == '.' && fraction < 0) {
+            fraction = 0;
+        } else {
+            break;
+        }
+    }
+
+    if(!digits) {
+        if(endptr != nullptr) *endptr = (char *)str;
+        return 0;
+    }
+    if(endptr != nullptr) *endptr = (char *)p;
+
+    // scale up when there were fewer decimals than asked for
+    for (int i = fraction < 0 ? 0 : fraction; i < decimals && value <= limit; i++) {
+        value *= 10;
+    }
+    if(round_up) value++;
+    if(negative) value = -value;
+    if(value > INT32_MAX) return INT32_MAX;
+    if(value < INT32_MIN) return INT32_MIN;
+    return value;
+}
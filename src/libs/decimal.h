@@ -0,0 +1,23 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <stdint.h>
+
+// Parsers for the numbers of gcode and config files, a sign, digits and a decimal point.
+
+// Same result and end as strtof, bit for bit. Numbers with up to 9 significant digits and 10 decimals are converted
+// with integer math and a single float division, anything else (exponents, inf, hex, long numbers) is left to strtof.
+float decimal_strtof(const char *str, char **endptr);
+
+// The number times 10^decimals, rounded half away from zero and saturated to the int32_t range. There is no exponent,
+// the end is the first character that is not part of a sign, digits and a decimal point.
+int32_t decimal_strtofixed(const char *str, int decimals, char **endptr);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <stdint.h>
+
+// Integer math for the interrupts and the planner. The LPC1768 has no FPU, so every float operation there is a library
+// call, while the M3 multiplies 32x32 into 64 bits and divides 32 bits in a few cycles. A 64 bit divide is a library
+// call too, but a shift and subtract loop without any of the unpacking and rounding of a float one.
+
+// The largest integer whose square is at most x, one bit of the root per iteration
+static inline uint32_t isqrt32(uint32_t x)
+{
+    if (x == 0) return 0;
+    uint32_t root = 0;
+    uint32_t bit = 1UL << ((31 - __builtin_clz(x)) & ~1);
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static inline uint32_t isqrt64(uint64_t x)
+{
+    if ((x >> 32) == 0) return isqrt32(x);
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << ((63 - __builtin_clzll(x)) & ~1);
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// a * b, or UINT64_MAX when that does not fit
+static inline uint64_t mul_saturate64(uint64_t a, uint32_t b)
+{
+    uint64_t hi = (a >> 32) * b;
+    uint64_t lo = (a & 0xFFFFFFFF) * b;
+    if ((hi >> 32) != 0) return UINT64_MAX;
+    uint64_t product = (hi << 32) + lo;
+    return (product < lo) ? UINT64_MAX : product;
+}
+
+// a * b / c rounded down, or UINT32_MAX when that does not fit in 32 bits. a * b saturates, see mul_saturate64(), which
+// only makes a difference when c is above 2^32
+static inline uint32_t muldiv(uint64_t a, uint32_t b, uint64_t c)
+{
+    uint64_t q = mul_saturate64(a, b) / c;
+    return (q > UINT32_MAX) ? UINT32_MAX : q;
+}
+
+// a * b / c rounded up, like muldiv()
+static inline uint32_t muldiv_ceil(uint64_t a, uint32_t b, uint64_t c)
+{
+    uint64_t product = mul_saturate64(a, b);
+    uint64_t q = product / c + (product % c != 0);
+    return (q > UINT32_MAX) ? UINT32_MAX : q;
+}
+
+// 1/d for dividing by d with a multiply and a shift, see reciprocal(). The division is made once, when d is known,
+// and the M3 has no instruction for it, so it is a library call that does not belong in an interrupt that runs often.
+struct reciprocal_t {
+    uint32_t value;     // 2^(31 + shift) / d, rounded down, less than 2^32
+    uint8_t shift;      // d < 2^shift
+};
+
+static inline reciprocal_t reciprocal(uint32_t d)
+{
+    reciprocal_t r;
+    if (d == 0) {
+        r.value = 0;
+        r.shift = 1;
+        return r;
+    }
+    r.shift = 32 - __builtin_clz(d);
+    r.value = (((uint64_t)1 << (31 + r.shift)) - 1) / d;
+    return r;
+}
+
+// x / d in units of 2^-32, for x < d, at most 4 units below the exact fraction
+static inline uint32_t fraction(uint32_t x, const reciprocal_t &r)
+{
+    return ((uint64_t)x * r.value) >> (r.shift - 1);
+}
+
+// a * f / 2^32 rounded down, from two 32x32 bit multiplies
+static inline uint64_t mulfrac64(uint64_t a, uint32_t f)
+{
+    return (a >> 32) * f + (((a & 0xFFFFFFFF) * f) >> 32);
+}
+
+// Step rate at position x, when it should be v1 at x1 and v2 at x2 on a constant acceleration ramp. The rate squared
+// is linear in the position, so the squares are interpolated and the root taken, rounded down like the float
+// version did. The squares fit in 64 bits for any rate, the step ticker can not go above 2^32 steps per second.
+// r is reciprocal(x2 - x1), so a tick only multiplies and shifts.
+static inline uint32_t quadratic_interpolate(uint32_t x, uint32_t x1, uint32_t v1, uint32_t x2, uint32_t v2, const reciprocal_t &r)
+{
+    if (x <= x1)
+        return v1;
+    else if (x >= x2)
+        return v2;
+
+    uint64_t y1 = (uint64_t)v1 * v1;
+    uint64_t y2 = (uint64_t)v2 * v2;
+    uint32_t f = fraction(x - x1, r);
+    uint64_t y;
+    if (y2 >= y1)
+        y = y1 + mulfrac64(y2 - y1, f);
+    else
+        y = y1 - mulfrac64(y1 - y2, f);
+    return isqrt64(y);
+}
+
+#endif
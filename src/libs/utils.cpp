@@ -10,6 +10,7 @@
 #include "system_LPC17xx.h"
 #include "LPC17xx.h"
 #include "utils.h"
+#include "decimal.h"
 
 #include <string>
 #include <cstring>
@@ -146,8 +147,8 @@ bool file_exists( const string file_name )
     FILE *lp = fopen(file_name.c_str(), "r");
     if(lp) {
         exists = true;
+        fclose(lp);
     }
-    fclose(lp);
     return exists;
 }
 
@@ -222,7 +223,7 @@ vector<float> parse_number_list(const char *str)
     vector<string> l= split(str, ',');
     vector<float> r;
     for(auto& s : l) {
-        float x = strtof(s.c_str(), nullptr);
+        float x = decimal_strtof(s.c_str(), nullptr);
         r.push_back(x);
     }
     return r;
@@ -131,13 +131,13 @@ void init() {
 
 
     // Create and add main modules
-    kernel->add_module( new SimpleShell() );
-    kernel->add_module( new Configurator() );
-    kernel->add_module( new CurrentControl() );
-    kernel->add_module( new PauseButton() );
-    kernel->add_module( new PlayLed() );
-    kernel->add_module( new Endstops() );
-    kernel->add_module( new Player() );
+    kernel->add_module( new SimpleShell(), "SimpleShell" );
+    kernel->add_module( new Configurator(), "Configurator" );
+    kernel->add_module( new CurrentControl(), "CurrentControl" );
+    kernel->add_module( new PauseButton(), "PauseButton" );
+    kernel->add_module( new PlayLed(), "PlayLed" );
+    kernel->add_module( new Endstops(), "Endstops" );
+    kernel->add_module( new Player(), "Player" );
 
 
     // these modules can be completely disabled in the Makefile by adding to EXCLUDE_MODULES
@@ -161,32 +161,32 @@ void init() {
     kernel->temperature_control_pool= new TemperatureControlPool(); // so we can get just an empty temperature control array
     #endif
     #ifndef NO_TOOLS_LASER
-    kernel->add_module( new Laser() );
+    kernel->add_module( new Laser(), "Laser" );
     #endif
     #ifndef NO_TOOLS_SPINDLE
-    kernel->add_module( new Spindle() );
+    kernel->add_module( new Spindle(), "Spindle" );
     #endif
     #ifndef NO_UTILS_PANEL
-    kernel->add_module( new Panel() );
+    kernel->add_module( new Panel(), "Panel" );
     #endif
     #ifndef NO_TOOLS_TOUCHPROBE
-    kernel->add_module( new Touchprobe() );
+    kernel->add_module( new Touchprobe(), "Touchprobe" );
     #endif
     #ifndef NO_TOOLS_ZPROBE
-    kernel->add_module( new ZProbe() );
+    kernel->add_module( new ZProbe(), "ZProbe" );
     #endif
     #ifndef NO_TOOLS_SCARACAL
-    kernel->add_module( new SCARAcal() );
+    kernel->add_module( new SCARAcal(), "SCARAcal" );
     #endif
     #ifndef NONETWORK
-    kernel->add_module( new Network() );
+    kernel->add_module( new Network(), "Network" );
     #endif
     #ifndef NO_TOOLS_TEMPERATURESWITCH
     // Must be loaded after TemperatureControlPool
-    kernel->add_module( new TemperatureSwitch() );
+    kernel->add_module( new TemperatureSwitch(), "TemperatureSwitch" );
     #endif
     #ifndef NO_TOOLS_DRILLINGCYCLES
-    kernel->add_module( new Drillingcycles() );
+    kernel->add_module( new Drillingcycles(), "Drillingcycles" );
     #endif
 
     // Create and initialize USB stuff
@@ -194,21 +194,21 @@ void init() {
 
 #ifdef DISABLEMSD
     if(sdok && msc != NULL){
-        kernel->add_module( msc );
+        kernel->add_module( msc, "USBMSD" );
     }
 #else
-    kernel->add_module( &msc );
+    kernel->add_module( &msc, "USBMSD" );
 #endif
 
-    kernel->add_module( &usbserial );
+    kernel->add_module( &usbserial, "USBSerial" );
     if( kernel->config->value( second_usb_serial_enable_checksum )->by_default(false)->as_bool() ){
-        kernel->add_module( new(AHB0) USBSerial(&u) );
+        kernel->add_module( new(AHB0) USBSerial(&u), "USBSerial" );
     }
 
     if( kernel->config->value( dfu_enable_checksum )->by_default(false)->as_bool() ){
-        kernel->add_module( new(AHB0) DFU(&u));
+        kernel->add_module( new(AHB0) DFU(&u), "DFU" );
     }
-    kernel->add_module( &u );
+    kernel->add_module( &u, "USB" );
 
     // clear up the config cache to save some memory
     kernel->config->config_cache_clear();
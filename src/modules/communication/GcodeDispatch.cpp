@@ -20,6 +20,10 @@
 #include "Config.h"
 #include "checksumm.h"
 #include "ConfigValue.h"
+#include "decimal.h"
+
+#include <string.h>
+#include <stdlib.h>
 
 #define return_error_on_unhandled_gcode_checksum    CHECKSUM("return_error_on_unhandled_gcode")
 
@@ -54,11 +58,23 @@ void GcodeDispatch::on_halt(void *arg)
     this->halted= (arg == nullptr);
 }
 
-// When a command is received, if it is a Gcode, dispatch it as an object via an event
+// Position of the first of the characters in the first length characters of str, or length if there is none
+static size_t find_first_of(const char *str, size_t length, const char *characters)
+{
+    size_t i = 0;
+    while(i < length && strchr(characters, str[i]) == NULL) i++;
+    return i;
+}
+
+// When a command is received, if it is a Gcode, dispatch it as an object via an event.
+// The line is not copied, possible_command and length are a view of it that is narrowed as the checksum, line number and
+// comments are stripped. Each command in it is passed to the Gcode constructor, which makes the only copy.
 void GcodeDispatch::on_console_line_received(void *line)
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(line);
-    string possible_command = new_message.message;
+    SerialMessage &new_message = *static_cast<SerialMessage *>(line);
+    const char *possible_command = new_message.message.c_str();
+    size_t length = new_message.message.size();
+    string pycam_command; // only for a line in pycam syntax, see the end
 
     int ln = 0;
     int cs = 0;
@@ -66,37 +82,36 @@ void GcodeDispatch::on_console_line_received(void *line)
 try_again:
 
     char first_char = possible_command[0];
-    unsigned int n;
     if ( first_char == 'G' || first_char == 'M' || first_char == 'T' || first_char == 'N' ) {
 
         //Get linenumber
         if ( first_char == 'N' ) {
-            Gcode full_line = Gcode(possible_command, new_message.stream, false);
-            ln = (int) full_line.get_value('N');
-            int chksum = (int) full_line.get_value('*');
+            ln = (int) decimal_strtof(possible_command + 1, nullptr);
+            size_t chkpos = find_first_of(possible_command, length, "*");
+            int chksum = chkpos < length ? (int) decimal_strtof(possible_command + chkpos + 1, nullptr) : 0;
 
             //Catch message if it is M110: Set Current Line Number
-            if ( full_line.has_m ) {
-                if ( full_line.m == 110 ) {
-                    currentline = ln;
-                    new_message.stream->printf("ok\r\n");
-                    return;
-                }
+            size_t m = find_first_of(possible_command, length, "M");
+            if ( m < length && strtol(possible_command + m + 1, nullptr, 10) == 110 ) {
+                currentline = ln;
+                new_message.stream->printf("ok\r\n");
+                return;
             }
 
             //Strip checksum value from possible_command
-            size_t chkpos = possible_command.find_first_of("*");
-            possible_command = possible_command.substr(0, chkpos);
             //Calculate checksum
-            if ( chkpos != string::npos ) {
-                for (auto c = possible_command.cbegin(); *c != '*' && c != possible_command.cend(); c++)
-                    cs = cs ^ *c;
+            if ( chkpos < length ) {
+                for (size_t i = 0; i < chkpos; i++)
+                    cs = cs ^ possible_command[i];
                 cs &= 0xff;  // Defensive programming...
                 cs -= chksum;
             }
+            length = chkpos;
             //Strip line number value from possible_command
-            size_t lnsize = possible_command.find_first_not_of("N0123456789.,- ");
-            possible_command = possible_command.substr(lnsize);
+            size_t lnsize = 0;
+            while(lnsize < length && strchr("N0123456789.,- ", possible_command[lnsize]) != NULL) lnsize++;
+            possible_command += lnsize;
+            length -= lnsize;
 
         } else {
             //Assume checks succeeded
@@ -105,10 +120,7 @@ try_again:
         }
 
         //Remove comments
-        size_t comment = possible_command.find_first_of(";(");
-        if( comment != string::npos ) {
-            possible_command = possible_command.substr(0, comment);
-        }
+        length = find_first_of(possible_command, length, ";(");
 
         //If checksum passes then process message, else request resend
         int nextline = currentline + 1;
@@ -117,21 +129,19 @@ try_again:
                 currentline = nextline;
             }
 
-            while(possible_command.size() > 0) {
-                size_t nextcmd = possible_command.find_first_of("GM", possible_command.find_first_of("GM") + 1);
-                string single_command;
-                if(nextcmd == string::npos) {
-                    single_command = possible_command;
-                    possible_command = "";
-                } else {
-                    single_command = possible_command.substr(0, nextcmd);
-                    possible_command = possible_command.substr(nextcmd);
-                }
+            while(length > 0) {
+                // a command ends where the G or M of the next one begins
+                size_t first = find_first_of(possible_command, length, "GM");
+                size_t nextcmd = first < length ? first + 1 + find_first_of(possible_command + first + 1, length - first - 1, "GM") : length;
+                const char *single_command = possible_command;
+                size_t single_length = nextcmd;
+                possible_command += nextcmd;
+                length -= nextcmd;
 
 
                 if(!uploading) {
                     //Prepare gcode for dispatch
-                    Gcode *gcode = new Gcode(single_command, new_message.stream);
+                    Gcode *gcode = new Gcode(single_command, single_length, new_message.stream);
 
                     if(halted) {
                         // we ignore all commands until M999, unless it is in the exceptions list (like M105 get temp)
@@ -157,7 +167,7 @@ try_again:
                             case 28: // start upload command
                                 delete gcode;
 
-                                this->upload_filename = "/sd/" + single_command.substr(4); // rest of line is filename
+                                this->upload_filename = "/sd/" + (single_length > 4 ? string(single_command + 4, single_length - 4) : string()); // rest of line is filename
                                 // open file
                                 upload_fd = fopen(this->upload_filename.c_str(), "w");
                                 if(upload_fd != NULL) {
@@ -233,7 +243,7 @@ try_again:
 
                 } else {
                     // we are uploading a file so save it
-                    if(single_command.substr(0, 3) == "M29") {
+                    if(single_length >= 3 && strncmp(single_command, "M29", 3) == 0) {
                         // done uploading, close file
                         fclose(upload_fd);
                         upload_fd = NULL;
@@ -249,9 +259,8 @@ try_again:
                         continue;
                     }
 
-                    single_command.append("\n");
                     static int cnt = 0;
-                    if(fwrite(single_command.c_str(), 1, single_command.size(), upload_fd) != single_command.size()) {
+                    if(fwrite(single_command, 1, single_length, upload_fd) != single_length || fputc('\n', upload_fd) == EOF) {
                         // error writing to file
                         new_message.stream->printf("Error:error writing to file.\r\n");
                         fclose(upload_fd);
@@ -259,7 +268,7 @@ try_again:
                         continue;
 
                     } else {
-                        cnt += single_command.size();
+                        cnt += single_length + 1;
                         if (cnt > 400) {
                             // HACK ALERT to get around fwrite corruption close and re open for append
                             fclose(upload_fd);
@@ -277,7 +286,7 @@ try_again:
             new_message.stream->printf("rs N%d\r\n", nextline);
         }
 
-    } else if( (n=possible_command.find_first_of("XYZF")) == 0 || (first_char == ' ' && n != string::npos) ) {
+    } else if( find_first_of(possible_command, length, "XYZF") == 0 || (first_char == ' ' && find_first_of(possible_command, length, "XYZF") < length) ) {
         // handle pycam syntax, use last G0 or G1 and resubmit if an X Y Z or F is found on its own line
         if(last_g != 0 && last_g != 1) {
             //if no last G1 or G0 ignore
@@ -286,7 +295,10 @@ try_again:
         }
         char buf[6];
         snprintf(buf, sizeof(buf), "G%d ", last_g);
-        possible_command.insert(0, buf);
+        pycam_command = buf;
+        pycam_command.append(possible_command, length);
+        possible_command = pycam_command.c_str();
+        length = pycam_command.size();
         goto try_again;
 
         // Ignore comments and blank lines
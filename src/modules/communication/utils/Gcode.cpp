@@ -9,35 +9,97 @@
 #include "Gcode.h"
 #include "libs/StreamOutput.h"
 #include "utils.h"
+#include "decimal.h"
+#include "platform_memory.h"
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
+#include <utility>
+
+#define GCODE_WORDS 27 // A to Z and *
+
+// The storage of a gcode is a reference count followed by its values and command. A storage that fits in a slot is
+// taken from a pool of slots in AHB SRAM, so the gcode of every line and the copies attached to blocks do not go
+// through the heap, a larger one or one that finds the pool empty is malloced.
+// Gcodes are only created, copied and destroyed in the main loop, so neither the counts nor the pool need locking
+#define GCODE_STORE_SLOT_SIZE 64
+#define GCODE_STORE_SLOTS 48
+
+static uint8_t *store_slots;        // nullptr if AHB0 had no room for the pool
+static int32_t store_free_slot= -1; // each free slot begins with the index of the next one
+static bool store_ready = false;
+
+static inline int32_t &store_next_slot(int32_t slot)
+{
+    return *(int32_t *)(store_slots + slot * GCODE_STORE_SLOT_SIZE);
+}
+
+static void *store_alloc(size_t size)
+{
+    if(!store_ready) {
+        store_ready = true;
+        store_slots = (uint8_t *)AHB0.alloc(GCODE_STORE_SLOTS * GCODE_STORE_SLOT_SIZE);
+        for (int32_t i = GCODE_STORE_SLOTS - 1; store_slots != nullptr && i >= 0; i--) {
+            store_next_slot(i) = store_free_slot;
+            store_free_slot = i;
+        }
+    }
+
+    if(size <= GCODE_STORE_SLOT_SIZE && store_free_slot >= 0) {
+        int32_t slot = store_free_slot;
+        store_free_slot = store_next_slot(slot);
+        return store_slots + slot * GCODE_STORE_SLOT_SIZE;
+    }
+    return malloc(size);
+}
+
+static void store_free(void *p)
+{
+    if(store_slots != nullptr && (uint8_t *)p >= store_slots && (uint8_t *)p < store_slots + GCODE_STORE_SLOTS * GCODE_STORE_SLOT_SIZE) {
+        int32_t slot = ((uint8_t *)p - store_slots) / GCODE_STORE_SLOT_SIZE;
+        store_next_slot(slot) = store_free_slot;
+        store_free_slot = slot;
+    } else {
+        free(p);
+    }
+}
+
+// The reference count of the storage of values
+static inline uint32_t &references(float *values)
+{
+    return *((uint32_t *)values - 1);
+}
 
 // This is a gcode object. It reprensents a GCode string/command, an caches some important values about that command for the sake of performance.
 // It gets passed around in events, and attached to the queue ( that'll change )
-Gcode::Gcode(const string &command, StreamOutput *stream, bool strip)
+// The command is the first length characters of the string, the numbers are parsed from the string so the character
+// after the command must not continue a number, like the G, M, * or ; that end commands in a line do not
+Gcode::Gcode(const char *command, size_t length, StreamOutput *stream, bool strip)
 {
-    this->command= strdup(command.c_str());
     this->m= 0;
     this->g= 0;
     this->add_nl= false;
     this->stream= stream;
     this->millimeters_of_travel = 0.0F;
     this->accepted_by_module = false;
-    prepare_cached_values(strip);
+    prepare_cached_values(command, length, strip);
     this->stripped= strip;
 }
 
 Gcode::~Gcode()
 {
-    if(command != nullptr) {
-        // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
-        free(command);
-    }
+    release();
 }
 
+// A copy shares the storage of the values and command
 Gcode::Gcode(const Gcode &to_copy)
 {
-    this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+    this->values                = to_copy.values;
+    this->command               = to_copy.command;
+    if(this->values != nullptr) references(this->values)++;
+    this->words                 = to_copy.words;
+    this->num_args              = to_copy.num_args;
+    this->stripped              = to_copy.stripped;
     this->millimeters_of_travel = to_copy.millimeters_of_travel;
     this->has_m                 = to_copy.has_m;
     this->has_g                 = to_copy.has_g;
@@ -49,10 +111,35 @@ Gcode::Gcode(const Gcode &to_copy)
     this->txt_after_ok.assign( to_copy.txt_after_ok );
 }
 
+Gcode::Gcode(Gcode &&to_move) noexcept : txt_after_ok(std::move(to_move.txt_after_ok))
+{
+    this->values                = to_move.values;
+    this->command               = to_move.command;
+    to_move.values              = nullptr;
+    to_move.command             = nullptr;
+    this->words                 = to_move.words;
+    this->num_args              = to_move.num_args;
+    this->stripped              = to_move.stripped;
+    this->millimeters_of_travel = to_move.millimeters_of_travel;
+    this->has_m                 = to_move.has_m;
+    this->has_g                 = to_move.has_g;
+    this->m                     = to_move.m;
+    this->g                     = to_move.g;
+    this->add_nl                = to_move.add_nl;
+    this->stream                = to_move.stream;
+    this->accepted_by_module    = to_move.accepted_by_module;
+}
+
 Gcode &Gcode::operator= (const Gcode &to_copy)
 {
     if( this != &to_copy ) {
-        this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+        if(to_copy.values != nullptr) references(to_copy.values)++;
+        release();
+        this->values                = to_copy.values;
+        this->command               = to_copy.command;
+        this->words                 = to_copy.words;
+        this->num_args              = to_copy.num_args;
+        this->stripped              = to_copy.stripped;
         this->millimeters_of_travel = to_copy.millimeters_of_travel;
         this->has_m                 = to_copy.has_m;
         this->has_g                 = to_copy.has_g;
@@ -66,120 +153,151 @@ Gcode &Gcode::operator= (const Gcode &to_copy)
     return *this;
 }
 
+// A storage with room for count values and their offsets followed by a command of length characters, referenced by
+// this gcode only
+void Gcode::allocate(int count, size_t length)
+{
+    uint32_t *storage= (uint32_t *)store_alloc(sizeof(uint32_t) + count * (sizeof(float) + sizeof(uint16_t)) + length + 1);
+    *storage= 1;
+    this->values= (float *)(storage + 1);
+    this->command= (char *)((uint16_t *)(this->values + count) + count);
+}
+
+// Drop the reference to the storage, the last gcode that referenced it frees it
+void Gcode::release()
+{
+    if(this->values != nullptr && --references(this->values) == 0) {
+        store_free(&references(this->values));
+    }
+    this->values= nullptr;
+    this->command= nullptr;
+}
+
+// The bit of a letter in words, -1 if it is not a word
+int Gcode::word_index(char letter)
+{
+    if(letter >= 'A' && letter <= 'Z') return letter - 'A';
+    if(letter == '*') return GCODE_WORDS - 1;
+    return -1;
+}
 
 // Whether or not a Gcode has a letter
 bool Gcode::has_letter( char letter ) const
 {
-    for (size_t i = 0; i < strlen(this->command); ++i) {
-        if( command[i] == letter ) {
-            return true;
-        }
-    }
-    return false;
+    int i = word_index(letter);
+    return i >= 0 && (words & (1UL << i)) != 0;
 }
 
-// Retrieve the value for a given letter
-float Gcode::get_value( char letter, char **ptr ) const
-{
-    const char *cs = command;
-    char *cn = NULL;
-    for (; *cs; cs++) {
-        if( letter == *cs ) {
-            cs++;
-            float r = strtof(cs, &cn);
-            if(ptr != nullptr) *ptr= cn;
-            if (cn > cs)
-                return r;
-        }
-    }
-    if(ptr != nullptr) *ptr= nullptr;
-    return 0;
+// The index of the value of a letter, -1 if the gcode does not have it
+int Gcode::value_index( char letter ) const
+{
+    int i = word_index(letter);
+    if(i < 0 || (words & (1UL << i)) == 0) return -1;
+    // values are in letter order, so the index is the number of letters before this one
+    return __builtin_popcount(words & ((1UL << i) - 1));
 }
 
-int Gcode::get_int( char letter, char **ptr ) const
+// Retrieve the value for a given letter
+float Gcode::get_value( char letter ) const
 {
-    const char *cs = command;
-    char *cn = NULL;
-    for (; *cs; cs++) {
-        if( letter == *cs ) {
-            cs++;
-            int r = strtol(cs, &cn, 10);
-            if(ptr != nullptr) *ptr= cn;
-            if (cn > cs)
-                return r;
-        }
-    }
-    if(ptr != nullptr) *ptr= nullptr;
-    return 0;
+    int n = value_index(letter);
+    return n < 0 ? 0 : values[n];
 }
 
-uint32_t Gcode::get_uint( char letter, char **ptr ) const
+// Integers are parsed from the text, a float can not hold every 32 bit value, e.g. the plane M561 saves with M500
+int Gcode::get_int( char letter ) const
 {
-    const char *cs = command;
-    char *cn = NULL;
-    for (; *cs; cs++) {
-        if( letter == *cs ) {
-            cs++;
-            int r = strtoul(cs, &cn, 10);
-            if(ptr != nullptr) *ptr= cn;
-            if (cn > cs)
-                return r;
-        }
-    }
-    if(ptr != nullptr) *ptr= nullptr;
-    return 0;
+    int n = value_index(letter);
+    return n < 0 ? 0 : strtol(command + offsets()[n], nullptr, 10);
 }
 
-int Gcode::get_num_args() const
+uint32_t Gcode::get_uint( char letter ) const
 {
-    int count = 0;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        if( this->command[i] >= 'A' && this->command[i] <= 'Z' ) {
-            if(this->command[i] == 'T') continue;
-            count++;
-        }
-    }
-    return count;
+    int n = value_index(letter);
+    return n < 0 ? 0 : strtoul(command + offsets()[n], nullptr, 10);
 }
 
 std::map<char,float> Gcode::get_args() const
 {
     std::map<char,float> m;
-    for(size_t i = stripped?0:1; i < strlen(command); i++) {
-        char c= this->command[i];
-        if( c >= 'A' && c <= 'Z' ) {
-            if(c == 'T') continue;
-            m[c]= get_value(c);
-        }
+    int n = 0;
+    for(int i = 0; i < GCODE_WORDS; i++) {
+        if((words & (1UL << i)) == 0) continue;
+        char c= 'A' + i;
+        // the G or M of a line that is not stripped is not an argument
+        if(c <= 'Z' && c != 'T' && (stripped || c != command[0])) m[c]= values[n];
+        n++;
     }
     return m;
 }
 
-// Cache some of this command's properties, so we don't have to parse the string every time we want to look at them
-void Gcode::prepare_cached_values(bool strip)
+// Cache some of this command's properties, so we don't have to parse the string every time we want to look at them.
+// Every letter of the line is a word, its value is the number that follows the first of its occurences that has one.
+// When stripping, the Gxxx or Mxxx is removed from the line with everything before it.
+void Gcode::prepare_cached_values(const char *line, size_t length, bool strip)
 {
-    char *p= nullptr;
-    if( this->has_letter('G') ) {
-        this->has_g = true;
-        this->g = this->get_int('G', &p);
-    } else {
-        this->has_g = false;
-    }
-    if( this->has_letter('M') ) {
-        this->has_m = true;
-        this->m = this->get_int('M', &p);
-    } else {
-        this->has_m = false;
-    }
+    float table[GCODE_WORDS];
+    const char *text[GCODE_WORDS];  // where the value of each word is, or would be
+    uint32_t numbers = 0;           // the words that have their value
+    const char *start = line;       // where the command begins once stripped
+    this->words = 0;
+    this->num_args = 0;
+    this->has_g = false;
+    this->has_m = false;
+    bool g_found = false, m_found = false;
 
-    if(!strip) return;
+    const char *end = line + length;
+    for (const char *cs = line; cs < end; cs++) {
+        int i = word_index(*cs);
+        if(i < 0) continue;
 
-    // remove the Gxxx or Mxxx from string
-    if (p != nullptr) {
-        char *n= strdup(p); // create new string starting at end of the numeric value
-        free(command);
-        command= n;
+        if((*cs == 'G' && !g_found) || (*cs == 'M' && !m_found)) {
+            char *cn;
+            int r = strtol(cs + 1, &cn, 10);
+            if(*cs == 'G') this->has_g = true; else this->has_m = true;
+            if(cn > cs + 1) {
+                if(*cs == 'G') { this->g = r; g_found = true; } else { this->m = r; m_found = true; }
+                // an M wins over a G that came before it, like the Gcode dispatcher an M after a G starts a new command
+                if(strip && (*cs == 'M' || !this->has_m)) {
+                    start = cn;
+                    this->words = 0;
+                    numbers = 0;
+                    this->num_args = 0;
+                    cs = cn - 1;
+                    continue;
+                }
+            }
+        }
+
+        // the first character of a line that is not stripped is its G or M
+        if(*cs != '*' && *cs != 'T' && (strip || cs > line)) this->num_args++;
+
+        uint32_t bit = 1UL << i;
+        if((numbers & bit) == 0) {
+            char *cn;
+            float r = decimal_strtof(cs + 1, &cn);
+            if(cn > cs + 1) {
+                numbers |= bit;
+                table[i] = r;
+            } else {
+                table[i] = 0;
+            }
+            text[i] = cs + 1;
+        }
+        this->words |= bit;
+    }
+
+    allocate(__builtin_popcount(this->words), end - start);
+    uint16_t *offsets = this->offsets();
+    int n = 0;
+    for (int i = 0; i < GCODE_WORDS; i++) {
+        if(this->words & (1UL << i)) {
+            offsets[n] = text[i] - start;
+            this->values[n++] = table[i];
+        }
     }
+    memcpy(this->command, start, end - start);
+    this->command[end - start] = '\0';
 }
 
 void Gcode::mark_as_taken()
@@ -187,35 +305,74 @@ void Gcode::mark_as_taken()
     this->accepted_by_module = true;
 }
 
-// strip off X Y Z I J K parameters if G0/1/2/3
+// strip off X Y Z I J K parameters if G0/1/2/3, into a storage of its own
 void Gcode::strip_parameters()
 {
-    if(has_g && g < 4){
-        // strip the command of the XYZIJK parameters
-        string newcmd;
-        char *cn= command;
-        // find the start of each parameter
-        char *pch= strpbrk(cn, "XYZIJK");
+    uint32_t stripped_words= this->words;
+    for(char c : {'X', 'Y', 'Z', 'I', 'J', 'K'}) stripped_words &= ~(1UL << word_index(c));
+
+    if(has_g && g < 4 && stripped_words != this->words){
+        // find the XYZIJK parameters, the start and end of each run of them in command
+        std::pair<size_t, size_t> cuts[GCODE_WORDS];
+        int ncuts= 0;
+        int removed= 0;
+        size_t length= strlen(command), new_length= length;
+        char *pch= strpbrk(command, "XYZIJK");
         while (pch != nullptr) {
-            if(pch > cn) {
-                // copy non parameters to new string
-                newcmd.append(cn, pch-cn);
-            }
             // find the end of the parameter and its value
             char *eos;
-            strtof(pch+1, &eos);
-            cn= eos; // point to end of last parameter
-            pch= strpbrk(cn, "XYZIJK"); // find next parameter
+            decimal_strtof(pch+1, &eos);
+            size_t start= pch - command, end= eos - command;
+            removed++;
+            new_length-= end - start;
+            if(ncuts > 0 && cuts[ncuts - 1].second == start) {
+                cuts[ncuts - 1].second= end;
+            } else if(ncuts < GCODE_WORDS) {
+                cuts[ncuts++]= std::make_pair(start, end);
+            } else {
+                return; // only a line that repeats its letters has more, it is kept whole
+            }
+            pch= strpbrk(eos, "XYZIJK"); // find next parameter
         }
-        // append anything left on the line
-        newcmd.append(cn);
-
-        // strip whitespace to save even more, this causes problems so don't do it
-        //newcmd.erase(std::remove_if(newcmd.begin(), newcmd.end(), ::isspace), newcmd.end());
 
-        // release the old one
-        free(command);
-        // copy the new shortened one
-        command= strdup(newcmd.c_str());
+        // copy the new shortened one, dropping their values too, old keeps the full one until then
+        const Gcode old= *this;
+        release();
+        allocate(__builtin_popcount(stripped_words), new_length);
+        // the stripped command is what is left between the cuts, never longer than the old one
+        char *cn= this->command;
+        size_t from= 0;
+        for (int c = 0; c < ncuts; c++) {
+            memcpy(cn, old.command + from, cuts[c].first - from);
+            cn+= cuts[c].first - from;
+            from= cuts[c].second;
+        }
+        memcpy(cn, old.command + from, length - from);
+        cn[length - from]= '\0';
+        this->words= stripped_words;
+        uint16_t *offsets= this->offsets(), *old_offsets= old.offsets();
+        int n= 0, k= 0;
+        uint8_t order[GCODE_WORDS]; // the kept words in the order of their text
+        for (int i = 0; i < GCODE_WORDS; i++) {
+            if(old.words & (1UL << i)) {
+                if(stripped_words & (1UL << i)) {
+                    offsets[k]= old_offsets[n];
+                    this->values[k]= old.values[n];
+                    int j= k++;
+                    for (; j > 0 && offsets[order[j - 1]] > offsets[k - 1]; j--) order[j]= order[j - 1];
+                    order[j]= k - 1;
+                }
+                n++;
+            }
+        }
+        // the text of the words that are kept moves back by what was removed before it
+        int c= 0;
+        size_t shift= 0;
+        for (int j = 0; j < k; j++) {
+            uint16_t &offset= offsets[order[j]];
+            for (; c < ncuts && cuts[c].second <= offset; c++) shift+= cuts[c].second - cuts[c].first;
+            offset-= shift;
+        }
+        this->num_args-= removed;
     }
 }
@@ -10,6 +10,7 @@
 #define GCODE_H
 #include <string>
 #include <map>
+#include <stdint.h>
 
 using std::string;
 
@@ -18,17 +19,19 @@ class StreamOutput;
 // Object to represent a Gcode command
 class Gcode {
     public:
-        Gcode(const string&, StreamOutput*, bool strip=true);
+        Gcode(const string& command, StreamOutput* stream, bool strip=true) : Gcode(command.c_str(), command.size(), stream, strip) {}
+        Gcode(const char* command, size_t length, StreamOutput*, bool strip=true);
         Gcode(const Gcode& to_copy);
+        Gcode(Gcode&& to_move) noexcept;
         Gcode& operator= (const Gcode& to_copy);
         ~Gcode();
 
         const char* get_command() const { return command; }
         bool has_letter ( char letter ) const;
-        float get_value ( char letter, char **ptr= nullptr ) const;
-        int get_int ( char letter, char **ptr= nullptr ) const;
-        uint32_t get_uint ( char letter, char **ptr= nullptr ) const;
-        int get_num_args() const;
+        float get_value ( char letter ) const;
+        int get_int ( char letter ) const;
+        uint32_t get_uint ( char letter ) const;
+        int get_num_args() const { return num_args; }
         std::map<char,float> get_args() const;
         void mark_as_taken();
         void strip_parameters();
@@ -50,7 +53,20 @@ class Gcode {
         string txt_after_ok;
 
     private:
-        void prepare_cached_values(bool strip=true);
+        void prepare_cached_values(const char *line, size_t length, bool strip=true);
+        void allocate(int count, size_t length);
+        void release();
+        static int word_index(char letter);
+        int value_index(char letter) const;
+        uint16_t *offsets() const { return (uint16_t *)(values + __builtin_popcount(words)); }
+
+        // The line is parsed once into a table of its words. A word is a letter or the checksum *, the letters of words
+        // are bits in words and their values are kept in letter order in values, a letter without a value has 0.
+        // The offsets in command of the text after each letter follow the values, so integers are parsed exactly.
+        // Copies share the storage of values, offsets and command, which is never changed once written
+        uint32_t words;
+        float *values;                  // the storage values, offsets and command share, after its reference count
         char *command;
+        uint8_t num_args;
 };
 #endif
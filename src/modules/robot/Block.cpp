@@ -9,6 +9,7 @@
 #include "libs/Kernel.h"
 #include "libs/nuts_bolts.h"
 #include <math.h>
+#include <stdlib.h>
 #include <string>
 #include "Block.h"
 #include "Planner.h"
@@ -16,11 +17,19 @@
 #include "Gcode.h"
 #include "libs/StreamOutputPool.h"
 #include "Stepper.h"
+#include "StepperMotor.h"
+#include "MotionTrace.h"
+#include "platform_memory.h"
+#include "fixedpoint.h"
 
 #include "mri.h"
 
 using std::string;
-#include <vector>
+#include <utility>
+#include <new>
+
+// number of the block that is executing, for the motion trace
+static uint32_t block_number = 0;
 
 // A block represents a movement, it's length for each stepper motor, and the corresponding acceleration curves.
 // It's stacked on a queue, and that queue is then executed in order, to move the motors.
@@ -29,6 +38,8 @@ using std::string;
 
 Block::Block()
 {
+    first_gcode = BlockGcodes::none;
+    plan_version = 0;
     clear();
 }
 
@@ -36,19 +47,21 @@ void Block::clear()
 {
     //commands.clear();
     //travel_distances.clear();
-    gcodes.clear();
-    std::vector<Gcode>().swap(gcodes); // this resizes the vector releasing its memory
+    if (has_gcodes())
+        THEKERNEL->conveyor->gcodes.remove(first_gcode);
+    first_gcode = last_gcode = BlockGcodes::none;
 
     clear_vector(this->steps);
 
     steps_event_count   = 0;
     nominal_rate        = 0;
-    nominal_speed       = 0.0F;
-    millimeters         = 0.0F;
-    entry_speed         = 0.0F;
-    exit_speed          = 0.0F;
-    rate_delta          = 0.0F;
-    acceleration        = 100.0F; // we don't want to get devide by zeroes if this is not set
+    rate_limit          = 0;
+    nominal_speed       = 0;
+    millimeters         = 0;
+    entry_speed         = 0;
+    exit_speed          = 0;
+    rate_delta          = 0;
+    acceleration        = 100 * MM_ONE; // we don't want to get devide by zeroes if this is not set
     initial_rate        = -1;
     final_rate          = -1;
     accelerate_until    = 0;
@@ -56,8 +69,10 @@ void Block::clear()
     direction_bits      = 0;
     recalculate_flag    = false;
     nominal_length_flag = false;
-    max_entry_speed     = 0.0F;
+    max_entry_speed     = 0;
     is_ready            = false;
+    s_curve             = false;
+    rapid               = false;
     times_taken         = 0;
 }
 
@@ -70,15 +85,15 @@ void Block::debug()
                                                       this->steps[2],
                                                                this->steps_event_count,
                                                                              this->nominal_rate,
-                                                                                   this->nominal_speed,
-                                                                                            this->millimeters,
-                                                                                                         this->rate_delta,
+                                                                                   fixed_to_mm(this->nominal_speed),
+                                                                                            fixed_to_mm(this->millimeters),
+                                                                                                         (float)this->rate_delta / STEP_RATE_ONE,
                                                                                                                  this->accelerate_until,
                                                                                                                          this->decelerate_after,
                                                                                                                                    this->initial_rate,
                                                                                                                                         this->final_rate,
-                                                                                                                                                          this->entry_speed,
-                                                                                                                                                                this->max_entry_speed,
+                                                                                                                                                          fixed_to_mm(this->entry_speed),
+                                                                                                                                                                fixed_to_mm(this->max_entry_speed),
                                                                                                                                                                              this->times_taken,
                                                                                                                                                                                       this->is_ready,
                                                                                                                                                                                                 recalculate_flag?1:0,
@@ -87,6 +102,29 @@ void Block::debug()
 }
 
 
+// The rate of the block at speed, up to its nominal rate, in 1/256 steps per second
+static uint32_t rate_at_speed(const Block *block, uint32_t speed)
+{
+    if (speed >= block->nominal_speed)
+        return block->nominal_rate;
+    return muldiv(block->nominal_rate, speed, block->nominal_speed);
+}
+
+// How much the square of the rate changes in a step when the block accelerates, the Stepper adds rate_delta to the rate
+// every acceleration tick. Squares of rates in 1/256 steps per second fit in 64 bits, see quadratic_interpolate()
+static uint64_t rate_squared_per_step(const Block *block)
+{
+    return (uint64_t)2 * STEP_RATE_ONE * THEKERNEL->acceleration_ticks_per_second * max(block->rate_delta, (uint32_t)1);
+}
+
+// The rate reached from rate after steps of acceleration
+static uint32_t rate_after_steps(uint32_t rate, uint64_t per_step, uint32_t steps)
+{
+    uint64_t squared = (uint64_t)rate * rate;
+    uint64_t change = mul_saturate64(per_step, steps);
+    return isqrt64((squared + change < squared) ? UINT64_MAX : squared + change);
+}
+
 /* Calculates trapezoid parameters so that the entry- and exit-speed is compensated by the provided factors.
 // The factors represent a factor of braking and must be in the range 0.0-1.0.
 //                                +--------+ <- nominal_rate
@@ -96,54 +134,104 @@ void Block::debug()
 //                              +-------------+
 //                                  time -->
 */
-void Block::calculate_trapezoid( float entryspeed, float exitspeed )
+void Block::calculate_trapezoid( uint32_t entryspeed, uint32_t exitspeed )
 {
     // if block is currently executing, don't touch anything!
     if (times_taken)
         return;
 
-    // The planner passes us factors, we need to transform them in rates
-    this->initial_rate = ceilf(this->nominal_rate * entryspeed / this->nominal_speed);   // (step/s)
-    this->final_rate   = ceilf(this->nominal_rate * exitspeed  / this->nominal_speed);   // (step/s)
+    // segments prepared for the old plan are dropped, see Stepper::prepare_segments()
+    this->plan_version++;
 
-    // How many steps to accelerate and decelerate
-    float acceleration_per_second = this->rate_delta * THEKERNEL->acceleration_ticks_per_second; // ( step/s^2)
-    int accelerate_steps = ceilf( this->estimate_acceleration_distance( this->initial_rate, this->nominal_rate, acceleration_per_second ) );
-    int decelerate_steps = floorf( this->estimate_acceleration_distance( this->nominal_rate, this->final_rate,  -acceleration_per_second ) );
+    // The planner passes us speeds, we need to transform them in rates
+    this->initial_rate = rate_at_speed(this, entryspeed);
+    this->final_rate   = rate_at_speed(this, exitspeed);
 
-    // Calculate the size of Plateau of Nominal Rate ( during which we don't accelerate nor decelerate, but just cruise )
-    int plateau_steps = this->steps_event_count - accelerate_steps - decelerate_steps;
+    // With a jerk limit the ramps are S shaped, the Stepper then follows them in time instead of in steps. Without room
+    // for the S-curve plans the blocks keep their trapezoids, which the planner passes still leave time for
+    this->s_curve = (THEKERNEL->planner->get_jerk() > 0.0F && THEKERNEL->conveyor->has_s_curve_plans());
+    if (this->s_curve) {
+        this->calculate_s_curve((float)this->rate_delta * THEKERNEL->acceleration_ticks_per_second / STEP_RATE_ONE); // ( step/s^2)
+        this->exit_speed = exitspeed;
+        return;
+    }
 
-    // Is the Plateau of Nominal Rate smaller than nothing? That means no cruising, and we will
-    // have to use intersection_distance() to calculate when to abort acceleration and start braking
-    // in order to reach the final_rate exactly at the end of this block.
-    if (plateau_steps < 0)
+    // How many steps to accelerate and decelerate
+    uint64_t per_step = rate_squared_per_step(this);
+    uint32_t accelerate_steps = this->estimate_acceleration_distance( this->initial_rate, this->nominal_rate, per_step, true );
+    uint32_t decelerate_steps = this->estimate_acceleration_distance( this->final_rate, this->nominal_rate, per_step, false );
+
+    // Is the Plateau of Nominal Rate ( during which we don't accelerate nor decelerate, but just cruise ) smaller than
+    // nothing? That means no cruising, and we will have to use intersection_distance() to calculate when to abort
+    // acceleration and start braking in order to reach the final_rate exactly at the end of this block.
+    uint32_t plateau_steps;
+    if ((uint64_t)accelerate_steps + decelerate_steps > this->steps_event_count)
     {
-        accelerate_steps = ceilf(this->intersection_distance(this->initial_rate, this->final_rate, acceleration_per_second, this->steps_event_count));
-        accelerate_steps = max( accelerate_steps, 0 ); // Check limits due to numerical round-off
-        accelerate_steps = min( accelerate_steps, int(this->steps_event_count) );
-        max_rate = this->max_allowable_speed(-acceleration_per_second, this->final_rate, this->steps_event_count - this->decelerate_after);
+        accelerate_steps = this->intersection_distance(this->initial_rate, this->final_rate, per_step, this->steps_event_count);
+        max_rate = rate_after_steps(this->final_rate, per_step, this->steps_event_count - this->decelerate_after);
         plateau_steps = 0;
     }
     else
     {
-        max_rate = nominal_rate;
+        plateau_steps = this->steps_event_count - accelerate_steps - decelerate_steps;
+        max_rate = this->nominal_rate;
     }
-    
+
     this->accelerate_until = accelerate_steps;
     this->decelerate_after = accelerate_steps + plateau_steps;
 
     this->exit_speed = exitspeed;
 }
 
-// Calculates the distance (not time) it takes to accelerate from initial_rate to target_rate using the
-// given acceleration:
-float Block::estimate_acceleration_distance(float initialrate, float targetrate, float acceleration)
+// Plans what is left of this block after a feed hold stopped it at step stepped of its longest axis: from rest up to
+// the nominal rate and down to the exit speed, or to what the rest of the block can reach from rest if that is lower.
+// Unlike calculate_trapezoid() this changes a block that is executing, the Stepper follows the new trapezoid in steps.
+// Returns the exit speed.
+uint32_t Block::plan_resume(unsigned int stepped, uint32_t exitspeed)
+{
+    uint32_t steps = this->steps_event_count - stepped;
+    uint64_t per_step = rate_squared_per_step(this);
+
+    exitspeed = min(exitspeed, this->max_allowable_speed(this->acceleration, 0, muldiv(this->millimeters, steps, this->steps_event_count)));
+    this->entry_speed = 0;
+    this->initial_rate = 0;
+    this->final_rate = rate_at_speed(this, exitspeed);
+
+    uint32_t accelerate_steps = this->estimate_acceleration_distance( 0, this->nominal_rate, per_step, true );
+    uint32_t decelerate_steps = this->estimate_acceleration_distance( this->final_rate, this->nominal_rate, per_step, false );
+    uint32_t plateau_steps;
+
+    if ((uint64_t)accelerate_steps + decelerate_steps > steps)
+    {
+        accelerate_steps = this->intersection_distance(0, this->final_rate, per_step, steps);
+        max_rate = rate_after_steps(this->final_rate, per_step, steps - accelerate_steps);
+        plateau_steps = 0;
+    }
+    else
+    {
+        plateau_steps = steps - accelerate_steps - decelerate_steps;
+        max_rate = this->nominal_rate;
+    }
+
+    this->accelerate_until = stepped + accelerate_steps;
+    this->decelerate_after = stepped + accelerate_steps + plateau_steps;
+    this->s_curve = false;
+    this->exit_speed = exitspeed;
+    return exitspeed;
+}
+
+// Calculates the distance (not time) it takes to accelerate from initial_rate up to target_rate, when the square of
+// the rate grows by per_step every step. Rounded up or down to whole steps
+uint32_t Block::estimate_acceleration_distance(uint32_t initialrate, uint32_t targetrate, uint64_t per_step, bool round_up)
 {
-    return( ((targetrate * targetrate) - (initialrate * initialrate)) / (2.0F * acceleration));
+    if (targetrate <= initialrate)
+        return 0;
+    uint64_t change = (uint64_t)targetrate * targetrate - (uint64_t)initialrate * initialrate;
+    uint64_t steps = change / per_step + (round_up && change % per_step != 0);
+    return min(steps, (uint64_t)UINT32_MAX);
 }
 
-// This function gives you the point at which you must start braking (at the rate of -acceleration) if
+// This function gives you the point at which you must start braking (with the acceleration of per_step) if
 // you started at speed initial_rate and accelerated until this point and want to end at the final_rate after
 // a total travel of distance. This can be used to compute the intersection point between acceleration and
 // deceleration in the cases where the trapezoid has no plateau (i.e. never reaches maximum speed)
@@ -157,21 +245,211 @@ float Block::estimate_acceleration_distance(float initialrate, float targetrate,
                             ^ ^
                             | |
         intersection_distance distance */
-float Block::intersection_distance(float initialrate, float finalrate, float acceleration, float distance)
+// It is (per_step * distance - initial_rate^2 + final_rate^2) / (2 * per_step) rounded up, and within the distance.
+// The change of the squares is split in whole steps and what is left, so nothing is multiplied beyond 64 bits.
+uint32_t Block::intersection_distance(uint32_t initialrate, uint32_t finalrate, uint64_t per_step, uint32_t distance)
 {
-    return((2 * acceleration * distance - initialrate * initialrate + finalrate * finalrate) / (4 * acceleration));
+    int64_t change = (int64_t)((uint64_t)finalrate * finalrate) - (int64_t)((uint64_t)initialrate * initialrate);
+    int64_t whole = change / (int64_t)per_step;
+    int64_t left = change % (int64_t)per_step;
+    if (left < 0) {
+        whole--;
+        left += per_step;
+    }
+
+    // (n + left / per_step) / 2 rounded up, with n rounded down by the shift
+    int64_t n = distance + whole;
+    int64_t steps = (left == 0) ? (n + 1) >> 1 : (n >> 1) + 1;
+    if (steps < 0) return 0;
+    return min(steps, (int64_t)distance);
+}
+
+// Acceleration ticks of an S-curve ramp that changes the rate by delta: the acceleration ramps up with jerk, stays at
+// acceleration if there is time for it, and ramps down again. Each phase is rounded up to whole ticks, as the Stepper
+// follows it tick by tick, so the jerk and the acceleration the ramp ends up with are at most the given ones.
+// A change the jerk makes within a tick needs no ramp, it is made at once, like the first tick of a ramp does.
+static void s_curve_ramp_ticks(float delta, float acceleration, float jerk, uint32_t &jerk_ticks, uint32_t &constant_ticks)
+{
+    float ticks_per_second = THEKERNEL->acceleration_ticks_per_second;
+    if (delta * ticks_per_second * ticks_per_second <= jerk) {
+        jerk_ticks = constant_ticks = 0;
+        return;
+    }
+
+    float jerk_time, constant_time;
+    if (delta >= acceleration * acceleration / jerk) {
+        jerk_time = acceleration / jerk;
+        constant_time = delta / acceleration - jerk_time;
+    } else {
+        jerk_time = sqrtf(delta / jerk);
+        constant_time = 0.0F;
+    }
+    jerk_ticks = ceilf(jerk_time * ticks_per_second);
+    constant_ticks = ceilf(constant_time * ticks_per_second);
+}
+
+// Calculates the distance it takes to go from initial_rate to target_rate with an S-curve. The ramp is symmetric so its
+// mean rate is halfway between the two rates. Works for rates in steps and in mm alike.
+float Block::s_curve_distance(float initialrate, float targetrate, float acceleration, float jerk)
+{
+    uint32_t jerk_ticks, constant_ticks;
+    s_curve_ramp_ticks(fabsf(targetrate - initialrate), acceleration, jerk, jerk_ticks, constant_ticks);
+    return (initialrate + targetrate) * 0.5F * (2 * jerk_ticks + constant_ticks) / THEKERNEL->acceleration_ticks_per_second;
+}
+
+// Fits jerk limited ramps from initial_rate up to at most nominal_rate and down to final_rate in the block, and works
+// out the phases the Stepper follows in acceleration ticks. The cruise is a whole number of ticks too, its rate is
+// lowered a little so the block still makes its steps in them.
+void Block::calculate_s_curve(float acceleration)
+{
+    float steps = this->steps_event_count;
+    float jerk = THEKERNEL->planner->get_jerk() * steps / fixed_to_mm(this->millimeters);     // (step/s^3)
+    float ticks_per_second = THEKERNEL->acceleration_ticks_per_second;
+
+    // the rates the Stepper starts and ends with, it never goes below half a tick of acceleration
+    uint32_t min_rate = this->rate_delta / 2;
+    float initial_rate = (float)max(this->initial_rate, min_rate) / STEP_RATE_ONE;   // (step/s)
+    float final_rate = (float)max(this->final_rate, min_rate) / STEP_RATE_ONE;
+    float rate = max((float)this->nominal_rate / STEP_RATE_ONE, max(initial_rate, final_rate));
+    float accelerate_distance = s_curve_distance(initial_rate, rate, acceleration, jerk);
+    float decelerate_distance = s_curve_distance(rate, final_rate, acceleration, jerk);
+
+    float squeeze = 1.0F;
+    if (accelerate_distance + decelerate_distance > steps) {
+        // No plateau, find the highest rate we can reach before we have to decelerate. Rates closer than a tick of
+        // acceleration end up with the same ticks, and the cruise rate below is fitted to the steps anyway
+        float low = max(initial_rate, final_rate);
+        float high = rate;
+
+        float rate_delta = (float)this->rate_delta / STEP_RATE_ONE;
+        while (high - low > rate_delta) {
+            rate = (low + high) * 0.5F;
+            if (s_curve_distance(initial_rate, rate, acceleration, jerk) + s_curve_distance(rate, final_rate, acceleration, jerk) > steps)
+                high = rate;
+            else
+                low = rate;
+        }
+        rate = low;
+        accelerate_distance = s_curve_distance(initial_rate, rate, acceleration, jerk);
+        decelerate_distance = s_curve_distance(rate, final_rate, acceleration, jerk);
+
+        // The planner's junction speeds come from a smooth S-curve, rounding it to ticks can make the change from
+        // initial_rate to final_rate a little longer than the block. The ramps are then shortened, with more jerk.
+        if (accelerate_distance + decelerate_distance > steps) {
+            squeeze = steps / (accelerate_distance + decelerate_distance);
+            accelerate_distance *= squeeze;
+            decelerate_distance *= squeeze;
+        }
+    }
+
+    // the phases in ticks, and the cruise rate that makes the steps of the block in them
+    s_curve_plan_t &plan = this->s_curve_plan();
+    uint32_t *ticks = plan.ticks;
+    s_curve_ramp_ticks(rate - initial_rate, acceleration, jerk, ticks[0], ticks[1]);
+    s_curve_ramp_ticks(rate - final_rate, acceleration, jerk, ticks[3], ticks[4]);
+    for (int i = 0; i < 5 && squeeze < 1.0F; i++) ticks[i] = floorf(ticks[i] * squeeze);
+    if (ticks[0] == 0) ticks[1] = 0;
+    if (ticks[3] == 0) ticks[4] = 0;
+    float accelerate_ticks = 2 * ticks[0] + ticks[1];
+    float decelerate_ticks = 2 * ticks[3] + ticks[4];
+    ticks[2] = ceilf(max(0.0F, steps - accelerate_distance - decelerate_distance) * ticks_per_second / rate);
+    rate = (steps * ticks_per_second - (initial_rate * accelerate_ticks + final_rate * decelerate_ticks) * 0.5F) /
+           ((accelerate_ticks + decelerate_ticks) * 0.5F + ticks[2]);
+
+    // the ramps reach it exactly with the jerk they get, in the units of the Stepper per tick^2
+    float unit = STEP_RATE_ONE * (float)(1 << S_CURVE_SHIFT);
+    plan.jerk[0] = (ticks[0] > 0) ? (int64_t)((rate - initial_rate) * unit / (6.0F * ticks[0] * (ticks[0] + ticks[1]))) : 0;
+    plan.jerk[1] = (ticks[3] > 0) ? (int64_t)((rate - final_rate) * unit / (6.0F * ticks[3] * (ticks[3] + ticks[4]))) : 0;
+
+    accelerate_distance = (initial_rate + rate) * 0.5F * accelerate_ticks / ticks_per_second;
+    decelerate_distance = (rate + final_rate) * 0.5F * decelerate_ticks / ticks_per_second;
+    int accelerate_steps = min(int(ceilf(accelerate_distance)), int(this->steps_event_count));
+    int decelerate_steps = floorf(decelerate_distance);
+    this->max_rate = rate * STEP_RATE_ONE;
+    this->accelerate_until = accelerate_steps;
+    this->decelerate_after = max(accelerate_steps, int(this->steps_event_count) - decelerate_steps);
+}
+
+// Highest speed an S-curve reaches from v0 in distance, with the phases taking as long as they need. speed is an upper
+// bound for it, the constant acceleration one.
+static float s_curve_reachable_speed(float v0, float distance, float acceleration, float jerk, float speed)
+{
+    if (distance <= 0.0F)
+        return v0;
+
+    // the ramp reaches the acceleration: (v^2 - v0^2) / acceleration + (v0 + v) * acceleration / jerk = 2 * distance
+    float b = acceleration * acceleration / jerk;
+    float v = (sqrtf(b * b - 4.0F * (v0 * b - v0 * v0 - 2.0F * acceleration * distance)) - b) * 0.5F;
+    if (v - v0 < b) {
+        // it does not: (v0 + v)^2 * (v - v0) = jerk * distance^2, Newton from speed stays above the root
+        float u = speed + v0;
+        float c = jerk * distance * distance;
+        for (int i = 0; i < 4; i++)
+            u -= (u * u * (u - 2.0F * v0) - c) / (u * (3.0F * u - 4.0F * v0));
+        v = u - v0;
+    }
+    return min(max(v, v0), speed);
+}
+
+// Highest speed this block can have at one end of distance, and still get to target_velocity at the other end with
+// its acceleration, and its jerk when it has S-curves. The planner passes call it for every block of the queue, so the
+// S-curve is solved directly instead of searched for, in the whole ticks s_curve_distance() rounds the phases up to.
+// It takes a cube root and a few Newton steps, so it is solved in float, like calculate_s_curve().
+uint32_t Block::max_reachable_speed(uint32_t target_velocity, uint32_t distance)
+{
+    uint32_t speed = max_allowable_speed(this->acceleration, target_velocity, distance);
+    float jerk = THEKERNEL->planner->get_jerk();     // (mm/s^3)
+    if (jerk <= 0.0F || this->steps_event_count == 0)
+        return speed;
+
+    float acceleration = fixed_to_mm(this->acceleration);
+    float length = fixed_to_mm(distance);
+    float speed_mm = fixed_to_mm(speed);
+    float tick = 1.0F / THEKERNEL->acceleration_ticks_per_second;
+    // the Stepper never goes below half a tick of acceleration, see calculate_s_curve()
+    float v0 = max(fixed_to_mm(target_velocity), (float)this->rate_delta / STEP_RATE_ONE * 0.5F * fixed_to_mm(this->millimeters) / this->steps_event_count);
+    float b = acceleration * acceleration / jerk;
+
+    // Starting faster does not always get further, the ramp is shorter but covers more distance in each tick. The
+    // planner passes need the speed to grow with target_velocity, so below the start that gets the least far the
+    // speed from there is used. It is at a third of the speed reached, or at half the jerk of one acceleration.
+    float worst = cbrtf(jerk * length * length / 32.0F);
+    if (worst >= 0.5F * b) worst = 0.5F * b;
+    v0 = max(v0, worst);
+
+    float v = s_curve_reachable_speed(v0, length, acceleration, jerk, speed_mm);
+
+    if (v - v0 < b) {
+        // two jerk phases of n ticks each reach v0 + jerk * (n * tick)^2 and cover (v0 + v) * n * tick, the best n is
+        // next to the one without rounding, and a change of one tick is made at once. A little is kept back so the float
+        // rounding does not add a tick.
+        int n = floorf(sqrtf((v - v0) / jerk) / tick);
+        float best = v0 + min(jerk * tick * tick, b);
+        for (int i = max(n, 1); i <= n + 1; i++) {
+            float t = i * tick;
+            best = max(best, min(min(v0 + jerk * t * t, v0 + b), length / t - v0));
+        }
+        return min(mm_to_fixed(v0 + (best - v0) * 0.999F), speed);
+    }
+
+    // with a constant acceleration phase too the three phases each get up to a tick longer, which is a small part of
+    // the long ramp. It is taken from the distance at v, which is above the speed reached.
+    length -= 1.5F * (v0 + v) * tick;
+    return min(mm_to_fixed(s_curve_reachable_speed(v0, length, acceleration, jerk, v)), speed);
 }
 
 // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the
-// acceleration within the allotted distance.
-float Block::max_allowable_speed(float acceleration, float target_velocity, float distance)
+// acceleration within the allotted distance. The square of a speed is in 2^-32 mm^2/s^2, like acceleration * distance.
+uint32_t Block::max_allowable_speed(uint32_t acceleration, uint32_t target_velocity, uint32_t distance)
 {
-    return sqrtf(target_velocity * target_velocity - 2.0F * acceleration * distance);
+    uint64_t squared = (uint64_t)target_velocity * target_velocity;
+    uint64_t change = mul_saturate64(2 * (uint64_t)acceleration, distance);
+    return isqrt64((squared + change < squared) ? UINT64_MAX : squared + change);
 }
 
 
 // Called by Planner::recalculate() when scanning the plan from last to first entry.
-float Block::reverse_pass(float exit_speed)
+uint32_t Block::reverse_pass(uint32_t exit_speed)
 {
     // If entry speed is already at the maximum entry speed, no need to recheck. Block is cruising.
     // If not, block in state of acceleration or deceleration. Reset entry speed to maximum and
@@ -182,7 +460,7 @@ float Block::reverse_pass(float exit_speed)
         // for max allowable speed if block is decelerating and nominal length is false.
         if ((!this->nominal_length_flag) && (this->max_entry_speed > exit_speed))
         {
-            float max_entry_speed = max_allowable_speed(-this->acceleration, exit_speed, this->millimeters);
+            uint32_t max_entry_speed = max_reachable_speed(exit_speed, this->millimeters);
 
             this->entry_speed = min(max_entry_speed, this->max_entry_speed);
 
@@ -198,7 +476,7 @@ float Block::reverse_pass(float exit_speed)
 
 // Called by Planner::recalculate() when scanning the plan from first to last entry.
 // returns maximum exit speed of this block
-float Block::forward_pass(float prev_max_exit_speed)
+uint32_t Block::forward_pass(uint32_t prev_max_exit_speed)
 {
     // If the previous block is an acceleration block, but it is not long enough to complete the
     // full speed change within the block, we need to adjust the entry speed accordingly. Entry
@@ -225,7 +503,7 @@ float Block::forward_pass(float prev_max_exit_speed)
     return max_exit_speed();
 }
 
-float Block::max_exit_speed()
+uint32_t Block::max_exit_speed()
 {
     // if block is currently executing, return cached exit speed from calculate_trapezoid
     // this ensures that a block following a currently executing block will have correct entry speed
@@ -239,17 +517,81 @@ float Block::max_exit_speed()
         return nominal_speed;
 
     // otherwise, we have to work out max exit speed based on entry and acceleration
-    float max = max_allowable_speed(-this->acceleration, this->entry_speed, this->millimeters);
+    uint32_t max = max_reachable_speed(this->entry_speed, this->millimeters);
 
     return min(max, nominal_speed);
 }
 
+// The S-curve plan of this block, there is one for every block of the queue once a jerk limit is set
+s_curve_plan_t& Block::s_curve_plan() const
+{
+    return THEKERNEL->conveyor->s_curve_plan(this);
+}
+
 // Gcodes are attached to their respective blocks so that on_gcode_execute can be called with it
 void Block::append_gcode(Gcode* gcode)
 {
-    Gcode new_gcode = *gcode;
+    Gcode new_gcode = *gcode; // shares the command of the gcode
     new_gcode.strip_parameters(); // optimization to save memory we strip off the XYZIJK parameters from the saved command
-    gcodes.push_back(new_gcode);
+    BlockGcodes::index_t node = THEKERNEL->conveyor->gcodes.add(last_gcode, std::move(new_gcode));
+    if (node == BlockGcodes::none)
+        return;
+    last_gcode = node;
+    if (first_gcode == BlockGcodes::none)
+        first_gcode = node;
+}
+
+// Adds a chunk of nodes to the free ones, returns false when there is no room for it
+bool BlockGcodes::grow()
+{
+    if (chunks_used == BLOCK_GCODES_CHUNKS)
+        return false;
+
+    Node* chunk = (Node*)AHB0.alloc(BLOCK_GCODES_CHUNK * sizeof(Node));
+    if (chunk == nullptr)
+        chunk = (Node*)malloc(BLOCK_GCODES_CHUNK * sizeof(Node));
+    if (chunk == nullptr)
+        return false;
+
+    index_t first = chunks_used * BLOCK_GCODES_CHUNK;
+    chunks[chunks_used++] = chunk;
+    for (int i = BLOCK_GCODES_CHUNK - 1; i >= 0; i--) {
+        chunk[i].next = free_nodes;
+        free_nodes = first + i;
+    }
+    return true;
+}
+
+// Takes a node for the gcode and links it after last, the node of the previous gcode of its block or none.
+// Returns none, and the gcode is dropped, when no node is left and the pool can not grow
+BlockGcodes::index_t BlockGcodes::add(index_t last, Gcode&& gcode)
+{
+    if (free_nodes == none && !grow())
+        return none;
+
+    index_t i = free_nodes;
+    Node& n = node(i);
+    free_nodes = n.next;
+
+    new (n.storage) Gcode(std::move(gcode));
+    n.next = none;
+    if (last != none)
+        node(last).next = i;
+    return i;
+}
+
+// Frees the nodes of a block's gcodes, starting at its first
+void BlockGcodes::remove(index_t first)
+{
+    while (first != none) {
+        Node& n = node(first);
+        index_t next = n.next;
+
+        n.gcode().~Gcode();
+        n.next = free_nodes;
+        free_nodes = first;
+        first = next;
+    }
 }
 
 void Block::begin()
@@ -261,9 +603,12 @@ void Block::begin()
 
     times_taken = -1;
 
+    motion_trace(MOTION_TRACE_BLOCK, ++block_number);
+
     // execute all the gcodes related to this block
-    for(unsigned int index = 0; index < gcodes.size(); index++)
-        THEKERNEL->call_event(ON_GCODE_EXECUTE, &(gcodes[index]));
+    BlockGcodes &gcodes = THEKERNEL->conveyor->gcodes;
+    for(BlockGcodes::index_t i = first_gcode; i != BlockGcodes::none; i = gcodes.node(i).next)
+        THEKERNEL->call_event(ON_GCODE_EXECUTE, &gcodes.node(i).gcode());
 
 
     THEKERNEL->call_event(ON_BLOCK_BEGIN, this);
@@ -293,6 +638,7 @@ void Block::release()
         times_taken = 0;
         if (is_ready) {
             is_ready = false;
+            motion_trace(MOTION_TRACE_BLOCK_END, block_number);
             THEKERNEL->call_event(ON_BLOCK_END, this);
 
             // ensure conveyor gets called last
@@ -8,27 +8,77 @@
 #ifndef BLOCK_H
 #define BLOCK_H
 
-#include <vector>
-#include <bitset>
+#include <stdint.h>
 
-class Gcode;
+#include "Gcode.h"
+
+// The S-curve rates carry this many bits below the 1/256 steps per second of the step rates, as the jerk only changes
+// them by a little every acceleration tick
+#define S_CURVE_SHIFT 16
+
+// The gcodes attached to the blocks of the queue. They are kept apart from the blocks, in nodes that link to the next
+// gcode of the same block, so a block only holds the numbers of its first and last node. The nodes come in chunks
+// from AHB SRAM, or from the heap once AHB0 is full. A chunk is added when every node is taken and kept from then on,
+// so the pool grows to the most gcodes the queue has held and taking a node does not go through the heap.
+// Nodes are only taken and freed in the main loop, begin() follows the links of a block that can not change anymore.
+#define BLOCK_GCODES_CHUNK 16       // nodes in a chunk
+#define BLOCK_GCODES_CHUNKS 64      // chunks at most, the numbers of the nodes fit in 16 bits
+
+class BlockGcodes {
+    public:
+        typedef uint16_t index_t;
+        static const index_t none = 0xFFFF;
+
+        struct Node {
+            index_t next;
+            alignas(Gcode) char storage[sizeof(Gcode)];
+            Gcode& gcode() { return *reinterpret_cast<Gcode*>(storage); }
+        };
+
+        BlockGcodes() : chunks_used(0), free_nodes(none) {}
+
+        Node& node(index_t i) { return chunks[i / BLOCK_GCODES_CHUNK][i % BLOCK_GCODES_CHUNK]; }
+        index_t add(index_t last, Gcode&& gcode);
+        void remove(index_t first);
+
+    private:
+        bool grow();
+
+        Node* chunks[BLOCK_GCODES_CHUNKS];
+        uint8_t chunks_used;
+        index_t free_nodes;
+};
+
+// The S-curve of the main stepper of a block in acceleration ticks, see Block::calculate_s_curve() and
+// Stepper::s_curve_next(). Only a jerk limit needs one, so the plans are kept apart from the blocks, see Conveyor.
+struct s_curve_plan_t {
+    uint32_t ticks[5];      // jerk and constant acceleration phases of the acceleration, cruise, and the same for the deceleration
+    int64_t jerk[2];        // a sixth of the jerk of the acceleration and of the deceleration, see S_CURVE_SHIFT
+};
 
 class Block {
     public:
         Block();
-        void calculate_trapezoid( float entry_speed, float exit_speed );
-        float estimate_acceleration_distance( float initial_rate, float target_rate, float acceleration );
-        float intersection_distance(float initial_rate, float final_rate, float acceleration, float distance);
-        float max_allowable_speed( float acceleration, float target_velocity, float distance);
+        void calculate_trapezoid( uint32_t entry_speed, uint32_t exit_speed );
+        uint32_t estimate_acceleration_distance( uint32_t initial_rate, uint32_t target_rate, uint64_t acceleration, bool round_up );
+        uint32_t intersection_distance(uint32_t initial_rate, uint32_t final_rate, uint64_t acceleration, uint32_t distance);
+        uint32_t max_allowable_speed( uint32_t acceleration, uint32_t target_velocity, uint32_t distance);
+        float s_curve_distance(float initial_rate, float target_rate, float acceleration, float jerk);
+        void calculate_s_curve(float acceleration);
+        uint32_t max_reachable_speed(uint32_t target_velocity, uint32_t distance);
+        uint32_t plan_resume(unsigned int stepped, uint32_t exit_speed);
 
-        float reverse_pass(float exit_speed);
-        float forward_pass(float next_entry_speed);
+        uint32_t reverse_pass(uint32_t exit_speed);
+        uint32_t forward_pass(uint32_t next_entry_speed);
 
-        float max_exit_speed();
+        uint32_t max_exit_speed();
 
         void debug();
 
         void append_gcode(Gcode* gcode);
+        bool has_gcodes() const { return first_gcode != BlockGcodes::none; }
+        s_curve_plan_t& s_curve_plan() const;
+        bool direction(int axis) const { return (direction_bits >> axis) & 1; }
 
         void take();
         void release();
@@ -39,34 +89,43 @@ class Block {
 
         void begin();
 
-        std::vector<Gcode> gcodes;
-
         unsigned int   steps[3];           // Number of steps for each axis for this block
         unsigned int   steps_event_count;  // Steps for the longest axis
-        unsigned int   nominal_rate;       // Nominal rate in steps per second
-        float          nominal_speed;      // Nominal speed in mm per second
-        float          millimeters;        // Distance for this move
-        float          entry_speed;
-        float          exit_speed;
-        float          rate_delta;         // Nomber of steps to add to the speed for each acceleration tick
-        float          acceleration;       // the acceleratoin for this block
-        unsigned int   initial_rate;       // Initial speed in steps per second
-        unsigned int   final_rate;         // Final speed in steps per second
+        unsigned int   nominal_rate;       // Nominal rate in 1/256 steps per second, see STEP_RATE_ONE
+        uint32_t       nominal_speed;      // Nominal speed in 1/65536 mm per second, see MM_ONE in Planner.h
+        uint32_t       millimeters;        // Distance for this move, in 1/65536 mm
+        uint32_t       entry_speed;
+        uint32_t       exit_speed;
+        uint32_t       rate_delta;         // Rate to add to the speed for each acceleration tick, in 1/256 steps per second
+        uint32_t       acceleration;       // the acceleratoin for this block, in 1/65536 mm per second^2
+        unsigned int   initial_rate;       // Initial speed in 1/256 steps per second
+        unsigned int   final_rate;         // Final speed in 1/256 steps per second
         unsigned int   max_rate;           // Maximum rate during the move, <= nominal_rate
+        unsigned int   rate_limit;         // Highest rate the axis and actuator limits allow, the overrides stay below it
         unsigned int   accelerate_until;   // Stop accelerating after this number of steps
         unsigned int   decelerate_after;   // Start decelerating after this number of steps
 
-        float max_entry_speed;
+        uint32_t max_entry_speed;
+
+        uint16_t plan_version; // changed every time calculate_trapezoid() plans the block, kept when it is cleared
+        BlockGcodes::index_t first_gcode;  // the attached gcodes, see BlockGcodes
+        BlockGcodes::index_t last_gcode;
 
-        short times_taken;    // A block can be "taken" by any number of modules, and the next block is not moved to until all the modules have "released" it. This value serves as a tracker.
+        int8_t times_taken;    // A block can be "taken" by any number of modules, and the next block is not moved to until all the modules have "released" it. This value serves as a tracker.
 
-        std::bitset<3> direction_bits;     // Direction for each axis in bit form, relative to the direction port's mask
         struct {
+            uint8_t direction_bits:3;            // Direction for each axis in bit form, relative to the direction port's mask
             bool recalculate_flag:1;             // Planner flag to recalculate trapezoids on entry junction
             bool nominal_length_flag:1;          // Planner flag for nominal speed always reached
             bool is_ready:1;
+            bool s_curve:1;                      // calculate_trapezoid found a jerk limited profile that fits in the block, see s_curve_plan()
+            bool rapid:1;                        // a G0 seek, the rapid override applies to it instead of the feed override
         };
 };
 
+// The ring of the queue is in AHB1 next to the Ethernet and uip buffers, which take about 6KB of its 16KB. At this size
+// a planner_queue_size of 128 still fits, a field that does not keep it there has to go somewhere else.
+static_assert(sizeof(Block) <= 80, "Block no longer fits 128 times in AHB1");
+static_assert(alignof(Block) <= 4, "the AHB pools only align to 4 bytes");
 
 #endif
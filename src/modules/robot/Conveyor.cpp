@@ -22,8 +22,12 @@ using namespace std;
 #include "Config.h"
 #include "libs/StreamOutputPool.h"
 #include "ConfigValue.h"
+#include "platform_memory.h"
+
+#include <new>
 
 #define planner_queue_size_checksum CHECKSUM("planner_queue_size")
+#define max_jerk_checksum           CHECKSUM("max_jerk")
 
 /*
  * The conveyor holds the queue of blocks, takes care of creating them, and starting the executing chain of blocks
@@ -53,6 +57,8 @@ using namespace std;
  */
 
 Conveyor::Conveyor(){
+    ring_memory = NULL;
+    s_curve_plans = nullptr;
     gc_pending = queue.tail_i;
     running = false;
     flush = false;
@@ -118,7 +124,7 @@ void Conveyor::on_main_loop(void*)
 
     if (queue.is_empty())
     {
-        if (queue.head_ref()->gcodes.size())
+        if (queue.head_ref()->has_gcodes())
         {
             queue_head_block();
             ensure_running();
@@ -131,7 +137,45 @@ void Conveyor::on_main_loop(void*)
 
 void Conveyor::on_config_reload(void* argument)
 {
-    queue.resize(THEKERNEL->config->value(planner_queue_size_checksum)->by_default(32)->as_number());
+    unsigned int size = THEKERNEL->config->value(planner_queue_size_checksum)->by_default(32)->as_number();
+    bool s_curves = THEKERNEL->config->value(max_jerk_checksum)->by_default(0.0F)->as_number() > 0.0F;
+
+    // The ring and the S-curve plans can only be replaced while no block holds gcodes, a reload during a print keeps them
+    if (size == queue.length && s_curves == has_s_curve_plans())
+        return;
+    if (queue.length > 0 && (!queue.is_empty() || queue.head_ref()->has_gcodes()))
+        return;
+
+    if (size != queue.length) {
+        // The blocks go to AHB SRAM when there is room for them, so a deep queue does not take the main SRAM.
+        // The pools align to 4 bytes, which is all a Block needs, see Block.h
+        void* memory = AHB1.alloc(size * sizeof(Block));
+        if (memory != NULL) {
+            Block* ring = (Block*)memory;
+            for (unsigned int i = 0; i < size; i++)
+                new (&ring[i]) Block();
+            if (!queue.provide(ring, size)) {
+                AHB1.dealloc(memory);
+                return;
+            }
+        } else if (queue.resize(size)) {
+            THEKERNEL->streams->printf("WARNING: a planner_queue_size of %u takes %u bytes, more than the %lu bytes free in AHB SRAM, the queue is in the main SRAM\n",
+                                       size, (unsigned int)(size * sizeof(Block)), (unsigned long)AHB1.free());
+        } else {
+            return;
+        }
+
+        // Blocks have nothing to destroy, the old ring is freed like any other allocation
+        if (ring_memory != NULL)
+            AHB1.dealloc(ring_memory);
+        ring_memory = memory;
+
+        gc_pending = queue.tail_i;
+    }
+
+    // Only a jerk limit needs the S-curve plans, without room for them the blocks keep their trapezoids
+    delete [] s_curve_plans;
+    s_curve_plans = s_curves ? new s_curve_plan_t[size] : nullptr;
 }
 
 void Conveyor::append_gcode(Gcode* gcode)
@@ -168,6 +212,15 @@ void Conveyor::on_block_end(void* block)
     next->begin();
 }
 
+// The block that begins after the executing one, or nullptr if none is queued yet
+Block* Conveyor::get_next_block()
+{
+    unsigned int executing = gc_pending;
+    if (executing == queue.head_i || queue.next(executing) == queue.head_i)
+        return nullptr;
+    return queue.item_ref(queue.next(executing));
+}
+
 // Wait for the queue to be empty
 void Conveyor::wait_for_empty_queue()
 {
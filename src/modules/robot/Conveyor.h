@@ -10,13 +10,13 @@
 
 #include "libs/Module.h"
 #include "HeapRing.h"
+#include "Block.h"
 
 using namespace std;
 #include <string>
 #include <vector>
 
 class Gcode;
-class Block;
 
 class Conveyor : public Module
 {
@@ -44,13 +44,20 @@ public:
     void dump_queue(void);
     void flush_queue(void);
     bool is_flushing() const { return flush; }
+    Block* get_next_block();
+    bool has_s_curve_plans() const { return s_curve_plans != nullptr; }
+    s_curve_plan_t& s_curve_plan(const Block* block) { return s_curve_plans[block - queue.ring]; }
 
     friend class Planner; // for queue
+    friend class Block;   // for gcodes
 
 private:
     typedef HeapRing<Block> Queue_t;
 
     Queue_t queue;  // Queue of Blocks
+    void* ring_memory;  // the AHB1 allocation the ring of the queue is in, NULL when it is on the heap
+    BlockGcodes gcodes; // The gcodes attached to the blocks of the queue
+    s_curve_plan_t* s_curve_plans; // one for each block of the ring, at its index, nullptr without a jerk limit
     volatile unsigned int gc_pending;
 
     struct {
@@ -23,6 +23,9 @@ using namespace std;
 #include "Robot.h"
 #include "Stepper.h"
 #include "ConfigValue.h"
+#include "StepTicker.h"
+#include "StreamOutputPool.h"
+#include "fixedpoint.h"
 
 #include <math.h>
 
@@ -38,36 +41,81 @@ using namespace std;
 // It goes over the list in both direction, every time a block is added, re-doing the math to make sure everything is optimal
 
 Planner::Planner(){
-    clear_vector_float(this->previous_unit_vec);
+    clear_vector(this->previous_unit_vec);
+    this->step_rate_warned = false;
     config_load();
 }
 
 // Configure acceleration
 void Planner::config_load(){
-    this->acceleration = THEKERNEL->config->value(acceleration_checksum)->by_default(100.0F )->as_number(); // Acceleration is in mm/s^2
-    this->z_acceleration = THEKERNEL->config->value(z_acceleration_checksum)->by_default(0.0F )->as_number(); // disabled by default
-
-    this->junction_deviation = THEKERNEL->config->value(junction_deviation_checksum)->by_default(0.05F)->as_number();
-    this->z_junction_deviation = THEKERNEL->config->value(z_junction_deviation_checksum)->by_default(-1)->as_number(); // disabled by default
-    this->minimum_planner_speed = THEKERNEL->config->value(minimum_planner_speed_checksum)->by_default(0.0f)->as_number();
+    this->acceleration = mm_to_fixed(THEKERNEL->config->value(acceleration_checksum)->by_default(100.0F )->as_number()); // Acceleration is in mm/s^2
+    this->z_acceleration = mm_to_fixed(THEKERNEL->config->value(z_acceleration_checksum)->by_default(0.0F )->as_number()); // disabled by default
+    this->jerk = THEKERNEL->config->value(max_jerk_checksum)->by_default(0.0F )->as_number(); // Jerk is in mm/s^3, 0 keeps the trapezoid
+
+    this->junction_deviation = mm_to_fixed(THEKERNEL->config->value(junction_deviation_checksum)->by_default(0.05F)->as_number());
+    float z_junction_deviation = THEKERNEL->config->value(z_junction_deviation_checksum)->by_default(-1)->as_number(); // disabled by default
+    this->z_junction_deviation = (z_junction_deviation < 0.0F) ? -1 : min(mm_to_fixed(z_junction_deviation), (uint32_t)INT32_MAX);
+    this->minimum_planner_speed = mm_to_fixed(THEKERNEL->config->value(minimum_planner_speed_checksum)->by_default(0.0f)->as_number());
 }
 
 
-// Append a block to the queue, compute it's speed factors
-void Planner::append_block( float actuator_pos[], float rate_mm_s, float distance, float unit_vec[] )
+// The length of a move and its unit vector in 1/2^30, from the deltas of the axes in mm. In integers, the M3 has no FPU:
+// the deltas are scaled by a power of two, which is exact in float, so the largest has 30 bits and the sum of the
+// squares fits in 64 bits. The length is at least 1/65536 mm for a move that moves at all.
+uint32_t Planner::move_length(const float deltas[], int32_t unit_vec[])
 {
-    float acceleration, junction_deviation;
+    float largest = max(fabsf(deltas[X_AXIS]), max(fabsf(deltas[Y_AXIS]), fabsf(deltas[Z_AXIS])));
+    if (!(largest > 0.0F)) {
+        for (int i = 0; i < 3; i++) unit_vec[i] = 0;
+        return 0;
+    }
+
+    int exponent;
+    frexpf(largest, &exponent);      // largest < 2^exponent
+    uint32_t magnitude[3];
+    uint64_t sum = 0;
+    for (int i = 0; i < 3; i++) {
+        magnitude[i] = ldexpf(fabsf(deltas[i]), 30 - exponent);
+        sum += (uint64_t)magnitude[i] * magnitude[i];
+    }
+    uint32_t root = isqrt64(sum);
+
+    reciprocal_t r = reciprocal(root);
+    for (int i = 0; i < 3; i++) {
+        int32_t unit = (magnitude[i] >= root) ? (1 << UNIT_VECTOR_SHIFT) : fraction(magnitude[i], r) >> (32 - UNIT_VECTOR_SHIFT);
+        unit_vec[i] = (deltas[i] < 0.0F) ? -unit : unit;
+    }
+
+    // from 2^(exponent - 30) mm to 2^-16 mm, rounded to the nearest
+    int shift = exponent - 30 + MM_SHIFT;
+    uint64_t length;
+    if (shift >= 0)
+        length = (shift >= 32) ? UINT64_MAX : (uint64_t)root << shift;
+    else
+        length = (shift <= -48) ? 0 : ((uint64_t)root + ((uint64_t)1 << (-shift - 1))) >> -shift;
+    return max((uint64_t)1, min(length, (uint64_t)UINT32_MAX));
+}
+
+// Append a block to the queue, compute it's speed factors. The rates, distance and unit vector are in the units of the
+// planner, see MM_ONE and move_length().
+// max_rate is the fastest the axis and actuator limits allow, UINT32_MAX for no limit, rapid is set for G0 seeks, both
+// for the overrides
+void Planner::append_block( float actuator_pos[], uint32_t rate, uint32_t distance, const int32_t unit_vec[], uint32_t max_rate, bool rapid )
+{
+    uint32_t acceleration, junction_deviation;
 
     // Create ( recycle ) a new block
     Block* block = THEKERNEL->conveyor->queue.head_ref();
 
 
     // Direction bits
+    uint8_t direction_bits = 0;
     for (int i = 0; i < 3; i++)
     {
         int steps = THEKERNEL->robot->actuators[i]->steps_to_target(actuator_pos[i]);
 
-        block->direction_bits[i] = (steps < 0) ? 1 : 0;
+        if (steps < 0)
+            direction_bits |= 1 << i;
 
         // Update current position
         THEKERNEL->robot->actuators[i]->last_milestone_steps += steps;
@@ -75,6 +123,7 @@ void Planner::append_block( float actuator_pos[], float rate_mm_s, float distanc
 
         block->steps[i] = labs(steps);
     }
+    block->direction_bits = direction_bits;
 
     acceleration= this->acceleration;
     junction_deviation= this->junction_deviation;
@@ -82,8 +131,8 @@ void Planner::append_block( float actuator_pos[], float rate_mm_s, float distanc
     // use either regular acceleration or a z only move accleration
     if(block->steps[ALPHA_STEPPER] == 0 && block->steps[BETA_STEPPER] == 0) {
         // z only move
-        if(this->z_acceleration > 0.0F) acceleration= this->z_acceleration;
-        if(this->z_junction_deviation >= 0.0F) junction_deviation= this->z_junction_deviation;
+        if(this->z_acceleration > 0) acceleration= this->z_acceleration;
+        if(this->z_junction_deviation >= 0) junction_deviation= this->z_junction_deviation;
     }
 
     block->acceleration= acceleration; // save in block
@@ -95,13 +144,32 @@ void Planner::append_block( float actuator_pos[], float rate_mm_s, float distanc
 
     // Calculate speed in mm/sec for each axis. No divide by zero due to previous checks.
     // NOTE: Minimum stepper speed is limited by MINIMUM_STEPS_PER_MINUTE in stepper.c
-    if( distance > 0.0F ){
-        block->nominal_speed = rate_mm_s;           // (mm/s) Always > 0
-        block->nominal_rate = ceilf(block->steps_event_count * rate_mm_s / distance); // (step/s) Always > 0
+    if( distance > 0 ){
+        block->nominal_speed = rate;                // (mm/s) Always > 0
+        block->nominal_rate = muldiv_ceil((uint64_t)block->steps_event_count * STEP_RATE_ONE, rate, distance); // (1/256 step/s) Always > 0
     }else{
-        block->nominal_speed = 0.0F;
+        block->nominal_speed = 0;
         block->nominal_rate  = 0;
     }
+    block->rapid = rapid;
+
+    // The step ticker makes at most max_steps_per_tick steps of a motor every tick, a block that needs more is slowed
+    // down. The first time it is by more than the rounding of the actuator max rates the user is told the limits in effect,
+    // max_steps_per_tick may be lower than configured, see Kernel
+    uint32_t max_step_rate = THEKERNEL->step_ticker->get_max_step_rate() * STEP_RATE_ONE;
+    if( block->nominal_rate > max_step_rate ){
+        if( !this->step_rate_warned && block->nominal_rate > max_step_rate + max_step_rate / 100 ){
+            this->step_rate_warned = true;
+            THEKERNEL->streams->printf("WARNING: a move needs %lu steps/s, above the %lu steps/s the step ticker can make with base_stepping_frequency %lu and max_steps_per_tick %d, it is slowed down\n",
+                                       (unsigned long)(block->nominal_rate >> STEP_RATE_SHIFT), (unsigned long)(max_step_rate >> STEP_RATE_SHIFT),
+                                       (unsigned long)THEKERNEL->step_ticker->get_frequency(), THEKERNEL->step_ticker->get_max_steps_per_tick());
+        }
+        block->nominal_speed = muldiv(block->nominal_speed, max_step_rate, block->nominal_rate);
+        block->nominal_rate = max_step_rate;
+    }
+    // the overrides are kept below the limits too, the limit is never below the rate the block was planned for
+    uint32_t rate_limit = (distance > 0) ? muldiv((uint64_t)block->steps_event_count * STEP_RATE_ONE, max_rate, distance) : 0;
+    block->rate_limit = max(min(rate_limit, max_step_rate), (uint32_t)block->nominal_rate);
 
     // Compute the acceleration rate for the trapezoid generator. Depending on the slope of the line
     // average travel per step event changes. For a line along one axis the travel per step event
@@ -110,7 +178,7 @@ void Planner::append_block( float actuator_pos[], float rate_mm_s, float distanc
     // To generate trapezoids with contant acceleration between blocks the rate_delta must be computed
     // specifically for each line to compensate for this phenomenon:
     // Convert universal acceleration for direction-dependent stepper rate change parameter
-    block->rate_delta = (block->steps_event_count * acceleration) / (distance * THEKERNEL->acceleration_ticks_per_second); // (step/min/acceleration_tick)
+    block->rate_delta = (distance > 0) ? muldiv((uint64_t)block->steps_event_count * STEP_RATE_ONE, acceleration, (uint64_t)distance * THEKERNEL->acceleration_ticks_per_second) : 0; // (1/256 step/s/acceleration_tick)
 
     // Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
     // Let a circle be tangent to both previous and current path line segments, where the junction
@@ -124,27 +192,33 @@ void Planner::append_block( float actuator_pos[], float rate_mm_s, float distanc
 
     // NOTE however it does not take into account independent axis, in most cartesian X and Y and Z are totally independent
     // and this allows one to stop with little to no decleration in many cases. This is particualrly bad on leadscrew based systems that will skip steps.
-    float vmax_junction = minimum_planner_speed; // Set default max junction speed
+    uint32_t vmax_junction = minimum_planner_speed; // Set default max junction speed
 
     if (!THEKERNEL->conveyor->is_queue_empty())
     {
-        float previous_nominal_speed = THEKERNEL->conveyor->queue.item_ref(THEKERNEL->conveyor->queue.prev(THEKERNEL->conveyor->queue.head_i))->nominal_speed;
+        uint32_t previous_nominal_speed = THEKERNEL->conveyor->queue.item_ref(THEKERNEL->conveyor->queue.prev(THEKERNEL->conveyor->queue.head_i))->nominal_speed;
 
-        if (previous_nominal_speed > 0.0F && junction_deviation > 0.0F) {
+        if (previous_nominal_speed > 0 && junction_deviation > 0) {
             // Compute cosine of angle between previous and current path. (prev_unit_vec is negative)
             // NOTE: Max junction velocity is computed without sin() or acos() by trig half angle identity.
-            float cos_theta = - this->previous_unit_vec[X_AXIS] * unit_vec[X_AXIS]
-                                - this->previous_unit_vec[Y_AXIS] * unit_vec[Y_AXIS]
-                                - this->previous_unit_vec[Z_AXIS] * unit_vec[Z_AXIS] ;
+            // The unit vectors are in 2^-30, so is the cosine.
+            const int32_t one = 1 << UNIT_VECTOR_SHIFT;
+            const int32_t cos_limit = 0.95 * one;
+            int32_t cos_theta = -(( (int64_t)this->previous_unit_vec[X_AXIS] * unit_vec[X_AXIS]
+                                  + (int64_t)this->previous_unit_vec[Y_AXIS] * unit_vec[Y_AXIS]
+                                  + (int64_t)this->previous_unit_vec[Z_AXIS] * unit_vec[Z_AXIS] ) >> UNIT_VECTOR_SHIFT);
 
             // Skip and use default max junction speed for 0 degree acute junction.
-            if (cos_theta < 0.95F) {
+            if (cos_theta < cos_limit) {
                 vmax_junction = min(previous_nominal_speed, block->nominal_speed);
                 // Skip and avoid divide by zero for straight junctions at 180 degrees. Limit to min() of nominal speeds.
-                if (cos_theta > -0.95F) {
+                if (cos_theta > -cos_limit) {
                     // Compute maximum junction velocity based on maximum acceleration and junction deviation
-                    float sin_theta_d2 = sqrtf(0.5F * (1.0F - cos_theta)); // Trig half angle identity. Always positive.
-                    vmax_junction = min(vmax_junction, sqrtf(acceleration * junction_deviation * sin_theta_d2 / (1.0F - sin_theta_d2)));
+                    uint32_t sin_theta_d2 = isqrt64((uint64_t)(one - cos_theta) << (UNIT_VECTOR_SHIFT - 1)); // Trig half angle identity. Always positive.
+                    // sin_theta_d2 / (1 - sin_theta_d2) is below 80 here, in 2^-16
+                    uint32_t ratio = ((uint64_t)sin_theta_d2 << 16) / (one - sin_theta_d2);
+                    uint64_t squared = mul_saturate64(((uint64_t)acceleration * junction_deviation) >> 16, ratio);
+                    vmax_junction = min(vmax_junction, isqrt64(squared));
                 }
             }
         }
@@ -152,7 +226,7 @@ void Planner::append_block( float actuator_pos[], float rate_mm_s, float distanc
     block->max_entry_speed = vmax_junction;
 
     // Initialize block entry speed. Compute based on deceleration to user-defined minimum_planner_speed.
-    float v_allowable = max_allowable_speed(-acceleration, minimum_planner_speed, block->millimeters);
+    uint32_t v_allowable = block->max_reachable_speed(minimum_planner_speed, block->millimeters);
     block->entry_speed = min(vmax_junction, v_allowable);
 
     // Initialize planner efficiency flags
@@ -213,6 +287,10 @@ void Planner::recalculate() {
      *     then we're accel limited. set recalculate to false, work out max exit speed
      *
      * finally, work out trapezoid for the final (and newest) block.
+     *
+     * the recalculate flag already plays the part of Grbl's planned block pointer: forward_pass clears it on
+     * every block that is accel limited or enters at its max entry speed, so the reverse pass stops at the newest
+     * block whose entry speed is final and each append only touches the blocks that can still change.
      */
 
     /*
@@ -220,7 +298,7 @@ void Planner::recalculate() {
      * For each block, given the exit speed and acceleration, find the maximum entry speed
      */
 
-    float entry_speed = minimum_planner_speed;
+    uint32_t entry_speed = minimum_planner_speed;
 
     block_index = queue.head_i;
     current     = queue.item_ref(block_index);
@@ -244,7 +322,7 @@ void Planner::recalculate() {
          * each block from current to head has its entry speed set to its max entry speed- limited by decel or nominal_rate
          */
 
-        float exit_speed = current->max_exit_speed();
+        uint32_t exit_speed = current->max_exit_speed();
 
         while (block_index != queue.head_i)
         {
@@ -271,12 +349,27 @@ void Planner::recalculate() {
 }
 
 
-// Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the
-// acceleration within the allotted distance.
-float Planner::max_allowable_speed(float acceleration, float target_velocity, float distance) {
-  return(
-    sqrtf(target_velocity*target_velocity-2.0F*acceleration*distance)  //Was acceleration*60*60*distance, in case this breaks, but here we prefer to use seconds instead of minutes
-  );
+// Plans the blocks that have not begun again, after the executing block was given a new exit speed by a feed hold.
+// The exit speed can only have gone down, so a forward pass from it is enough: the entry speeds the reverse passes
+// found still hold, they can only be lowered to what the blocks before them can now reach.
+void Planner::replan(uint32_t exit_speed)
+{
+    Conveyor *conveyor = THEKERNEL->conveyor;
+    Conveyor::Queue_t &queue = conveyor->queue;
+
+    if (conveyor->gc_pending == queue.head_i) return;
+
+    // the newest block is planned before it is queued, it may be waiting for room in the queue
+    unsigned int end = queue.head_i;
+    if (queue.head_ref()->is_ready)
+        end = queue.next(end);
+
+    Block* previous = queue.item_ref(conveyor->gc_pending);
+    for (unsigned int block_index = queue.next(conveyor->gc_pending); block_index != end; block_index = queue.next(block_index)) {
+        Block* current = queue.item_ref(block_index);
+        exit_speed = current->forward_pass(exit_speed);
+        previous->calculate_trapezoid(previous->entry_speed, current->entry_speed);
+        previous = current;
+    }
+    previous->calculate_trapezoid(previous->entry_speed, minimum_planner_speed);
 }
-
-
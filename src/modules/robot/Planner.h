@@ -8,30 +8,59 @@
 #ifndef PLANNER_H
 #define PLANNER_H
 
+#include <stdint.h>
+
 class Block;
 
+// The planner works in fixed point: lengths, speeds and accelerations in 1/65536 mm, mm/s and mm/s^2, up to 65535 of
+// them in 32 bits, and the squares of the speeds in 64 bits. The settings and the gcodes are floats, they are converted
+// once, see Robot::append_milestone()
+#define MM_SHIFT 16
+#define MM_ONE   (1 << MM_SHIFT)
+
+// The unit vectors of the moves are in 1/2^30, see Planner::move_length()
+#define UNIT_VECTOR_SHIFT 30
+
+// mm, mm/s or mm/s^2 in the units of the planner, rounded to the nearest, 0 for a negative value and UINT32_MAX for
+// one that does not fit
+static inline uint32_t mm_to_fixed(float mm)
+{
+    if (!(mm > 0.0F)) return 0;
+    if (mm >= 65536.0F) return UINT32_MAX;
+    return (uint32_t)(mm * MM_ONE + 0.5F);
+}
+
+static inline float fixed_to_mm(uint32_t fixed)
+{
+    return (float)fixed / MM_ONE;
+}
+
 class Planner
 {
 public:
     Planner();
-    void append_block( float target[], float rate_mm_s, float distance, float unit_vec[] );
-    float max_allowable_speed( float acceleration, float target_velocity, float distance);
+    void append_block( float target[], uint32_t rate, uint32_t distance, const int32_t unit_vec[], uint32_t max_rate, bool rapid );
+    static uint32_t move_length(const float deltas[], int32_t unit_vec[]);
     void recalculate();
+    void replan(uint32_t exit_speed);
     Block *get_current_block();
     void cleanup_queue();
-    float get_acceleration() const { return acceleration; }
-    float get_z_acceleration() const { return z_acceleration > 0.0F ? z_acceleration : acceleration; }
+    float get_acceleration() const { return fixed_to_mm(acceleration); }
+    float get_z_acceleration() const { return fixed_to_mm(z_acceleration > 0 ? z_acceleration : acceleration); }
+    float get_jerk() const { return jerk; }     // in mm/s^3, the same for every block, 0 for trapezoids
 
     friend class Robot; // for acceleration, junction deviation, minimum_planner_speed
 
 private:
     void config_load();
-    float previous_unit_vec[3];
-    float acceleration;          // Setting
-    float z_acceleration;        // Setting
-    float junction_deviation;    // Setting
-    float z_junction_deviation;  // Setting
-    float minimum_planner_speed; // Setting
+    int32_t previous_unit_vec[3];
+    uint32_t acceleration;          // Setting, in 1/65536 mm/s^2 like the other lengths and speeds, see MM_ONE
+    uint32_t z_acceleration;        // Setting, 0 uses acceleration
+    float jerk;                     // Setting
+    uint32_t junction_deviation;    // Setting
+    int32_t z_junction_deviation;   // Setting, below 0 uses junction_deviation
+    uint32_t minimum_planner_speed; // Setting
+    bool step_rate_warned;       // a block was slowed down to the step ticker limit
 };
 
 
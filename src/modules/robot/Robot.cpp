@@ -16,6 +16,7 @@ using std::string;
 
 #include "Planner.h"
 #include "Conveyor.h"
+#include "Stepper.h"
 #include "Robot.h"
 #include "nuts_bolts.h"
 #include "Pin.h"
@@ -35,13 +36,18 @@ using std::string;
 #include "ConfigValue.h"
 #include "libs/StreamOutput.h"
 #include "StreamOutputPool.h"
+#include "fixedpoint.h"
 
 #define  default_seek_rate_checksum          CHECKSUM("default_seek_rate")
 #define  default_feed_rate_checksum          CHECKSUM("default_feed_rate")
 #define  mm_per_line_segment_checksum        CHECKSUM("mm_per_line_segment")
 #define  delta_segments_per_second_checksum  CHECKSUM("delta_segments_per_second")
+#define  mm_max_line_error_checksum          CHECKSUM("mm_max_line_error")
+#define  line_coalescing_tolerance_checksum  CHECKSUM("line_coalescing_tolerance")
 #define  mm_per_arc_segment_checksum         CHECKSUM("mm_per_arc_segment")
 #define  arc_correction_checksum             CHECKSUM("arc_correction")
+#define  mm_max_arc_error_checksum           CHECKSUM("mm_max_arc_error")
+#define  ms_per_arc_segment_checksum         CHECKSUM("ms_per_arc_segment")
 #define  x_axis_max_speed_checksum           CHECKSUM("x_axis_max_speed")
 #define  y_axis_max_speed_checksum           CHECKSUM("y_axis_max_speed")
 #define  z_axis_max_speed_checksum           CHECKSUM("z_axis_max_speed")
@@ -130,6 +136,9 @@ Robot::Robot()
     this->clearToolOffset();
     this->compensationTransform= nullptr;
     this->halted= false;
+    this->has_pending= false;
+    this->pending_rapid= false;
+    this->pending_merged= false;
 }
 
 //Called when the module has just been loaded
@@ -139,6 +148,7 @@ void Robot::on_module_loaded()
     this->register_for_event(ON_GET_PUBLIC_DATA);
     this->register_for_event(ON_SET_PUBLIC_DATA);
     this->register_for_event(ON_HALT);
+    this->register_for_event(ON_MAIN_LOOP);
 
     // Configuration
     this->on_config_reload(this);
@@ -178,8 +188,12 @@ void Robot::on_config_reload(void *argument)
     this->seek_rate           = THEKERNEL->config->value(default_seek_rate_checksum   )->by_default(  100.0F)->as_number();
     this->mm_per_line_segment = THEKERNEL->config->value(mm_per_line_segment_checksum )->by_default(    0.0F)->as_number();
     this->delta_segments_per_second = THEKERNEL->config->value(delta_segments_per_second_checksum )->by_default(0.0f   )->as_number();
+    this->mm_max_line_error   = THEKERNEL->config->value(mm_max_line_error_checksum   )->by_default(    0.0f)->as_number();
+    this->line_coalescing_tolerance = THEKERNEL->config->value(line_coalescing_tolerance_checksum )->by_default(0.0f   )->as_number();
     this->mm_per_arc_segment  = THEKERNEL->config->value(mm_per_arc_segment_checksum  )->by_default(    0.5f)->as_number();
     this->arc_correction      = THEKERNEL->config->value(arc_correction_checksum      )->by_default(    5   )->as_number();
+    this->mm_max_arc_error    = THEKERNEL->config->value(mm_max_arc_error_checksum    )->by_default(    0.0f)->as_number();
+    this->ms_per_arc_segment  = THEKERNEL->config->value(ms_per_arc_segment_checksum  )->by_default(    0.0f)->as_number();
 
     this->max_speeds[X_AXIS]  = THEKERNEL->config->value(x_axis_max_speed_checksum    )->by_default(60000.0F)->as_number() / 60.0F;
     this->max_speeds[Y_AXIS]  = THEKERNEL->config->value(y_axis_max_speed_checksum    )->by_default(60000.0F)->as_number() / 60.0F;
@@ -243,31 +257,51 @@ void Robot::on_config_reload(void *argument)
 }
 
 // this does a sanity check that actuator speeds do not exceed steps rate capability
-// we will override the actuator max_rate if the combination of max_rate and steps/sec exceeds base_stepping_frequency
+// we will override the actuator max_rate if the combination of max_rate and steps/sec exceeds the step rate limit,
+// base_stepping_frequency times the steps the step ticker can make in a tick
 void Robot::check_max_actuator_speeds()
 {
+    uint32_t max_step_rate= THEKERNEL->step_ticker->get_max_step_rate();
+
     float step_freq= alpha_stepper_motor->get_max_rate() * alpha_stepper_motor->get_steps_per_mm();
-    if(step_freq > THEKERNEL->base_stepping_frequency) {
-        alpha_stepper_motor->set_max_rate(floorf(THEKERNEL->base_stepping_frequency / alpha_stepper_motor->get_steps_per_mm()));
-        THEKERNEL->streams->printf("WARNING: alpha_max_rate exceeds base_stepping_frequency * alpha_steps_per_mm: %f, setting to %f\n", step_freq, alpha_stepper_motor->max_rate);
+    if(step_freq > max_step_rate) {
+        alpha_stepper_motor->set_max_rate(floorf(max_step_rate / alpha_stepper_motor->get_steps_per_mm()));
+        THEKERNEL->streams->printf("WARNING: alpha_max_rate exceeds the step rate limit of %lu steps/s / alpha_steps_per_mm: %f, setting to %f\n", (unsigned long)max_step_rate, step_freq, alpha_stepper_motor->max_rate);
     }
 
     step_freq= beta_stepper_motor->get_max_rate() * beta_stepper_motor->get_steps_per_mm();
-    if(step_freq > THEKERNEL->base_stepping_frequency) {
-        beta_stepper_motor->set_max_rate(floorf(THEKERNEL->base_stepping_frequency / beta_stepper_motor->get_steps_per_mm()));
-        THEKERNEL->streams->printf("WARNING: beta_max_rate exceeds base_stepping_frequency * beta_steps_per_mm: %f, setting to %f\n", step_freq, beta_stepper_motor->max_rate);
+    if(step_freq > max_step_rate) {
+        beta_stepper_motor->set_max_rate(floorf(max_step_rate / beta_stepper_motor->get_steps_per_mm()));
+        THEKERNEL->streams->printf("WARNING: beta_max_rate exceeds the step rate limit of %lu steps/s / beta_steps_per_mm: %f, setting to %f\n", (unsigned long)max_step_rate, step_freq, beta_stepper_motor->max_rate);
     }
 
     step_freq= gamma_stepper_motor->get_max_rate() * gamma_stepper_motor->get_steps_per_mm();
-    if(step_freq > THEKERNEL->base_stepping_frequency) {
-        gamma_stepper_motor->set_max_rate(floorf(THEKERNEL->base_stepping_frequency / gamma_stepper_motor->get_steps_per_mm()));
-        THEKERNEL->streams->printf("WARNING: gamma_max_rate exceeds base_stepping_frequency * gamma_steps_per_mm: %f, setting to %f\n", step_freq, gamma_stepper_motor->max_rate);
+    if(step_freq > max_step_rate) {
+        gamma_stepper_motor->set_max_rate(floorf(max_step_rate / gamma_stepper_motor->get_steps_per_mm()));
+        THEKERNEL->streams->printf("WARNING: gamma_max_rate exceeds the step rate limit of %lu steps/s / gamma_steps_per_mm: %f, setting to %f\n", (unsigned long)max_step_rate, step_freq, gamma_stepper_motor->max_rate);
     }
 }
 
 void Robot::on_halt(void *arg)
 {
     halted= (arg == nullptr);
+
+    // drop the line that was held back, last_milestone is still where the queued moves end
+    if(halted)
+        has_pending= false;
+}
+
+// Holding a line back only pays while the queue is full, the planner is then behind and merging lines saves it work.
+// The line is queued as soon as there is room for it, or once no line came in for a whole pass of the main loop.
+void Robot::on_main_loop(void *argument)
+{
+    if(!has_pending)
+        return;
+
+    if(!THEKERNEL->conveyor->is_queue_full() || !pending_merged)
+        flush_pending_milestone();
+    else
+        pending_merged = false;
 }
 
 void Robot::on_get_public_data(void *argument)
@@ -278,15 +312,18 @@ void Robot::on_get_public_data(void *argument)
 
     if(pdr->second_element_is(speed_override_percent_checksum)) {
         static float return_data;
-        return_data = 100.0F * 60.0F / seconds_per_minute;
+        return_data = THEKERNEL->stepper->get_feed_override();
         pdr->set_data_ptr(&return_data);
         pdr->set_taken();
 
     } else if(pdr->second_element_is(current_position_checksum)) {
+        // where the machine ends up, with the line held back for coalescing, which jogs are made relative to
         static float return_data[3];
-        return_data[0] = from_millimeters(this->last_milestone[0]);
-        return_data[1] = from_millimeters(this->last_milestone[1]);
-        return_data[2] = from_millimeters(this->last_milestone[2]);
+        float position[3];
+        get_axis_position(position);
+        return_data[0] = from_millimeters(position[0]);
+        return_data[1] = from_millimeters(position[1]);
+        return_data[2] = from_millimeters(position[2]);
 
         pdr->set_data_ptr(&return_data);
         pdr->set_taken();
@@ -300,15 +337,16 @@ void Robot::on_set_public_data(void *argument)
     if(!pdr->starts_with(robot_checksum)) return;
 
     if(pdr->second_element_is(speed_override_percent_checksum)) {
-        // NOTE do not use this while printing!
         float t = *static_cast<float *>(pdr->get_data_ptr());
         // enforce minimum 10% speed
         if (t < 10.0F) t = 10.0F;
 
-        this->seconds_per_minute = t / 0.6F; // t * 60 / 100
+        THEKERNEL->stepper->set_feed_override(t);
         pdr->set_taken();
     } else if(pdr->second_element_is(current_position_checksum)) {
         float *t = static_cast<float *>(pdr->get_data_ptr());
+        // the held line ends at the old position, queue it before the position is changed
+        flush_pending_milestone();
         for (int i = 0; i < 3; i++) {
             this->last_milestone[i] = this->to_millimeters(t[i]);
         }
@@ -328,6 +366,10 @@ void Robot::on_gcode_received(void *argument)
 {
     Gcode *gcode = static_cast<Gcode *>(argument);
 
+    // anything but another plain line ends the line that is held back, so it is queued before this gcode acts
+    if(has_pending && !can_coalesce(gcode))
+        flush_pending_milestone();
+
     this->motion_mode = -1;
 
     //G-letter Gcodes are mostly what the Robot module is interrested in, other modules also catch the gcode event and do stuff accordingly
@@ -463,14 +505,14 @@ void Robot::on_gcode_received(void *argument)
                     // enforce minimum
                     if (acc < 1.0F)
                         acc = 1.0F;
-                    THEKERNEL->planner->acceleration = acc;
+                    THEKERNEL->planner->acceleration = mm_to_fixed(acc);
                 }
                 if (gcode->has_letter('Z')) {
                     float acc = gcode->get_value('Z'); // mm/s^2
                     // enforce positive
                     if (acc < 0.0F)
                         acc = 0.0F;
-                    THEKERNEL->planner->z_acceleration = acc;
+                    THEKERNEL->planner->z_acceleration = mm_to_fixed(acc);
                 }
                 break;
 
@@ -481,28 +523,28 @@ void Robot::on_gcode_received(void *argument)
                     // enforce minimum
                     if (jd < 0.0F)
                         jd = 0.0F;
-                    THEKERNEL->planner->junction_deviation = jd;
+                    THEKERNEL->planner->junction_deviation = mm_to_fixed(jd);
                 }
                 if (gcode->has_letter('Z')) {
                     float jd = gcode->get_value('Z');
                     // enforce minimum, -1 disables it and uses regular junction deviation
                     if (jd < -1.0F)
                         jd = -1.0F;
-                    THEKERNEL->planner->z_junction_deviation = jd;
+                    THEKERNEL->planner->z_junction_deviation = (jd < 0.0F) ? -1 : min(mm_to_fixed(jd), (uint32_t)INT32_MAX);
                 }
                 if (gcode->has_letter('S')) {
                     float mps = gcode->get_value('S');
                     // enforce minimum
                     if (mps < 0.0F)
                         mps = 0.0F;
-                    THEKERNEL->planner->minimum_planner_speed = mps;
+                    THEKERNEL->planner->minimum_planner_speed = mm_to_fixed(mps);
                 }
                 if (gcode->has_letter('Y')) {
-                    alpha_stepper_motor->default_minimum_actuator_rate = gcode->get_value('Y');
+                    alpha_stepper_motor->default_minimum_actuator_rate = gcode->get_value('Y') * STEP_RATE_ONE;
                 }
                 break;
 
-            case 220: // M220 - speed override percentage
+            case 220: // M220 - speed override percentage, S for feeds and R for rapids, applied to the queued moves too
                 gcode->mark_as_taken();
                 if (gcode->has_letter('S')) {
                     float factor = gcode->get_value('S');
@@ -513,7 +555,21 @@ void Robot::on_gcode_received(void *argument)
                     if (factor > 1000.0F)
                         factor = 1000.0F;
 
-                    seconds_per_minute = 6000.0F / factor;
+                    THEKERNEL->stepper->set_feed_override(factor);
+                }
+                if (gcode->has_letter('R')) {
+                    // rapids are already at the axis limits, they can only be slowed down
+                    float factor = gcode->get_value('R');
+                    if (factor < 10.0F)
+                        factor = 10.0F;
+                    if (factor > 100.0F)
+                        factor = 100.0F;
+
+                    THEKERNEL->stepper->set_rapid_override(factor);
+                }
+                if (!gcode->has_letter('S') && !gcode->has_letter('R')) {
+                    gcode->stream->printf("S:%g R:%g ", THEKERNEL->stepper->get_feed_override(), THEKERNEL->stepper->get_rapid_override());
+                    gcode->add_nl = true;
                 }
                 break;
 
@@ -525,8 +581,9 @@ void Robot::on_gcode_received(void *argument)
             case 500: // M500 saves some volatile settings to config override file
             case 503: { // M503 just prints the settings
                 gcode->stream->printf(";Steps per unit:\nM92 X%1.5f Y%1.5f Z%1.5f\n", actuators[0]->steps_per_mm, actuators[1]->steps_per_mm, actuators[2]->steps_per_mm);
-                gcode->stream->printf(";Acceleration mm/sec^2:\nM204 S%1.5f Z%1.5f\n", THEKERNEL->planner->acceleration, THEKERNEL->planner->z_acceleration);
-                gcode->stream->printf(";X- Junction Deviation, Z- Z junction deviation, S - Minimum Planner speed mm/sec:\nM205 X%1.5f Z%1.5f S%1.5f\n", THEKERNEL->planner->junction_deviation, THEKERNEL->planner->z_junction_deviation, THEKERNEL->planner->minimum_planner_speed);
+                gcode->stream->printf(";Acceleration mm/sec^2:\nM204 S%1.5f Z%1.5f\n", fixed_to_mm(THEKERNEL->planner->acceleration), fixed_to_mm(THEKERNEL->planner->z_acceleration));
+                gcode->stream->printf(";X- Junction Deviation, Z- Z junction deviation, S - Minimum Planner speed mm/sec:\nM205 X%1.5f Z%1.5f S%1.5f\n", fixed_to_mm(THEKERNEL->planner->junction_deviation),
+                                      (THEKERNEL->planner->z_junction_deviation < 0) ? -1.0F : fixed_to_mm(THEKERNEL->planner->z_junction_deviation), fixed_to_mm(THEKERNEL->planner->minimum_planner_speed));
                 gcode->stream->printf(";Max feedrates in mm/sec, XYZ cartesian, ABC actuator:\nM203 X%1.5f Y%1.5f Z%1.5f A%1.5f B%1.5f C%1.5f\n",
                                       this->max_speeds[X_AXIS], this->max_speeds[Y_AXIS], this->max_speeds[Z_AXIS],
                                       alpha_stepper_motor->get_max_rate(), beta_stepper_motor->get_max_rate(), gamma_stepper_motor->get_max_rate());
@@ -566,11 +623,13 @@ void Robot::on_gcode_received(void *argument)
 
                 if(gcode->has_letter('S')) { // set delta segments per second, not saved by M500
                     this->delta_segments_per_second = gcode->get_value('S');
+                    this->mm_max_line_error = 0;
                     gcode->stream->printf("Delta segments set to %8.4f segs/sec\n", this->delta_segments_per_second);
 
                 }else if(gcode->has_letter('U')) { // or set mm_per_line_segment, not saved by M500
                     this->mm_per_line_segment = gcode->get_value('U');
                     this->delta_segments_per_second = 0;
+                    this->mm_max_line_error = 0;
                     gcode->stream->printf("mm per line segment set to %8.4f\n", this->mm_per_line_segment);
                 }
 
@@ -586,7 +645,7 @@ void Robot::on_gcode_received(void *argument)
     float target[3], offset[3];
     clear_vector(offset);
 
-    memcpy(target, this->last_milestone, sizeof(target));    //default to last target
+    memcpy(target, this->has_pending ? this->pending_target : this->last_milestone, sizeof(target));    //default to last target
 
     for(char letter = 'I'; letter <= 'K'; letter++) {
         if( gcode->has_letter(letter) ) {
@@ -609,8 +668,8 @@ void Robot::on_gcode_received(void *argument)
     //Perform any physical actions
     switch(this->motion_mode) {
         case MOTION_MODE_CANCEL: break;
-        case MOTION_MODE_SEEK  : this->append_line(gcode, target, this->seek_rate / seconds_per_minute ); break;
-        case MOTION_MODE_LINEAR: this->append_line(gcode, target, this->feed_rate / seconds_per_minute ); break;
+        case MOTION_MODE_SEEK  : this->append_line(gcode, target, this->seek_rate / seconds_per_minute, true ); break;
+        case MOTION_MODE_LINEAR: this->append_line(gcode, target, this->feed_rate / seconds_per_minute, false ); break;
         case MOTION_MODE_CW_ARC:
         case MOTION_MODE_CCW_ARC: this->compute_arc(gcode, offset, target ); break;
     }
@@ -631,6 +690,7 @@ void Robot::distance_in_gcode_is_known(Gcode *gcode)
 // reset the position for all axis (used in homing for delta as last_milestone may be bogus)
 void Robot::reset_axis_position(float x, float y, float z)
 {
+    flush_pending_milestone();
     this->last_milestone[X_AXIS] = x;
     this->last_milestone[Y_AXIS] = y;
     this->last_milestone[Z_AXIS] = z;
@@ -647,6 +707,7 @@ void Robot::reset_axis_position(float x, float y, float z)
 // Reset the position for an axis (used in homing and G92)
 void Robot::reset_axis_position(float position, int axis)
 {
+    flush_pending_milestone();
     this->last_milestone[axis] = position;
     this->transformed_last_milestone[axis] = position;
 
@@ -660,6 +721,7 @@ void Robot::reset_axis_position(float position, int axis)
 // Use FK to find out where actuator is and reset lastmilestone to match
 void Robot::reset_position_from_current_actuator_position()
 {
+    flush_pending_milestone();
     float actuator_pos[]= {actuators[X_AXIS]->get_current_position(), actuators[Y_AXIS]->get_current_position(), actuators[Z_AXIS]->get_current_position()};
     arm_solution->actuator_to_cartesian(actuator_pos, this->last_milestone);
     memcpy(this->transformed_last_milestone, this->last_milestone, sizeof(this->transformed_last_milestone));
@@ -671,13 +733,14 @@ void Robot::reset_position_from_current_actuator_position()
 }
 
 // Convert target from millimeters to steps, and append this to the planner
-void Robot::append_milestone( float target[], float rate_mm_s )
+// rapid is set for G0 seeks, the rapid override applies to them instead of the feed override
+void Robot::append_milestone( float target[], float rate_mm_s, bool rapid )
 {
     float deltas[3];
-    float unit_vec[3];
+    int32_t unit_vec[3];
     float actuator_pos[3];
     float transformed_target[3]; // adjust target for bed compensation
-    float millimeters_of_travel;
+    uint32_t millimeters_of_travel;
 
     // unity transform by default
     memcpy(transformed_target, target, sizeof(transformed_target));
@@ -695,20 +758,19 @@ void Robot::append_milestone( float target[], float rate_mm_s )
     // store last transformed
     memcpy(this->transformed_last_milestone, transformed_target, sizeof(this->transformed_last_milestone));
 
-    // Compute how long this move moves, so we can attach it to the block for later use
-    millimeters_of_travel = sqrtf( powf( deltas[X_AXIS], 2 ) +  powf( deltas[Y_AXIS], 2 ) +  powf( deltas[Z_AXIS], 2 ) );
-
-    // find distance unit vector
-    for (int i = 0; i < 3; i++)
-        unit_vec[i] = deltas[i] / millimeters_of_travel;
+    // Compute how long this move moves, so we can attach it to the block for later use, and the distance unit vector.
+    // From here on the planner works in fixed point, see MM_ONE
+    millimeters_of_travel = Planner::move_length(deltas, unit_vec);
+    uint32_t rate = mm_to_fixed(rate_mm_s);
 
     // Do not move faster than the configured cartesian limits
+    // max_rate is as fast as the limits let this move go, the feed override can not take it above that
+    uint32_t max_rate = UINT32_MAX;
     for (int axis = X_AXIS; axis <= Z_AXIS; axis++) {
-        if ( max_speeds[axis] > 0 ) {
-            float axis_speed = fabs(unit_vec[axis] * rate_mm_s);
-
-            if (axis_speed > max_speeds[axis])
-                rate_mm_s *= ( max_speeds[axis] / axis_speed );
+        if ( max_speeds[axis] > 0 && unit_vec[axis] != 0 ) {
+            uint32_t limit = muldiv(mm_to_fixed(max_speeds[axis]), 1 << UNIT_VECTOR_SHIFT, labs(unit_vec[axis]));
+            rate = min(rate, limit);
+            max_rate = min(max_rate, limit);
         }
     }
 
@@ -717,57 +779,156 @@ void Robot::append_milestone( float target[], float rate_mm_s )
 
     // check per-actuator speed limits
     for (int actuator = 0; actuator <= 2; actuator++) {
-        float actuator_rate  = fabs(actuator_pos[actuator] - actuators[actuator]->last_milestone_mm) * rate_mm_s / millimeters_of_travel;
-
-        if (actuator_rate > actuators[actuator]->get_max_rate())
-            rate_mm_s *= (actuators[actuator]->get_max_rate() / actuator_rate);
+        uint32_t actuator_distance = mm_to_fixed(fabsf(actuator_pos[actuator] - actuators[actuator]->last_milestone_mm));
+        if (actuator_distance > 0) {
+            uint32_t limit = muldiv(mm_to_fixed(actuators[actuator]->get_max_rate()), millimeters_of_travel, actuator_distance);
+            rate = min(rate, limit);
+            max_rate = min(max_rate, limit);
+        }
     }
 
     // Append the block to the planner
-    THEKERNEL->planner->append_block( actuator_pos, rate_mm_s, millimeters_of_travel, unit_vec );
+    THEKERNEL->planner->append_block( actuator_pos, rate, millimeters_of_travel, unit_vec, max_rate, rapid );
 
     // Update the last_milestone to the current target for the next time we use last_milestone, use the requested target not the adjusted one
     memcpy(this->last_milestone, target, sizeof(this->last_milestone)); // this->last_milestone[] = target[];
 
 }
 
-// Append a move to the queue ( cutting it into segments if needed )
-void Robot::append_line(Gcode *gcode, float target[], float rate_mm_s )
+// Lines without other parameters than the target and feed rate only need the block to start them, so several of them
+// can share one block. Anything else, like an extrusion, must stay attached to a block of its own.
+bool Robot::can_coalesce(Gcode *gcode)
 {
-    // Find out the distance for this gcode
-    // NOTE we need to do sqrt here as this setting of millimeters_of_travel is used by extruder and other modules even if there is no XYZ move
-    gcode->millimeters_of_travel = sqrtf(powf( target[X_AXIS] - this->last_milestone[X_AXIS], 2 ) +  powf( target[Y_AXIS] - this->last_milestone[Y_AXIS], 2 ) +  powf( target[Z_AXIS] - this->last_milestone[Z_AXIS], 2 ));
+    if(!gcode->has_g || gcode->g > 1 || gcode->has_m)
+        return false;
 
-    // We ignore non- XYZ moves ( for example, extruder moves are not XYZ moves )
-    if( gcode->millimeters_of_travel < 0.00001F ) {
-        return;
+    int args = 0;
+    for(char letter : {'X', 'Y', 'Z', 'F'}) {
+        if(gcode->has_letter(letter)) args++;
     }
+    return gcode->get_num_args() == args;
+}
 
-    // Mark the gcode as having a known distance
-    this->distance_in_gcode_is_known( gcode );
+// Try to extend the pending line to the target. This is possible when the rate is the same, the path keeps going
+// forward, the line stays short enough not to be segmented, and every point that was merged stays within
+// line_coalescing_tolerance of the new line. The distance of the
+// earlier points is bounded by how far they were from the pending line plus how far its end is from the new line.
+bool Robot::coalesce_milestone(float target[], float rate_mm_s, bool rapid)
+{
+    if(!has_pending || rate_mm_s != this->pending_rate || rapid != this->pending_rapid)
+        return false;
+
+    float line[3], end[3], step[3];
+    for (int i = X_AXIS; i <= Z_AXIS; i++) {
+        line[i] = target[i] - this->last_milestone[i];
+        end[i] = this->pending_target[i] - this->last_milestone[i];
+        step[i] = target[i] - this->pending_target[i];
+    }
+    if(end[X_AXIS] * step[X_AXIS] + end[Y_AXIS] * step[Y_AXIS] + end[Z_AXIS] * step[Z_AXIS] <= 0.0F)
+        return false;
+
+    // distance of the end of the pending line from the new line, |end x line| / |line|
+    float cross[3] = {
+        end[Y_AXIS] * line[Z_AXIS] - end[Z_AXIS] * line[Y_AXIS],
+        end[Z_AXIS] * line[X_AXIS] - end[X_AXIS] * line[Z_AXIS],
+        end[X_AXIS] * line[Y_AXIS] - end[Y_AXIS] * line[X_AXIS]
+    };
+    float length = sqrtf(line[X_AXIS] * line[X_AXIS] + line[Y_AXIS] * line[Y_AXIS] + line[Z_AXIS] * line[Z_AXIS]);
+
+    // the merged line must not become long enough to be cut into segments, see append_line()
+    if(line_segments(this->last_milestone, target, length, rate_mm_s) > 1)
+        return false;
+    float deviation = this->pending_deviation + sqrtf(cross[X_AXIS] * cross[X_AXIS] + cross[Y_AXIS] * cross[Y_AXIS] + cross[Z_AXIS] * cross[Z_AXIS]) / length;
+    if(deviation > this->line_coalescing_tolerance)
+        return false;
+
+    this->pending_deviation = deviation;
+    memcpy(this->pending_target, target, sizeof(this->pending_target));
+    return true;
+}
 
-    // We cut the line into smaller segments. This is not usefull in a cartesian robot, but necessary for robots with rotational axes.
-    // In cartesian robot, a high "mm_per_line_segment" setting will prevent waste.
-    // In delta robots either mm_per_line_segment can be used OR delta_segments_per_second
-    // The latter is more efficient and avoids splitting fast long lines into very small segments, like initial z move to 0, it is what Johanns Marlin delta port does
-    uint16_t segments;
+// Queue the line that was held back for merging, if any
+void Robot::flush_pending_milestone()
+{
+    if(!has_pending)
+        return;
+
+    has_pending = false;
+    this->append_milestone(this->pending_target, this->pending_rate, this->pending_rapid);
+    THEKERNEL->conveyor->ensure_running();
+}
+
+// How many segments a line is cut into.
+// We cut the line into smaller segments. This is not usefull in a cartesian robot, but necessary for robots with rotational axes.
+// In cartesian robot, a high "mm_per_line_segment" setting will prevent waste.
+// In delta robots either mm_per_line_segment can be used OR delta_segments_per_second OR mm_max_line_error
+// delta_segments_per_second is more efficient and avoids splitting fast long lines into very small segments, like initial z move to 0, it is what Johanns Marlin delta port does
+// mm_max_line_error asks the arm solution how far the effector strays from the line when the actuators move linearly,
+// so pure Z moves and moves near the center of a delta stay whole and only the lines that bend get cut
+uint16_t Robot::line_segments(float from[], float to[], float length, float rate_mm_s)
+{
+    if(this->mm_max_line_error > 0.0F) {
+        // The error of a chord grows with the square of its length, so cutting the line in n cuts the error by n * n.
+        // It is sampled in the middle of the line and of both halves, the curvature of the path changes along a line.
+        float mid[3];
+        for (int i = X_AXIS; i <= Z_AXIS; i++)
+            mid[i] = (from[i] + to[i]) / 2.0F;
+        float error = max(arm_solution->segment_error(from, to),
+                          4.0F * max(arm_solution->segment_error(from, mid), arm_solution->segment_error(mid, to)));
+        return max(1.0F, min(ceilf(sqrtf(error / this->mm_max_line_error)), 65535.0F));
+    }
 
     if(this->delta_segments_per_second > 1.0F) {
         // enabled if set to something > 1, it is set to 0.0 by default
         // segment based on current speed and requested segments per second
         // the faster the travel speed the fewer segments needed
-        // NOTE rate is mm/sec and we take into account any speed override
-        float seconds = gcode->millimeters_of_travel / rate_mm_s;
-        segments = max(1.0F, ceilf(this->delta_segments_per_second * seconds));
-        // TODO if we are only moving in Z on a delta we don't really need to segment at all
+        // NOTE rate is mm/sec as programmed, the speed override is applied later by the stepper
+        float seconds = length / rate_mm_s;
+        return max(1.0F, ceilf(this->delta_segments_per_second * seconds));
+    }
 
-    } else {
-        if(this->mm_per_line_segment == 0.0F) {
-            segments = 1; // don't split it up
-        } else {
-            segments = ceilf( gcode->millimeters_of_travel / this->mm_per_line_segment);
+    if(this->mm_per_line_segment == 0.0F) {
+        return 1; // don't split it up
+    }
+    return ceilf( length / this->mm_per_line_segment);
+}
+
+// Append a move to the queue ( cutting it into segments if needed )
+void Robot::append_line(Gcode *gcode, float target[], float rate_mm_s, bool rapid )
+{
+    // the line starts where the pending line ends, if there is one
+    float *start = this->has_pending ? this->pending_target : this->last_milestone;
+
+    // Find out the distance for this gcode
+    // NOTE we need to do sqrt here as this setting of millimeters_of_travel is used by extruder and other modules even if there is no XYZ move
+    gcode->millimeters_of_travel = sqrtf(powf( target[X_AXIS] - start[X_AXIS], 2 ) +  powf( target[Y_AXIS] - start[Y_AXIS], 2 ) +  powf( target[Z_AXIS] - start[Z_AXIS], 2 ));
+
+    // We ignore non- XYZ moves ( for example, extruder moves are not XYZ moves )
+    if( gcode->millimeters_of_travel < 0.00001F ) {
+        return;
+    }
+
+    uint16_t segments = line_segments(start, target, gcode->millimeters_of_travel, rate_mm_s);
+
+    // A line that is not cut into segments may be merged with the next lines, see coalesce_milestone()
+    if(segments == 1 && this->line_coalescing_tolerance > 0.0F && !compensationTransform && can_coalesce(gcode)) {
+        if(!this->coalesce_milestone(target, rate_mm_s, rapid)) {
+            flush_pending_milestone();
+            memcpy(this->pending_target, target, sizeof(this->pending_target));
+            this->pending_rate = rate_mm_s;
+            this->pending_rapid = rapid;
+            this->pending_deviation = 0.0F;
+            this->has_pending = true;
         }
+        this->pending_merged = true;
+        // attached to the block the pending line will be queued in
+        this->distance_in_gcode_is_known( gcode );
+        return;
     }
+    flush_pending_milestone();
+
+    // Mark the gcode as having a known distance
+    this->distance_in_gcode_is_known( gcode );
 
     if (segments > 1) {
         // A vector to keep track of the endpoint of each segment
@@ -786,12 +947,12 @@ void Robot::append_line(Gcode *gcode, float target[], float rate_mm_s )
                 segment_end[axis] = last_milestone[axis] + segment_delta[axis];
 
             // Append the end of this segment to the queue
-            this->append_milestone(segment_end, rate_mm_s);
+            this->append_milestone(segment_end, rate_mm_s, rapid);
         }
     }
 
     // Append the end of this full move to the queue
-    this->append_milestone(target, rate_mm_s);
+    this->append_milestone(target, rate_mm_s, rapid);
 
     // if adding these blocks didn't start executing, do that now
     THEKERNEL->conveyor->ensure_running();
@@ -832,7 +993,24 @@ void Robot::append_arc(Gcode *gcode, float target[], float offset[], float radiu
     this->distance_in_gcode_is_known( gcode );
 
     // Figure out how many segments for this gcode
-    uint16_t segments = floorf(gcode->millimeters_of_travel / this->mm_per_arc_segment);
+    uint16_t segments;
+    float rate_mm_s = this->feed_rate / seconds_per_minute;
+
+    if(this->mm_max_arc_error > 0.0F && radius > this->mm_max_arc_error) {
+        // The chord of a segment may be at most mm_max_arc_error from the arc, r * (1 - cos(theta / 2)) <= error,
+        // so large radii get long segments and tiny radii short ones
+        float max_theta = 2.0F * acosf(1.0F - this->mm_max_arc_error / radius);
+        float n = ceilf(fabsf(angular_travel) / max_theta);
+
+        // but a segment must last at least ms_per_arc_segment at the feed rate, or the planner can not keep up
+        if(this->ms_per_arc_segment > 0.0F) {
+            float min_mm = rate_mm_s * this->ms_per_arc_segment / 1000.0F;
+            n = min(n, floorf(gcode->millimeters_of_travel / min_mm));
+        }
+        segments = max(1.0F, min(n, 65535.0F));
+    } else {
+        segments = floorf(gcode->millimeters_of_travel / this->mm_per_arc_segment);
+    }
 
     float theta_per_segment = angular_travel / segments;
     float linear_per_segment = linear_travel / segments;
@@ -899,12 +1077,12 @@ void Robot::append_arc(Gcode *gcode, float target[], float offset[], float radiu
         arc_target[this->plane_axis_2] += linear_per_segment;
 
         // Append this segment to the queue
-        this->append_milestone(arc_target, this->feed_rate / seconds_per_minute);
+        this->append_milestone(arc_target, rate_mm_s, false);
 
     }
 
     // Ensure last segment arrives at target location.
-    this->append_milestone(target, this->feed_rate / seconds_per_minute);
+    this->append_milestone(target, rate_mm_s, false);
 }
 
 // Do the math for an arc and add it to the queue
@@ -29,6 +29,7 @@ class Robot : public Module {
         void on_get_public_data(void* argument);
         void on_set_public_data(void* argument);
         void on_halt(void *arg);
+        void on_main_loop(void *argument);
 
         void reset_axis_position(float position, int axis);
         void reset_axis_position(float x, float y, float z);
@@ -56,8 +57,12 @@ class Robot : public Module {
 
     private:
         void distance_in_gcode_is_known(Gcode* gcode);
-        void append_milestone( float target[], float rate_mm_s);
-        void append_line( Gcode* gcode, float target[], float rate_mm_s);
+        void append_milestone( float target[], float rate_mm_s, bool rapid);
+        uint16_t line_segments( float from[], float to[], float length, float rate_mm_s );
+        bool coalesce_milestone( float target[], float rate_mm_s, bool rapid);
+        bool can_coalesce( Gcode* gcode );
+        void flush_pending_milestone();
+        void append_line( Gcode* gcode, float target[], float rate_mm_s, bool rapid);
         //void append_arc(float theta_start, float angular_travel, float radius, float depth, float rate);
         void append_arc( Gcode* gcode, float target[], float offset[], float radius, bool is_clockwise );
 
@@ -79,8 +84,12 @@ class Robot : public Module {
         float feed_rate;                                     // Current rate for feeding moves ( mm/s )
         float mm_per_line_segment;                           // Setting : Used to split lines into segments
         float mm_per_arc_segment;                            // Setting : Used to split arcs into segmentrs
+        float mm_max_arc_error;                              // Setting : Used to split arcs into segments by the chord error instead
+        float ms_per_arc_segment;                            // Setting : Shortest duration of an arc segment at the feed rate
         float delta_segments_per_second;                     // Setting : Used to split lines into segments for delta based on speed
-        float seconds_per_minute;                            // for realtime speed change
+        float mm_max_line_error;                             // Setting : Used to split lines into segments by the kinematic error instead
+        float line_coalescing_tolerance;                     // Setting : Consecutive lines are merged while the path stays within this many mm
+        float seconds_per_minute;                            // F of M92, feed rates are given per this many seconds
 
         // Number of arc generation iterations by small angle approximation before exact arc trajectory
         // correction. This parameter maybe decreased if there are issues with the accuracy of the arc
@@ -100,8 +109,17 @@ class Robot : public Module {
         StepperMotor* beta_stepper_motor;
         StepperMotor* gamma_stepper_motor;
 
+        // A line that is held back so the following lines can be merged into it, see coalesce_milestone(). It starts at
+        // last_milestone, which stays where the queued moves end until the line is queued.
+        float pending_target[3];                             // end of the pending line, new targets are relative to it
+        float pending_rate;
+        float pending_deviation;                             // furthest any merged point may be from the pending line
+
         struct {
             bool halted:1;
+            bool has_pending:1;
+            bool pending_rapid:1;
+            bool pending_merged:1;                           // a line was held back since the last pass of the main loop
         };
 };
 
@@ -112,8 +130,9 @@ inline float Robot::to_millimeters( float value ){
 inline float Robot::from_millimeters( float value){
     return this->inch_mode ? value/25.4 : value;
 }
+// The end of the last move, including a line that is held back for coalescing
 inline void Robot::get_axis_position(float position[]){
-    memcpy(position, this->last_milestone, sizeof(float)*3 );
+    memcpy(position, this->has_pending ? this->pending_target : this->last_milestone, sizeof(float)*3 );
 }
 
 #endif
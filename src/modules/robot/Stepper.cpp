@@ -22,6 +22,7 @@
 #include "StepTicker.h"
 
 #include <vector>
+#include <math.h>
 using namespace std;
 
 #include "libs/nuts_bolts.h"
@@ -29,13 +30,31 @@ using namespace std;
 
 #include <mri.h>
 
+#define segment_buffer_enable_checksum CHECKSUM("segment_buffer_enable")
+
 // The stepper reacts to blocks that have XYZ movement to transform them into actual stepper motor moves
 
 Stepper::Stepper()
 {
     this->current_block = NULL;
     this->paused = false;
+    this->holding = false;
+    this->resume_pending = false;
+    this->hold_replanned = false;
+    this->ramp_start = 0;
+    this->feed_override = 100;
+    this->rapid_override = 100;
+    this->override_active = false;
+    this->override_plan.block_seq = 0;
+    this->override_plan.plan_version = 0;
+    this->override_plan.percent = 0;
+    this->override_plan.rate = 0;
+    this->override_plan.braking = false;
     this->halted= false;
+    this->use_segment_buffer = false;
+    this->block_seq = 0;
+    this->block_tick = 0;
+    this->prep.block = nullptr;
 }
 
 //Called when the module has just been loaded
@@ -44,10 +63,13 @@ void Stepper::on_module_loaded()
     this->register_for_event(ON_BLOCK_BEGIN);
     this->register_for_event(ON_BLOCK_END);
     this->register_for_event(ON_GCODE_EXECUTE);
-    this->register_for_event(ON_GCODE_RECEIVED);
+    this->register_for_gcode('M', 17);
+    this->register_for_gcode('M', 18);
+    this->register_for_gcode('M', 84);
     this->register_for_event(ON_PLAY);
     this->register_for_event(ON_PAUSE);
     this->register_for_event(ON_HALT);
+    this->register_for_event(ON_IDLE);
 
     // Get onfiguration
     this->on_config_reload(this);
@@ -66,25 +88,73 @@ void Stepper::on_config_reload(void *argument)
 {
     // Steppers start off by default
     this->turn_enable_pins_off();
+
+    // when enabled the acceleration profile is computed in the main loop ahead of execution
+    this->use_segment_buffer = THEKERNEL->config->value(segment_buffer_enable_checksum)->by_default(false)->as_bool();
+
+    // the planner keeps blocks below this, it only guards the rates the profile math rounds up
+    this->max_rate = THEKERNEL->step_ticker->get_max_step_rate() * STEP_RATE_ONE;
 }
 
 // When the play/pause button is set to pause, or a module calls the ON_PAUSE event
+// This is a feed hold: a move in progress slows down with the acceleration of its block and stops where it gets to,
+// see trapezoid_generator_tick(). The steps left and the queue are kept for on_play. Can be called from an interrupt.
 void Stepper::on_pause(void *argument)
 {
-    this->paused = true;
-    THEKERNEL->robot->alpha_stepper_motor->pause();
-    THEKERNEL->robot->beta_stepper_motor->pause();
-    THEKERNEL->robot->gamma_stepper_motor->pause();
+    this->resume_pending = false;
+    if (this->paused || this->holding) return;
+
+    if (this->current_block != NULL && this->main_stepper->moving) {
+        this->holding = true;
+    } else {
+        stop_for_hold();
+    }
 }
 
 // When the play/pause button is set to play, or a module calls the ON_PLAY event
+// The queue is replanned from rest in the main loop, once the feed hold has come to a stop, see on_idle()
 void Stepper::on_play(void *argument)
 {
-    // TODO: Re-compute the whole queue for a cold-start
+    if (this->paused || this->holding) {
+        this->resume_pending = true;
+    }
+}
+
+// The feed hold has slowed the axes down enough to stop them
+void Stepper::stop_for_hold()
+{
+    for (auto a : THEKERNEL->robot->actuators) a->pause();
+    this->previous_main_rate = 0;
+    this->holding = false;
+    this->paused = true;
+
+    // modules that follow the axes, like the extruder, stop with them
+    if (this->current_block != NULL) THEKERNEL->call_event(ON_SPEED_CHANGE, this);
+}
+
+// Start again after a feed hold. What is left of the current block accelerates from rest, the blocks queued after it
+// are planned again from its new exit speed, and nothing is dropped from the queue.
+// Called from the main loop, the axes are stopped so neither the block nor the acceleration tick can change under us.
+void Stepper::resume_from_hold()
+{
+    Block *block = this->current_block;
+    if (block != NULL && this->main_stepper->moving) {
+        uint32_t stepped = this->main_stepper->stepped;
+        uint32_t exit_speed = block->plan_resume(stepped, block->exit_speed);
+        THEKERNEL->planner->replan(exit_speed);
+
+        // the rest of the block is a trapezoid followed in steps from where it stopped, the segments prepared for it
+        // in time no longer fit it
+        this->trapezoid_generator_reset();
+        this->set_ramps(stepped);
+        this->hold_replanned = true;
+        if (block->decelerate_after > stepped && block->decelerate_after + 1 < this->main_stepper->steps_to_move) {
+            this->main_stepper->signal_step = block->decelerate_after + 1;
+        }
+    }
+
     this->paused = false;
-    THEKERNEL->robot->alpha_stepper_motor->unpause();
-    THEKERNEL->robot->beta_stepper_motor->unpause();
-    THEKERNEL->robot->gamma_stepper_motor->unpause();
+    for (auto a : THEKERNEL->robot->actuators) a->unpause();
 }
 
 void Stepper::on_halt(void *argument)
@@ -143,7 +213,7 @@ void Stepper::on_block_begin(void *argument)
     Block *block  = static_cast<Block *>(argument);
 
     // Mark the new block as of interrest to us, handle blocks that have no axis moves properly (like Extrude blocks etc)
-    if(block->millimeters > 0.0F && (block->steps[ALPHA_STEPPER] > 0 || block->steps[BETA_STEPPER] > 0 || block->steps[GAMMA_STEPPER] > 0) ) {
+    if(block->millimeters > 0 && (block->steps[ALPHA_STEPPER] > 0 || block->steps[BETA_STEPPER] > 0 || block->steps[GAMMA_STEPPER] > 0) ) {
         block->take();
     } else {
         THEKERNEL->robot->alpha_stepper_motor->move(0, 0);
@@ -159,13 +229,29 @@ void Stepper::on_block_begin(void *argument)
     
     // If the block end speed is more larger than acceleration delta, keep moving
     // between blocks to avoid jerks.
-    bool keep_moving = (block->final_rate > block->rate_delta);
-    
+    // The Bresenham engine makes exactly the steps of each block instead.
+    bool bresenham = THEKERNEL->step_ticker->is_bresenham();
+    bool keep_moving = !bresenham && (block->final_rate > block->rate_delta);
+
+    // With the Bresenham engine the actuator with the most steps leads and the others step along with it,
+    // the step ticker has to know before any of them is given its move
+    if (bresenham) {
+        int lead = 0;
+        for (int i = 1; i < 3; i++) {
+            if (block->steps[i] > block->steps[lead]) lead = i;
+        }
+        uint32_t followers = 0;
+        for (int i = 0; i < 3; i++) {
+            if (i != lead) followers |= 1 << THEKERNEL->robot->actuators[i]->index;
+        }
+        THEKERNEL->step_ticker->set_lead_motor(THEKERNEL->robot->actuators[lead], followers);
+    }
+
     // Setup : instruct stepper motors to move
     // Find the stepper with the more steps, it's the one the speed calculations will want to follow
     this->main_stepper= nullptr;
     if( block->steps[ALPHA_STEPPER] > 0 ) {
-        THEKERNEL->robot->alpha_stepper_motor->move( block->direction_bits[ALPHA_STEPPER], block->steps[ALPHA_STEPPER]);
+        THEKERNEL->robot->alpha_stepper_motor->move( block->direction(ALPHA_STEPPER), block->steps[ALPHA_STEPPER]);
         THEKERNEL->robot->alpha_stepper_motor->set_keep_moving(keep_moving);
         this->main_stepper = THEKERNEL->robot->alpha_stepper_motor;
     }
@@ -175,7 +261,7 @@ void Stepper::on_block_begin(void *argument)
     }
 
     if( block->steps[BETA_STEPPER ] > 0 ) {
-        THEKERNEL->robot->beta_stepper_motor->move(  block->direction_bits[BETA_STEPPER], block->steps[BETA_STEPPER ]);
+        THEKERNEL->robot->beta_stepper_motor->move(  block->direction(BETA_STEPPER), block->steps[BETA_STEPPER ]);
         THEKERNEL->robot->beta_stepper_motor->set_keep_moving(keep_moving);
         if(this->main_stepper == nullptr || THEKERNEL->robot->beta_stepper_motor->get_steps_to_move() > this->main_stepper->get_steps_to_move())
             this->main_stepper = THEKERNEL->robot->beta_stepper_motor;
@@ -186,7 +272,7 @@ void Stepper::on_block_begin(void *argument)
     }
 
     if( block->steps[GAMMA_STEPPER] > 0 ) {
-        THEKERNEL->robot->gamma_stepper_motor->move( block->direction_bits[GAMMA_STEPPER], block->steps[GAMMA_STEPPER]);
+        THEKERNEL->robot->gamma_stepper_motor->move( block->direction(GAMMA_STEPPER), block->steps[GAMMA_STEPPER]);
         THEKERNEL->robot->gamma_stepper_motor->set_keep_moving(keep_moving);
         if(this->main_stepper == nullptr || THEKERNEL->robot->gamma_stepper_motor->get_steps_to_move() > this->main_stepper->get_steps_to_move())
             this->main_stepper = THEKERNEL->robot->gamma_stepper_motor;
@@ -198,8 +284,24 @@ void Stepper::on_block_begin(void *argument)
 
     this->current_block = block;
 
+    // the segments of this block may be prepared already, the ones left of the previous block are dropped when they
+    // are reached, see apply_next_segment()
+    this->block_seq++;
+
     // Setup acceleration for this block
+    // in a feed hold the new block carries on slowing down from the rate the last one had, or stays stopped.
+    uint32_t hold_rate = this->previous_main_rate;
     this->trapezoid_generator_reset();
+    uint32_t override_percent = block->rapid ? this->rapid_override : this->feed_override;
+    // Back at 100% the block is on its trapezoid again, unless the last block was overridden and ended more than one
+    // tick of acceleration below the initial rate this one was planned with, e.g. a 50% override slower than the
+    // junction speed: jumping up to it would exceed the acceleration, so this block ramps up with override_rate() from
+    // the rate the last one ended at, and ends at its own final rate, from where the next block follows its trapezoid.
+    // The last block can not have ended faster, override_rate() slows down to the final rate.
+    this->override_active = override_percent != 100 || (this->override_active && hold_rate + this->rate_delta < this->previous_main_rate);
+    if (this->holding || this->paused || this->override_active) {
+        this->previous_main_rate = std::min(hold_rate, this->previous_main_rate);
+    }
 
     // Set the initial speed for this move
     this->trapezoid_generator_tick();
@@ -208,7 +310,8 @@ void Stepper::on_block_begin(void *argument)
     THEKERNEL->step_ticker->synchronize_acceleration(false);
 
     // set a flag to synchronize the acceleration timer with the deceleration step, and fire it immediately we get to that step
-    if( block->decelerate_after > 0 && block->decelerate_after+1 < this->main_stepper->steps_to_move ) {
+    // segments and S-curves are planned in time rather than in steps so they do not need this
+    if( !this->use_segment_buffer && !block->s_curve && block->decelerate_after > 0 && block->decelerate_after+1 < this->main_stepper->steps_to_move ) {
         this->main_stepper->signal_step= block->decelerate_after+1; // we make it +1 as deceleration does not start until steps > decelerate_after
     }
 }
@@ -216,7 +319,12 @@ void Stepper::on_block_begin(void *argument)
 // Current block is discarded
 void Stepper::on_block_end(void *argument)
 {
+    // the actuators step on their own again, e.g. when homing
+    if (THEKERNEL->step_ticker->is_bresenham()) {
+        THEKERNEL->step_ticker->set_lead_motor(nullptr, 0);
+    }
     this->current_block = NULL; //stfu !
+    this->block_seq++;
 }
 
 // When a stepper motor has finished it's assigned movement
@@ -269,25 +377,80 @@ uint32_t Stepper::get_stepper_rate(uint32_t stepped, uint32_t steps_to_move, uin
     return rate;
 }
 
-float Stepper::get_speed_factor()
+// Distance the main stepper needs to slow down from rate to final_rate with the acceleration of the block, in units of
+// 1/(2 * acceleration_ticks_per_second * STEP_RATE_ONE) steps: (rate^2 - final_rate^2) / rate_delta. Changing the rate by
+// one rate_delta, up or down, changes it by 2 * rate + rate_delta or rate_delta - 2 * rate, so it is only divided for
+// when the block or the override change
+int64_t Stepper::brake_distance(uint32_t rate, uint32_t final_rate, uint32_t rate_delta)
 {
-    return ((float)previous_main_rate) / current_block->nominal_rate;
+    return ((int64_t)rate * rate - (int64_t)final_rate * final_rate) / std::max(rate_delta, (uint32_t)1);
 }
 
-// Calculate step rate at position x, when it should be v1 at x1 and v2 at x2.
-// V as function of X follows a sqrt() shaped curve, so by squaring v1 and v2,
-// we can use linear interpolation.
-static int quadratic_interpolate(float x, float x1, float v1, float x2, float v2)
+// Rate of the main stepper for the next acceleration tick when the block is overridden. Its cruise rate is scaled and
+// kept within the limits of the block, and the ramps to it are made as we go with the acceleration of the block.
+// It never goes faster than it can still slow down from to the final rate of the block, so the junction speeds the
+// planner found are kept. Once it has to slow down it does not speed up again in this block.
+uint32_t Stepper::override_rate(uint32_t rate, uint32_t current_pos, uint32_t percent)
 {
-    if (x <= x1)
-        return v1;
-    else if (x >= x2)
-        return v2;
-    
-    float y1 = v1 * v1;
-    float y2 = v2 * v2;
-    float y = (y2 - y1) * (x - x1) / (x2 - x1) + y1;
-    return sqrtf(y);
+    const Block *block = this->current_block;
+    uint32_t delta = this->rate_delta;
+
+    if (this->override_plan.block_seq != this->block_seq || this->override_plan.plan_version != block->plan_version || this->override_plan.percent != percent) {
+        this->override_plan.block_seq = this->block_seq;
+        this->override_plan.plan_version = block->plan_version;
+        this->override_plan.percent = percent;
+        this->override_plan.target = std::min(std::min((uint64_t)block->nominal_rate * percent / 100, (uint64_t)block->rate_limit), (uint64_t)this->max_rate);
+        this->override_plan.final_rate = std::max((uint32_t)block->final_rate, this->min_rate);
+        this->override_plan.target_brake = brake_distance(this->override_plan.target, this->override_plan.final_rate, delta);
+        this->override_plan.braking = false;
+        this->override_plan.rate = rate;
+        this->override_plan.brake = brake_distance(rate, this->override_plan.final_rate, delta);
+    }
+
+    // the rate was changed outside of here since the last tick
+    if (rate != this->override_plan.rate)
+        this->override_plan.brake = brake_distance(rate, this->override_plan.final_rate, delta);
+
+    // brake distance that still fits in the steps left at the end of the next acceleration tick, a 32 by 32 bit multiply
+    uint32_t left = saturating_sub(block->steps_event_count - current_pos, (rate >> STEP_RATE_SHIFT) / THEKERNEL->acceleration_ticks_per_second);
+    int64_t room = (uint64_t)left * (uint32_t)(2 * THEKERNEL->acceleration_ticks_per_second * STEP_RATE_ONE);
+
+    uint32_t next = rate;
+    int64_t brake = this->override_plan.brake;
+    if (!this->override_plan.braking) {
+        // ramp to the target, or stay at this rate when going up would not leave room to slow down
+        if (rate + delta <= this->override_plan.target && brake + 2 * rate + delta <= room) {
+            next = rate + delta;
+            brake += 2 * rate + delta;
+        } else if (rate >= this->override_plan.target + delta) {
+            next = rate - delta;
+            brake += (int64_t)delta - 2 * rate;
+        } else if (rate != this->override_plan.target && this->override_plan.target_brake <= room) {
+            next = this->override_plan.target;
+            brake = this->override_plan.target_brake;
+        }
+        this->override_plan.braking = brake > room;
+    }
+
+    // slowing down, it is kept to the brake distance without going up again
+    if (this->override_plan.braking && next >= rate && brake > room) {
+        if (rate >= this->override_plan.final_rate + delta) {
+            next = rate - delta;
+            brake += (int64_t)delta - 2 * rate;
+        } else {
+            next = this->override_plan.final_rate;
+            brake = 0;
+        }
+    }
+
+    this->override_plan.rate = next;
+    this->override_plan.brake = brake;
+    return next;
+}
+
+float Stepper::get_speed_factor()
+{
+    return ((float)previous_main_rate) / current_block->nominal_rate;
 }
 
 // This is called ACCELERATION_TICKS_PER_SECOND times per second by the step_event
@@ -298,10 +461,24 @@ void Stepper::trapezoid_generator_tick(void)
     // Do not do the accel math for nothing
     if(this->current_block && !this->paused && this->main_stepper->moving )
     {
+        // An override that is not 100% takes the block off its planned profile until it ends
+        uint32_t override_percent = this->current_block->rapid ? this->rapid_override : this->feed_override;
+        if (override_percent != 100)
+            this->override_active = true;
+
+        // Use the rate prepared in the main loop for this tick if we have it. If the main loop fell behind, or the
+        // profile ended before the steps did, the rate is worked out below from the position like without segments.
+        uint32_t tick = this->block_tick++;
+        if (this->use_segment_buffer && !this->holding && !this->hold_replanned && !this->override_active && !THEKERNEL->conveyor->is_flushing() &&
+            apply_next_segment(tick)) {
+            THEKERNEL->call_event(ON_SPEED_CHANGE, this);
+            return;
+        }
+
         // Calculate what the main stepper speed should be (in steps per second).
         // All other motors follow the rate of the main stepper.
         uint32_t main_rate = this->previous_main_rate;
-        uint32_t min_rate = current_block->rate_delta / 2;
+        uint32_t min_rate = this->min_rate;
         uint32_t current_pos = this->main_stepper->stepped;
         
         if (THEKERNEL->conveyor->is_flushing())
@@ -309,7 +486,7 @@ void Stepper::trapezoid_generator_tick(void)
             // Abort in progress, slow down and stop.
             if (main_rate > min_rate)
             {
-                main_rate = saturating_sub(main_rate, current_block->rate_delta);
+                main_rate = saturating_sub(main_rate, this->rate_delta);
             }
             else
             {
@@ -320,26 +497,48 @@ void Stepper::trapezoid_generator_tick(void)
                 return;
             }
         }
+        else if (this->holding)
+        {
+            // Feed hold, slow down with the acceleration of the block and stop, keeping the steps that are left
+            if (main_rate > min_rate)
+            {
+                main_rate = saturating_sub(main_rate, this->rate_delta);
+            }
+            else
+            {
+                stop_for_hold();
+                return;
+            }
+        }
         else if (current_pos >= this->current_block->steps_event_count)
         {
             // Block is changing now, decelerate until the new move activates.
-            main_rate = saturating_sub(main_rate, current_block->rate_delta);
+            main_rate = saturating_sub(main_rate, this->rate_delta);
+        }
+        else if (this->override_active)
+        {
+            main_rate = override_rate(main_rate, current_pos, override_percent);
+        }
+        else if (this->current_block->s_curve)
+        {
+            // Jerk limited ramps are followed in time, see s_curve_next()
+            main_rate = s_curve_rate(this->s_curve, tick);
         }
         else if (current_pos < this->current_block->accelerate_until)
         {
             // Beginning of move, accelerate
             uint32_t initial_rate = std::max((uint32_t)current_block->initial_rate, min_rate);
-            main_rate = quadratic_interpolate(current_pos, 0, initial_rate,
-                                             this->current_block->accelerate_until, current_block->max_rate);
+            main_rate = quadratic_interpolate(current_pos, this->ramp_start, initial_rate,
+                                             this->current_block->accelerate_until, current_block->max_rate, this->accelerate_reciprocal);
         }
         else if (current_pos >= this->current_block->decelerate_after)
         {
             // End of move, decelerate.
             // Calculate desired speed at the end of the next acceleration interval.
-            uint32_t end_pos = current_pos + main_rate / THEKERNEL->acceleration_ticks_per_second;
+            uint32_t end_pos = current_pos + (main_rate >> STEP_RATE_SHIFT) / THEKERNEL->acceleration_ticks_per_second;
             uint32_t final_rate = std::max((uint32_t)current_block->final_rate, min_rate);
             main_rate = quadratic_interpolate(end_pos, this->current_block->decelerate_after, current_block->max_rate,
-                                              this->current_block->steps_event_count, final_rate);
+                                              this->current_block->steps_event_count, final_rate, this->decelerate_reciprocal);
         }
         else
         {
@@ -352,6 +551,9 @@ void Stepper::trapezoid_generator_tick(void)
         // from min_rate to 0 when the move ends.
         if (main_rate < min_rate)
             main_rate = min_rate;
+        // and never above what the step ticker can make
+        if (main_rate > this->max_rate)
+            main_rate = this->max_rate;
         
         this->previous_main_rate = main_rate;
         this->previous_main_pos = current_pos;
@@ -361,18 +563,20 @@ void Stepper::trapezoid_generator_tick(void)
         // Now calculate the rates for all other steppers based on the main stepper
         // Note: this has to be recalculated even if speed didn't change, so that accumulating 
         // rounding errors can be eliminated.
+        // The Bresenham engine steps them along with the main stepper instead.
         StepperMotor *alpha = THEKERNEL->robot->alpha_stepper_motor;
         StepperMotor *beta  = THEKERNEL->robot->beta_stepper_motor;
         StepperMotor *gamma = THEKERNEL->robot->gamma_stepper_motor;
-        if (alpha->moving && this->main_stepper != alpha)
+        bool follow_rate = !THEKERNEL->step_ticker->is_bresenham();
+        if (follow_rate && alpha->moving && this->main_stepper != alpha)
         {
             alpha->set_rate(get_stepper_rate(alpha->stepped, alpha->steps_to_move, alpha->get_rate()));
         }
-        if (beta->moving && this->main_stepper != beta)
+        if (follow_rate && beta->moving && this->main_stepper != beta)
         {
             beta->set_rate(get_stepper_rate(beta->stepped, beta->steps_to_move, beta->get_rate()));
         }
-        if (gamma->moving && this->main_stepper != gamma)
+        if (follow_rate && gamma->moving && this->main_stepper != gamma)
         {
             gamma->set_rate(get_stepper_rate(gamma->stepped, gamma->steps_to_move, gamma->get_rate()));
         }
@@ -380,6 +584,11 @@ void Stepper::trapezoid_generator_tick(void)
         // Other modules might want to know the speed changed
         THEKERNEL->call_event(ON_SPEED_CHANGE, this);
     }
+    else if (this->holding && this->current_block == NULL)
+    {
+        // the queue ran out while slowing down, the axes have stopped already
+        stop_for_hold();
+    }
 }
 
 // Initializes the trapezoid generator from the current block. Called whenever a new
@@ -388,6 +597,275 @@ inline void Stepper::trapezoid_generator_reset()
 {
     this->previous_main_rate = this->current_block->initial_rate;
     this->previous_main_pos = 0;
+    this->set_ramps(0);
+    this->hold_replanned = false;
+    this->block_tick = 0;
+
+    this->rate_delta = this->current_block->rate_delta;
+    this->min_rate = this->rate_delta / 2;
+
+    if (this->current_block->s_curve) {
+        s_curve_start(this->s_curve, this->current_block, this->min_rate);
+    }
 }
 
 
+// The acceleration of the current block starts at position start of the main stepper. The divisions of the ramps are
+// made here, once, so the acceleration tick only multiplies, see quadratic_interpolate()
+void Stepper::set_ramps(uint32_t start)
+{
+    const Block *block = this->current_block;
+    this->ramp_start = start;
+    this->accelerate_reciprocal = reciprocal(saturating_sub(block->accelerate_until, start));
+    this->decelerate_reciprocal = reciprocal(block->steps_event_count - block->decelerate_after);
+}
+
+// Apply the segment prepared for this tick of the current block, if there is one. Segments for earlier ticks and
+// blocks, or for a plan that has changed since, are dropped. Segments of the block queued next are kept for it.
+// Called from the acceleration interrupt.
+bool Stepper::apply_next_segment(uint32_t tick)
+{
+    const Block *block = this->current_block;
+    while (this->segments.tail != this->segments.head) {
+        segment_t *seg = this->segments.get_tail_ref();
+        bool current = seg->block == block && seg->plan_version == block->plan_version;
+        if (current && seg->tick > tick) return false;
+        if (!current && seg->block == THEKERNEL->conveyor->get_next_block() && seg->plan_version == seg->block->plan_version) return false;
+
+        this->segments.delete_tail();
+        if (!current || seg->tick < tick) continue;
+
+        for (int i = 0; i < 3; i++) {
+            StepperMotor *m = THEKERNEL->robot->actuators[i];
+            if (m->moving && (m == this->main_stepper || !THEKERNEL->step_ticker->is_bresenham())) m->set_rate(seg->rate[i]);
+        }
+
+        this->previous_main_rate = this->main_stepper->get_rate();
+        this->previous_main_pos = this->main_stepper->stepped;
+        return true;
+    }
+
+    return false;
+}
+
+// Called from the main loop, fills the segment buffer for the currently executing block
+void Stepper::on_idle(void *argument)
+{
+    if (this->resume_pending && this->paused) {
+        this->resume_pending = false;
+        resume_from_hold();
+    }
+
+    if (this->use_segment_buffer) {
+        prepare_segments();
+    }
+}
+
+// Segments are prepared for the executing block, from the tick after the one the acceleration interrupt is at, then
+// for the block queued after it. The planner can still change that one, it is prepared again if it does.
+void Stepper::prepare_segments()
+{
+    // the executing block and the next one, read while no block begins or ends. current_block is read through a
+    // volatile access so the compiler loads it between the two reads of block_seq
+    uint32_t seq = this->block_seq;
+    const Block *block = *(Block *const volatile *)&this->current_block;
+    const Block *next = THEKERNEL->conveyor->get_next_block();
+    uint32_t tick = this->block_tick;
+    if (seq != this->block_seq) return; // changed under us, try again next time
+
+    if (block == nullptr) {
+        this->prep.block = nullptr;
+        return;
+    }
+
+    if (this->prep.block == block) {
+        // the interrupt has gone past the segments not prepared yet, they would be dropped
+        if (this->prep.tick <= tick) this->prep.tick = tick + 1;
+        if (this->prep.done && next != nullptr) start_segment_prep(next, 0);
+    } else if (next != nullptr && this->prep.block == next) {
+        // the planner has changed the next block since
+        if (this->prep.plan_version != next->plan_version) start_segment_prep(next, 0);
+    } else {
+        start_segment_prep(block, tick + 1);
+        if (this->prep.done && next != nullptr) start_segment_prep(next, 0);
+    }
+
+    float ticks_per_second = THEKERNEL->acceleration_ticks_per_second;
+    float t_total = this->prep.profile.t_accel + this->prep.profile.t_cruise + this->prep.profile.t_decel;
+
+    while (!this->prep.done && this->segments.next_block_index(this->segments.head) != this->segments.tail) {
+        float main_rate;
+        if (this->prep.block->s_curve) {
+            // the same integer S-curve the interrupt follows without segments
+            main_rate = (float)s_curve_rate(this->prep.s_curve, this->prep.tick) / STEP_RATE_ONE;
+            if (this->prep.s_curve.phase == 7) this->prep.done = true;
+        } else {
+            float t0 = this->prep.tick / ticks_per_second;
+            float t1 = (this->prep.tick + 1) / ticks_per_second;
+
+            // average rate of the main stepper over this tick
+            main_rate = (profile_position(this->prep.profile, t1) - profile_position(this->prep.profile, t0)) * ticks_per_second;
+
+            if (t1 >= t_total) {
+                // last segment, the exit rate is reached. The steps left after it are made at the rate the interrupt
+                // works out from the position of the main stepper
+                if (main_rate < this->prep.profile.vf) main_rate = this->prep.profile.vf;
+                this->prep.done = true;
+            }
+        }
+
+        // same minimum as the interrupt based generator, see trapezoid_generator_tick()
+        float min_rate = (float)this->prep.block->rate_delta / STEP_RATE_ONE / 2;
+        if (main_rate < min_rate) main_rate = min_rate;
+
+        segment_t seg;
+        seg.block = this->prep.block;
+        seg.plan_version = this->prep.plan_version;
+        seg.tick = this->prep.tick;
+        for (int i = 0; i < 3; i++) {
+            seg.rate[i] = lroundf(main_rate * this->prep.ratio[i] * STEP_RATE_ONE);
+        }
+        this->segments.push_back(seg);
+
+        this->prep.tick++;
+    }
+}
+
+// Start preparing the segments of a block from the given tick
+void Stepper::start_segment_prep(const Block *block, uint32_t tick)
+{
+    float n = block->steps_event_count;
+
+    this->prep.block = block;
+    this->prep.plan_version = block->plan_version;
+    this->prep.tick = tick;
+    this->prep.done = false;
+
+    for (int i = 0; i < 3; i++) {
+        this->prep.ratio[i] = (n > 0) ? block->steps[i] / n : 0;
+    }
+
+    // a block that began before its segments were prepared may be past the end of its profile already
+    if (block->s_curve) {
+        s_curve_start(this->prep.s_curve, block, block->rate_delta / 2);
+        while (this->prep.s_curve.tick < tick && this->prep.s_curve.phase < 7) s_curve_next(this->prep.s_curve);
+        if (tick > 0 && this->prep.s_curve.phase == 7) this->prep.done = true;
+    } else {
+        init_profile(this->prep.profile, block);
+        float t_total = this->prep.profile.t_accel + this->prep.profile.t_cruise + this->prep.profile.t_decel;
+        if (tick > 0 && tick / (float)THEKERNEL->acceleration_ticks_per_second >= t_total) this->prep.done = true;
+    }
+}
+
+// Convert the trapezoid of the block into a time based profile for the main stepper
+void Stepper::init_profile(profile_t &p, const Block *block)
+{
+    float n = block->steps_event_count;
+    float rate_delta = (float)block->rate_delta / STEP_RATE_ONE;
+    float min_rate = rate_delta / 2;
+
+    p.accel = rate_delta * THEKERNEL->acceleration_ticks_per_second;
+    p.vi = std::max((float)block->initial_rate / STEP_RATE_ONE, min_rate);
+    p.vf = std::max((float)block->final_rate / STEP_RATE_ONE, min_rate);
+    p.vmax = std::max((float)block->max_rate / STEP_RATE_ONE, std::max(p.vi, p.vf));
+
+    float a = p.accel;
+    float s_decel;
+    if (a > 0.0F) {
+        p.s_accel = std::min(n, (p.vmax * p.vmax - p.vi * p.vi) / (2 * a));
+        s_decel = std::min(n - p.s_accel, (p.vmax * p.vmax - p.vf * p.vf) / (2 * a));
+        p.t_accel = (p.vmax - p.vi) / a;
+        p.t_decel = (p.vmax - p.vf) / a;
+    } else {
+        p.s_accel = s_decel = 0;
+        p.t_accel = p.t_decel = 0;
+    }
+
+    p.s_cruise = std::max(0.0F, n - p.s_accel - s_decel);
+    p.t_cruise = p.s_cruise / p.vmax;
+}
+
+// Position of the main stepper in steps, t seconds after the start of the block
+float Stepper::profile_position(const profile_t &p, float t)
+{
+    if (t <= 0.0F) return 0.0F;
+
+    if (t < p.t_accel)
+        return (p.vi + 0.5F * p.accel * t) * t;
+
+    t -= p.t_accel;
+    if (t < p.t_cruise)
+        return p.s_accel + p.vmax * t;
+
+    t -= p.t_cruise;
+    if (t > p.t_decel) t = p.t_decel;
+    return p.s_accel + p.s_cruise + (p.vmax - 0.5F * p.accel * t) * t;
+}
+
+// Start following the S-curve of the block from its first tick, Block::calculate_s_curve() planned its phases
+void Stepper::s_curve_start(s_curve_t &s, const Block *block, uint32_t min_rate)
+{
+    s.plan = &block->s_curve_plan();
+    s.rate = (int64_t)std::max(block->initial_rate, min_rate) << S_CURVE_SHIFT;
+    s.accel = 0;
+    s.jerk = 0;
+    s.tick = 0;
+    s.cruise_rate = block->max_rate;
+    s.final_rate = std::max(block->final_rate, min_rate);
+    s.phase = 0;
+    s_curve_enter(s, 0);
+}
+
+// Move on to the given phase, or past it and the ones after it that take no tick. The mean rate of a tick is the rate
+// at its start, plus half the acceleration and a sixth of the jerk, so the mean changes with the sixth of the jerk.
+// The cruise and the end of the S-curve start from their planned rate, the ramps only get close to it.
+void Stepper::s_curve_enter(s_curve_t &s, uint8_t phase)
+{
+    static const int8_t jerk_sign[7] = {1, 0, -1, 0, -1, 0, 1};
+    static const uint8_t ticks_index[7] = {0, 1, 0, 2, 3, 4, 3};
+
+    uint8_t previous = s.phase;
+    while (phase < 7 && s.plan->ticks[ticks_index[phase]] == 0) phase++;
+    s.phase = phase;
+
+    if (phase == 7) {
+        s.rate = (int64_t)s.final_rate << S_CURVE_SHIFT;
+        s.accel = 0;
+        s.jerk = 0;
+        return;
+    }
+    if (previous < 3 && phase >= 3) {
+        s.rate = (int64_t)s.cruise_rate << S_CURVE_SHIFT;
+        s.accel = 0;
+        s.jerk = 0;
+    }
+
+    int64_t jerk = jerk_sign[phase] * s.plan->jerk[phase < 3 ? 0 : 1];
+    s.rate += jerk - s.jerk;
+    s.jerk = jerk;
+    s.left = s.plan->ticks[ticks_index[phase]];
+}
+
+// Mean rate of the main stepper during the next tick of the S-curve, in 1/256 steps per second. Once the S-curve is
+// over the exit rate is held until the move finishes. Only adds and shifts, it runs in the acceleration interrupt.
+uint32_t Stepper::s_curve_next(s_curve_t &s)
+{
+    int64_t rate = s.rate >> S_CURVE_SHIFT;
+    s.tick++;
+    if (s.phase < 7) {
+        int64_t jerk = (s.jerk << 2) + (s.jerk << 1);
+        s.rate += s.accel + jerk;
+        s.accel += jerk;
+        if (--s.left == 0) s_curve_enter(s, s.phase + 1);
+    }
+    return (rate > 0) ? rate : 0;
+}
+
+// Mean rate of the main stepper during the given tick of the block, the ticks before it that were not followed, when
+// segments were used for them, are caught up with
+uint32_t Stepper::s_curve_rate(s_curve_t &s, uint32_t tick)
+{
+    uint32_t rate = s_curve_next(s);
+    while (s.tick <= tick) rate = s_curve_next(s);
+    return rate;
+}
@@ -9,9 +9,13 @@
 #define STEPPER_H
 
 #include "libs/Module.h"
+#include "libs/RingBuffer.h"
+#include "libs/fixedpoint.h"
 #include <stdint.h>
+#include <math.h>
 
 class Block;
+struct s_curve_plan_t;
 class StepperMotor;
 
 class Stepper : public Module
@@ -27,6 +31,7 @@ public:
     void on_play(void *argument);
     void on_pause(void *argument);
     void on_halt(void *argument);
+    void on_idle(void *argument);
     uint32_t main_interrupt(uint32_t dummy);
     void trapezoid_generator_reset();
     void set_step_events_per_second(float);
@@ -37,25 +42,127 @@ public:
     void turn_enable_pins_off();
 
     const Block *get_current_block() const { return current_block; }
+    bool is_paused() const { return paused; } // a feed hold has stopped the axes
 
-    // Get the acceleration-based step speed (steps per second) for a given stepper.
+    // Get the acceleration-based step speed (1/256 steps per second) for a given stepper.
     // Computed based on the main stepper rate so that all steppers finish move at
     // the same time.
     uint32_t get_stepper_rate(uint32_t stepped, uint32_t steps_to_move, uint32_t old_rate);
     
     // Get the ratio between current speed and the nominal speed for this move.
     float get_speed_factor();
+
+    // Realtime feed and rapid overrides, in percent. They scale the moves already in the queue from the next
+    // acceleration tick, see override_rate().
+    void set_feed_override(float percent) { feed_override = lroundf(percent); }
+    void set_rapid_override(float percent) { rapid_override = lroundf(percent); }
+    float get_feed_override() const { return feed_override; }
+    float get_rapid_override() const { return rapid_override; }
     
 private:
+    // Planned motion of the main stepper over time, for the segments of a trapezoid block
+    struct profile_t {
+        float vi, vmax, vf;     // entry, cruise and exit rates of the main stepper
+        float accel;            // in steps/sec^2
+        float t_accel, t_cruise, t_decel;
+        float s_accel, s_cruise;
+    };
+
+    // Where the main stepper is on the S-curve of a block, which is followed one acceleration tick at a time with
+    // integer additions, see s_curve_next(). The rates are in the units of s_curve_plan_t::jerk.
+    struct s_curve_t {
+        const s_curve_plan_t *plan; // of the block
+        int64_t rate;           // mean rate during the next tick
+        int64_t accel;          // rate change per tick at the start of the next tick
+        int64_t jerk;           // a sixth of the jerk of the phase
+        uint32_t left;          // ticks left in the phase
+        uint32_t tick;          // of the block, the next one
+        uint32_t cruise_rate;   // the max_rate of the block, the deceleration starts from it
+        uint32_t final_rate;    // held once the S-curve is over, in 1/256 steps per second
+        uint8_t phase;          // 0 to 6, 7 once it is over
+    };
+
+    void prepare_segments();
+    void start_segment_prep(const Block *block, uint32_t tick);
+    static void init_profile(profile_t &p, const Block *block);
+    static float profile_position(const profile_t &p, float t);
+    static void s_curve_start(s_curve_t &s, const Block *block, uint32_t min_rate);
+    static void s_curve_enter(s_curve_t &s, uint8_t phase);
+    static uint32_t s_curve_next(s_curve_t &s);
+    static uint32_t s_curve_rate(s_curve_t &s, uint32_t tick);
+    bool apply_next_segment(uint32_t tick);
+    uint32_t override_rate(uint32_t rate, uint32_t current_pos, uint32_t percent);
+    static int64_t brake_distance(uint32_t rate, uint32_t final_rate, uint32_t rate_delta);
+    void set_ramps(uint32_t start);
+    void stop_for_hold();
+    void resume_from_hold();
+
     Block *current_block;
     StepperMotor *main_stepper;
     uint32_t previous_main_rate;
     uint32_t previous_main_pos;
+    uint32_t rate_delta;        // of the current block, in 1/256 steps per second per tick
+    uint32_t min_rate;
+    uint32_t max_rate;          // the step ticker limit, in 1/256 steps per second
+    uint32_t ramp_start;        // position of the main stepper the acceleration starts from, not 0 after a feed hold
+    reciprocal_t accelerate_reciprocal;     // of the lengths of the acceleration and deceleration, see set_ramps()
+    reciprocal_t decelerate_reciprocal;
+
+    // feed hold, set from interrupts so kept out of the bit fields
+    volatile bool holding;          // slowing down the current block to a stop
+    volatile bool resume_pending;   // play was pressed, resume once the hold has stopped
+    volatile bool paused;           // a hold has stopped the axes
+    bool hold_replanned;            // the current block was planned again from rest after a hold
+
+    volatile uint16_t feed_override;   // percent, for every move but G0
+    volatile uint16_t rapid_override;  // percent, for G0
+    bool override_active;           // the current block follows override_rate() instead of its trapezoid
+
+    // override_rate() works these out again only when the block, its plan or the override change, and then follows
+    // the brake distance of the rate it returns with additions, see brake_distance()
+    struct {
+        uint32_t block_seq;         // what the values below are for
+        uint16_t plan_version;
+        uint16_t percent;
+        uint32_t target;            // overridden cruise rate, within the limits of the block
+        uint32_t final_rate;        // of the block, not below min_rate
+        int64_t target_brake;       // brake distance from the target
+        uint32_t rate;              // the rate returned last, and its brake distance
+        int64_t brake;
+        bool braking;               // slowing down to the final rate, until the block or the override change
+    } override_plan;
+
+    // S-curves and segments are followed in time, counted in acceleration ticks since the block began. The
+    // acceleration timer is synchronized with the start of each block, see on_block_begin()
+    s_curve_t s_curve;
+    volatile uint32_t block_tick;
+
+    // A segment is one acceleration tick worth of motion of a block. Segments are prepared in the main loop, for the
+    // executing block and then for the one queued after it, so the acceleration interrupt only has to apply the rates.
+    struct segment_t {
+        const Block *block;     // the block and the plan of it this segment was prepared for, see Block::plan_version
+        uint16_t plan_version;
+        uint32_t tick;          // the acceleration tick of the block it is for
+        uint32_t rate[3];       // step rate of each actuator during this tick, in 1/256 steps per second
+    };
+    RingBuffer<segment_t, 32> segments;
+    volatile uint32_t block_seq; // incremented every time a block begins or ends
+
+    // segment preparation state, only used from the main loop
+    struct {
+        const Block *block;
+        uint16_t plan_version;
+        uint32_t tick;          // of the next segment
+        profile_t profile;
+        s_curve_t s_curve;
+        float ratio[3];         // steps of each actuator per step of the main stepper
+        bool done;
+    } prep;
 
     struct {
         bool enable_pins_status:1;
-        bool paused:1;
         bool halted:1;
+        bool use_segment_buffer:1;
     };
 
 };
@@ -0,0 +1,22 @@
+#include "BaseSolution.h"
+#include "libs/nuts_bolts.h"
+
+#include <math.h>
+
+// How far the effector strays from the straight line between two cartesian points when the actuators are moved
+// linearly between their positions, as the planner does for a block. Measured at the middle of the line, where the
+// deviation of a short chord is largest.
+float BaseSolution::segment_error( float from[], float to[] )
+{
+    float from_actuator[3], to_actuator[3], mid_actuator[3], actual[3];
+    cartesian_to_actuator(from, from_actuator);
+    cartesian_to_actuator(to, to_actuator);
+    for (int i = ALPHA_STEPPER; i <= GAMMA_STEPPER; i++)
+        mid_actuator[i] = (from_actuator[i] + to_actuator[i]) / 2.0F;
+    actuator_to_cartesian(mid_actuator, actual);
+
+    float error = 0.0F;
+    for (int i = X_AXIS; i <= Z_AXIS; i++)
+        error += powf(actual[i] - (from[i] + to[i]) / 2.0F, 2);
+    return sqrtf(error);
+}
@@ -12,6 +12,7 @@ class BaseSolution {
         virtual ~BaseSolution() {};
         virtual void cartesian_to_actuator( float[], float[] ) = 0;
         virtual void actuator_to_cartesian( float[], float[] ) = 0;
+        virtual float segment_error( float[], float[] );
         typedef std::map<char, float> arm_options_t;
         virtual bool set_optional(const arm_options_t& options) { return false; };
         virtual bool get_optional(arm_options_t& options) { return false; };
@@ -60,6 +60,23 @@ void ExperimentalDeltaSolution::actuator_to_cartesian( float actuator_mm[], floa
     // unimplemented
 }
 
+// There is no forward kinematics yet, so the error is measured on the carriages instead of the effector. Away from the
+// edge of the bed a carriage moves about as far as the effector does, which is close enough to choose a segment count.
+float ExperimentalDeltaSolution::segment_error( float from[], float to[] ){
+    float from_actuator[3], to_actuator[3], mid_actuator[3], mid[3];
+    for (int i = X_AXIS; i <= Z_AXIS; i++) mid[i] = (from[i] + to[i]) / 2.0F;
+    cartesian_to_actuator(from, from_actuator);
+    cartesian_to_actuator(to, to_actuator);
+    cartesian_to_actuator(mid, mid_actuator);
+
+    float error = 0.0F;
+    for (int i = ALPHA_STEPPER; i <= GAMMA_STEPPER; i++) {
+        float e = fabsf(mid_actuator[i] - (from_actuator[i] + to_actuator[i]) / 2.0F);
+        if(e > error) error = e;
+    }
+    return error;
+}
+
 float ExperimentalDeltaSolution::solve_arm( float cartesian_mm[]) {
     return sqrtf(arm_length_squared - powf(cartesian_mm[X_AXIS] - arm_radius, 2) - powf(cartesian_mm[Y_AXIS], 2)) + cartesian_mm[Z_AXIS];
 }
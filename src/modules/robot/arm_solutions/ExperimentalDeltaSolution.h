@@ -10,6 +10,7 @@ class ExperimentalDeltaSolution : public BaseSolution {
         ExperimentalDeltaSolution(Config*);
         void cartesian_to_actuator( float[], float[] );
         void actuator_to_cartesian( float[], float[] );
+        float segment_error( float[], float[] );
 
         float solve_arm( float millimeters[] );
         void rotate( float in[], float out[], float sin, float cos );
@@ -13,6 +13,8 @@ class HBotSolution : public BaseSolution {
         HBotSolution(Config*){};
         void cartesian_to_actuator( float[], float[] );
         void actuator_to_cartesian( float[], float[] );
+        // the belts move by the sum and the difference of X and Y, a linear mix that keeps a line straight
+        float segment_error( float[], float[] ) { return 0.0F; }
 };
 
 
@@ -14,6 +14,8 @@ class RotatableCartesianSolution : public BaseSolution {
         RotatableCartesianSolution(Config*);
         void cartesian_to_actuator( float[], float[] );
         void actuator_to_cartesian( float[], float[] );
+        // a rotation about Z maps a straight line to a straight line
+        float segment_error( float[], float[] ) { return 0.0F; }
 
         void rotate( float in[], float out[], float sin, float cos );
 
@@ -132,7 +132,8 @@ void Endstops::on_module_loaded()
         return;
     }
 
-    register_for_event(ON_GCODE_RECEIVED);
+    register_for_gcode('G', 28);
+    for (unsigned int m : {119, 206, 306, 500, 503, 665, 666, 910}) register_for_gcode('M', m);
     register_for_event(ON_GET_PUBLIC_DATA);
     register_for_event(ON_SET_PUBLIC_DATA);
 
@@ -743,16 +744,16 @@ void Endstops::acceleration_tick(void)
     for ( int c = X_AXIS; c <= Z_AXIS; c++ ) {
         if( !STEPPER[c]->is_moving() ) continue;
 
-        uint32_t current_rate = STEPPER[c]->get_steps_per_second();
-        uint32_t target_rate = floorf(this->feed_rate[c]*STEPS_PER_MM(c));
+        uint32_t current_rate = STEPPER[c]->get_rate();
+        uint32_t target_rate = floorf(this->feed_rate[c]*STEPS_PER_MM(c)*STEP_RATE_ONE);
         float acc= (c==Z_AXIS) ? THEKERNEL->planner->get_z_acceleration() : THEKERNEL->planner->get_acceleration();
         if( current_rate < target_rate ){
-            uint32_t rate_increase = floorf((acc/THEKERNEL->acceleration_ticks_per_second)*STEPS_PER_MM(c));
+            uint32_t rate_increase = floorf((acc/THEKERNEL->acceleration_ticks_per_second)*STEPS_PER_MM(c)*STEP_RATE_ONE);
             current_rate = min( target_rate, current_rate + rate_increase );
         }
         if( current_rate > target_rate ){ current_rate = target_rate; }
 
-        // steps per second
+        // 1/256 steps per second
         STEPPER[c]->set_rate(current_rate);
     }
 
@@ -12,6 +12,7 @@
 
 #include "modules/robot/Conveyor.h"
 #include "modules/robot/Block.h"
+#include "modules/robot/Planner.h"
 #include "StepperMotor.h"
 #include "SlowTicker.h"
 #include "Stepper.h"
@@ -121,7 +122,8 @@ void Extruder::on_module_loaded()
     // We work on the same Block as Stepper, so we need to know when it gets a new one and drops one
     this->register_for_event(ON_BLOCK_BEGIN);
     this->register_for_event(ON_BLOCK_END);
-    this->register_for_event(ON_GCODE_RECEIVED);
+    for (unsigned int m : {17, 18, 82, 83, 84, 92, 114, 200, 204, 207, 208, 221, 500, 503}) this->register_for_gcode('M', m);
+    for (unsigned int g : {0, 1, 2, 3, 10, 11, 90, 91, 92}) this->register_for_gcode('G', g);
     this->register_for_event(ON_GCODE_EXECUTE);
     this->register_for_event(ON_PLAY);
     this->register_for_event(ON_PAUSE);
@@ -226,17 +228,21 @@ void Extruder::on_set_public_data(void *argument)
 }
 
 // When the play/pause button is set to pause, or a module calls the ON_PAUSE event
+// Following the axes it slows down and stops with them in the feed hold instead, see on_speed_change
 void Extruder::on_pause(void *argument)
 {
     this->paused = true;
-    this->stepper_motor->pause();
+    if(this->mode != FOLLOW || this->current_block == NULL || THEKERNEL->stepper->is_paused())
+        this->stepper_motor->pause();
 }
 
 // When the play/pause button is set to play, or a module calls the ON_PLAY event
+// Following the axes it starts again with them, see on_speed_change
 void Extruder::on_play(void *argument)
 {
     this->paused = false;
-    this->stepper_motor->unpause();
+    if(this->mode != FOLLOW || this->current_block == NULL)
+        this->stepper_motor->unpause();
 }
 
 void Extruder::on_gcode_received(void *argument)
@@ -500,7 +506,7 @@ void Extruder::on_block_begin(void *argument)
     Block *block = static_cast<Block *>(argument);
     if( this->mode == FOLLOW ) {
         // In FOLLOW mode, we just follow the stepper module
-        this->travel_distance = block->millimeters * this->travel_ratio;
+        this->travel_distance = fixed_to_mm(block->millimeters) * this->travel_ratio;
     }
 
     // common for both FOLLOW and SOLO
@@ -544,7 +550,7 @@ void Extruder::on_block_end(void *argument)
 }
 
 uint32_t Extruder::rate_increase() const {
-    return floorf((this->acceleration / THEKERNEL->acceleration_ticks_per_second) * this->steps_per_millimeter);
+    return floorf((this->acceleration / THEKERNEL->acceleration_ticks_per_second) * this->steps_per_millimeter * STEP_RATE_ONE);
 }
 
 // Called periodically to change the speed to match acceleration or to match the speed of the robot
@@ -556,12 +562,16 @@ void Extruder::acceleration_tick(void)
         return;
     }
 
-    uint32_t current_rate = this->stepper_motor->get_steps_per_second();
-    uint32_t target_rate = floorf(this->feed_rate * this->steps_per_millimeter);
+    uint32_t current_rate = this->stepper_motor->get_rate();
+    // the feed override applies here too, it may change in the middle of the move
+    uint32_t target_rate = floorf(this->feed_rate * this->steps_per_millimeter * STEP_RATE_ONE * THEKERNEL->stepper->get_feed_override() / 100.0F);
 
     if( current_rate < target_rate ) {
         current_rate = min( target_rate, current_rate + rate_increase() );
-        // steps per second
+        // 1/256 steps per second
+        this->stepper_motor->set_rate(current_rate);
+    } else if( current_rate > target_rate ) {
+        current_rate = max( target_rate, current_rate - min( current_rate, rate_increase() ) );
         this->stepper_motor->set_rate(current_rate);
     }
 
@@ -572,7 +582,7 @@ void Extruder::acceleration_tick(void)
 void Extruder::on_speed_change( void *argument )
 {
     // Avoid trying to work when we really shouldn't ( between blocks or re-entry )
-    if(!this->enabled || this->current_block == NULL ||  this->paused || this->mode != FOLLOW || !this->stepper_motor->is_moving()) {
+    if(!this->enabled || this->current_block == NULL || this->mode != FOLLOW || !this->stepper_motor->is_moving()) {
         return;
     }
 
@@ -585,8 +595,16 @@ void Extruder::on_speed_change( void *argument )
         return;
     }
 
+    // A feed hold has stopped the axes, stop with them until they start again
+    if(THEKERNEL->stepper->is_paused()) {
+        this->stepper_motor->pause();
+        return;
+    }
+
     // Keep the stepper speed in sync with the main stepper, all should finish the move at the same time.
     this->stepper_motor->set_rate(THEKERNEL->stepper->get_stepper_rate(this->stepper_motor->get_stepped(), this->stepper_motor->get_steps_to_move(), this->stepper_motor->get_rate()));
+    if(this->stepper_motor->is_paused() && !this->paused)
+        this->stepper_motor->unpause();
 }
 
 // When the stepper has finished it's move
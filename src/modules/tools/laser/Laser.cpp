@@ -120,8 +120,8 @@ void Laser::on_speed_change(void* argument){
 
 void Laser::set_proportional_power(){
     if( this->laser_on && THEKERNEL->stepper->get_current_block() ){
-        // adjust power to maximum power and actual velocity
-        float proportional_power = this->laser_max_power * THEKERNEL->stepper->get_speed_factor();
+        // adjust power to maximum power and actual velocity, a feed override above 100% does not raise it past the maximum
+        float proportional_power = this->laser_max_power * min(THEKERNEL->stepper->get_speed_factor(), 1.0F);
         this->laser_pin->write(this->laser_inverting ? 1 - proportional_power : proportional_power);
     }
 }
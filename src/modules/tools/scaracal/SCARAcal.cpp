@@ -45,7 +45,7 @@ void SCARAcal::on_module_loaded()
     // load settings
     this->on_config_reload(this);
     // register event-handlers
-    register_for_event(ON_GCODE_RECEIVED);
+    for (unsigned int m : {114, 360, 361, 364}) register_for_gcode('M', m);
 }
 
 void SCARAcal::on_config_reload(void *argument)
@@ -112,7 +112,7 @@ void Spindle::on_module_loaded()
     }
     
     THEKERNEL->slow_ticker->attach(UPDATE_FREQ, this, &Spindle::on_update_speed);
-    register_for_event(ON_GCODE_RECEIVED);
+    for (unsigned int m : {3, 5, 957, 958}) register_for_gcode('M', m);
     register_for_event(ON_GCODE_EXECUTE);
 }
 
@@ -49,7 +49,6 @@ void Switch::on_module_loaded()
 {
     this->switch_changed = false;
 
-    this->register_for_event(ON_GCODE_RECEIVED);
     this->register_for_event(ON_GCODE_EXECUTE);
     this->register_for_event(ON_MAIN_LOOP);
     this->register_for_event(ON_GET_PUBLIC_DATA);
@@ -117,6 +116,8 @@ void Switch::on_config_reload(void *argument)
             input_off_command_code = gc.m;
         }
     }
+    if(input_on_command_letter != 0) this->register_for_gcode(input_on_command_letter, input_on_command_code);
+    if(input_off_command_letter != 0) this->register_for_gcode(input_off_command_letter, input_off_command_code);
 
     if(input_pin.connected()) {
         // set to initial state
@@ -90,7 +90,13 @@ void TemperatureControl::on_module_loaded()
     this->load_config();
 
     // Register for events
-    this->register_for_event(ON_GCODE_RECEIVED);
+    this->register_for_gcode('M', this->get_m_code);
+    this->register_for_gcode('M', this->set_m_code);
+    this->register_for_gcode('M', this->set_and_wait_m_code);
+    this->register_for_gcode('M', 301);
+    this->register_for_gcode('M', 305);
+    this->register_for_gcode('M', 500);
+    this->register_for_gcode('M', 503);
     this->register_for_event(ON_GET_PUBLIC_DATA);
 
     if(!this->readonly) {
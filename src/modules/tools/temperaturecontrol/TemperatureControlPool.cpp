@@ -31,13 +31,13 @@ void TemperatureControlPool::load_tools()
         if( THEKERNEL->config->value(temperature_control_checksum, cs, enable_checksum )->as_bool() ) {
             TemperatureControl *controller = new TemperatureControl(cs, cnt++);
             controllers.push_back( cs );
-            THEKERNEL->add_module(controller);
+            THEKERNEL->add_module(controller, "TemperatureControl");
         }
     }
 
     // no need to create one of these if no heaters defined
     if(cnt > 0) {
         PID_Autotuner *pidtuner = new PID_Autotuner();
-        THEKERNEL->add_module( pidtuner );
+        THEKERNEL->add_module( pidtuner, "PID_Autotuner" );
     }
 }
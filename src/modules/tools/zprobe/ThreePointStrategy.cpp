@@ -64,6 +64,7 @@
 #include "ZProbe.h"
 #include "Plane3D.h"
 #include "nuts_bolts.h"
+#include "libs/decimal.h"
 
 #include <string>
 #include <algorithm>
@@ -338,9 +339,9 @@ std::tuple<float, float> ThreePointStrategy::parseXY(const char *str)
 {
     float x = NAN, y = NAN;
     char *p;
-    x = strtof(str, &p);
+    x = decimal_strtof(str, &p);
     if(p + 1 < str + strlen(str)) {
-        y = strtof(p + 1, nullptr);
+        y = decimal_strtof(p + 1, nullptr);
     }
     return std::make_tuple(x, y);
 }
@@ -350,11 +351,11 @@ std::tuple<float, float, float> ThreePointStrategy::parseXYZ(const char *str)
 {
     float x = 0, y = 0, z= 0;
     char *p;
-    x = strtof(str, &p);
+    x = decimal_strtof(str, &p);
     if(p + 1 < str + strlen(str)) {
-        y = strtof(p + 1, &p);
+        y = decimal_strtof(p + 1, &p);
         if(p + 1 < str + strlen(str)) {
-            z = strtof(p + 1, nullptr);
+            z = decimal_strtof(p + 1, nullptr);
         }
     }
     return std::make_tuple(x, y, z);
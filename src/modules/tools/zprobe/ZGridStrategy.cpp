@@ -78,6 +78,7 @@
 #include "platform_memory.h"
 #include "MemoryPool.h"
 #include "libs/utils.h"
+#include "libs/decimal.h"
 
 #include <string>
 #include <algorithm>
@@ -609,11 +610,11 @@ std::tuple<float, float, float> ZGridStrategy::parseXYZ(const char *str)
 {
     float x = 0, y = 0, z= 0;
     char *p;
-    x = strtof(str, &p);
+    x = decimal_strtof(str, &p);
     if(p + 1 < str + strlen(str)) {
-        y = strtof(p + 1, &p);
+        y = decimal_strtof(p + 1, &p);
         if(p + 1 < str + strlen(str)) {
-            z = strtof(p + 1, nullptr);
+            z = decimal_strtof(p + 1, nullptr);
         }
     }
     return std::make_tuple(x, y, z);
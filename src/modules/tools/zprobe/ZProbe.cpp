@@ -319,20 +319,20 @@ void ZProbe::acceleration_tick(void)
 }
 
 void ZProbe::accelerate(int c)
-{   uint32_t current_rate = STEPPER[c]->get_steps_per_second();
-    uint32_t target_rate = floorf(this->current_feedrate);
+{   uint32_t current_rate = STEPPER[c]->get_rate();
+    uint32_t target_rate = floorf(this->current_feedrate * STEP_RATE_ONE);
 
     // Z may have a different acceleration to X and Y
     float acc= (c==Z_AXIS) ? THEKERNEL->planner->get_z_acceleration() : THEKERNEL->planner->get_acceleration();
     if( current_rate < target_rate ) {
-        uint32_t rate_increase = floorf((acc / THEKERNEL->acceleration_ticks_per_second) * STEPS_PER_MM(c));
+        uint32_t rate_increase = floorf((acc / THEKERNEL->acceleration_ticks_per_second) * STEPS_PER_MM(c) * STEP_RATE_ONE);
         current_rate = min( target_rate, current_rate + rate_increase );
     }
     if( current_rate > target_rate ) {
         current_rate = target_rate;
     }
 
-    // steps per second
+    // 1/256 steps per second
     STEPPER[c]->set_rate(current_rate);
 }
 
@@ -27,7 +27,9 @@
 
 void Configurator::on_module_loaded()
 {
-    this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
+    this->register_for_command("config-get");
+    this->register_for_command("config-set");
+    this->register_for_command("config-load");
     //    this->register_for_event(ON_GCODE_RECEIVED);
     //    this->register_for_event(ON_MAIN_LOOP);
 }
@@ -35,11 +37,8 @@ void Configurator::on_module_loaded()
 // When a new line is received, check if it is a command, and if it is, act upon it
 void Configurator::on_console_line_received( void *argument )
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(argument);
-
-    // ignore comments and blank lines and if this is a G code then also ignore it
-    char first_char = new_message.message[0];
-    if(strchr(";( \n\rGMTN", first_char) != NULL) return;
+    // only called for the commands registered in on_module_loaded
+    SerialMessage &new_message = *static_cast<SerialMessage *>(argument);
 
     string possible_command = new_message.message;
     string cmd = shift_parameter(possible_command);
@@ -189,7 +189,7 @@ void Panel::on_module_loaded()
     // Register for events
     this->register_for_event(ON_IDLE);
     this->register_for_event(ON_MAIN_LOOP);
-    this->register_for_event(ON_GCODE_RECEIVED);
+    this->register_for_gcode('M', 117);
     this->register_for_event(ON_HALT);
 
     // Refresh timer
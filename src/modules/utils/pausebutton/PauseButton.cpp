@@ -41,7 +41,10 @@ void PauseButton::on_module_loaded()
         this->kill_button = this->pause_button;
     }
 
+    // every line for M999, which is a gcode
     this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
+    this->register_for_command("freeze");
+    this->register_for_command("unfreeze");
 
     if( (this->pause_enable && this->pause_button.connected()) || (this->kill_enable && this->kill_button.connected()) ) {
         THEKERNEL->slow_ticker->attach( 10, this, &PauseButton::button_tick );
@@ -92,7 +95,7 @@ uint32_t PauseButton::button_tick(uint32_t dummy)
 // When a new line is received, check if it is a command, and if it is, act upon it
 void PauseButton::on_console_line_received( void *argument )
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(argument);
+    SerialMessage &new_message = *static_cast<SerialMessage *>(argument);
 
     if(this->killed && new_message.message == "M999") {
         this->killed= false;
@@ -103,7 +106,8 @@ void PauseButton::on_console_line_received( void *argument )
     char first_char = new_message.message[0];
     if(strchr(";( \n\rGMTN", first_char) != NULL) return;
 
-    string cmd = shift_parameter(new_message.message);
+    string possible_command = new_message.message;
+    string cmd = shift_parameter(possible_command);
 
     if (cmd == "freeze") {
         if( !THEKERNEL->pauser->paused() ) {
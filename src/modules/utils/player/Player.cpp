@@ -63,12 +63,12 @@ Player::Player()
 
 void Player::on_module_loaded()
 {
-    this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
+    for (const char *cmd : {"play", "progress", "abort", "suspend", "resume"}) this->register_for_command(cmd);
     this->register_for_event(ON_MAIN_LOOP);
     this->register_for_event(ON_SECOND_TICK);
     this->register_for_event(ON_GET_PUBLIC_DATA);
     this->register_for_event(ON_SET_PUBLIC_DATA);
-    this->register_for_event(ON_GCODE_RECEIVED);
+    for (unsigned int m : {21, 23, 24, 25, 26, 27, 32, 600}) this->register_for_gcode('M', m);
     this->register_for_event(ON_HALT);
 
     this->on_boot_gcode = THEKERNEL->config->value(on_boot_gcode_checksum)->by_default("/sd/on_boot.gcode")->as_string();
@@ -231,11 +231,8 @@ void Player::on_console_line_received( void *argument )
 {
     if(halted) return; // if in halted state ignore any commands
 
-    SerialMessage new_message = *static_cast<SerialMessage *>(argument);
-
-    // ignore comments and blank lines and if this is a G code then also ignore it
-    char first_char = new_message.message[0];
-    if(strchr(";( \n\rGMTN", first_char) != NULL) return;
+    // only called for the commands registered in on_module_loaded
+    SerialMessage &new_message = *static_cast<SerialMessage *>(argument);
 
     string possible_command = new_message.message;
     string cmd = shift_parameter(possible_command);
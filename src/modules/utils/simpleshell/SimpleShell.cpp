@@ -31,6 +31,8 @@
 #include "SwitchPublicAccess.h"
 #include "SDFAT.h"
 #include "Thermistor.h"
+#include "IsrProfiler.h"
+#include "EventProfiler.h"
 
 #include "system_LPC17xx.h"
 #include "LPC17xx.h"
@@ -62,6 +64,8 @@ const SimpleShell::ptentry_t SimpleShell::commands_table[] = {
     {"?",        SimpleShell::help_command},
     {"version",  SimpleShell::version_command},
     {"mem",      SimpleShell::mem_command},
+    {"isrstats", SimpleShell::isrstats_command},
+    {"eventstats", SimpleShell::eventstats_command},
     {"get",      SimpleShell::get_command},
     {"set_temp", SimpleShell::set_temp_command},
     {"switch",   SimpleShell::switch_command},
@@ -135,8 +139,10 @@ static uint32_t heapWalk(StreamOutput *stream, bool verbose)
 
 void SimpleShell::on_module_loaded()
 {
-    this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
-    this->register_for_event(ON_GCODE_RECEIVED);
+    for (const ptentry_t *p = commands_table; p->command != NULL; ++p) {
+        this->register_for_command(p->command);
+    }
+    for (unsigned int m : {20, 30, 501, 504}) this->register_for_gcode('M', m);
     this->register_for_event(ON_SECOND_TICK);
 
     reset_delay_secs = 0;
@@ -202,11 +208,8 @@ bool SimpleShell::parse_command(const char *cmd, string args, StreamOutput *stre
 // When a new line is received, check if it is a command, and if it is, act upon it
 void SimpleShell::on_console_line_received( void *argument )
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(argument);
-
-    // ignore comments and blank lines and if this is a G code then also ignore it
-    char first_char = new_message.message[0];
-    if(strchr(";( \n\rGMTN", first_char) != NULL) return;
+    // only called for the commands of commands_table
+    SerialMessage &new_message = *static_cast<SerialMessage *>(argument);
 
     string possible_command = new_message.message;
 
@@ -488,6 +491,36 @@ void SimpleShell::mem_command( string parameters, StreamOutput *stream)
     }
 }
 
+// show how long the interrupts take and how regularly they run, then start measuring again
+void SimpleShell::isrstats_command( string parameters, StreamOutput *stream)
+{
+    string what = shift_parameter( parameters );
+    if (what == "on") {
+        IsrProfiler::enable(true);
+        stream->printf("isr profiler on\r\n");
+    } else if (what == "off") {
+        IsrProfiler::enable(false);
+        stream->printf("isr profiler off\r\n");
+    } else {
+        IsrProfiler::dump_and_reset(stream);
+    }
+}
+
+// show the modules whose event handlers took the most time, then start measuring again
+void SimpleShell::eventstats_command( string parameters, StreamOutput *stream)
+{
+    string what = shift_parameter( parameters );
+    if (what == "on") {
+        EventProfiler::enable(true);
+        stream->printf("event profiler on\r\n");
+    } else if (what == "off") {
+        EventProfiler::enable(false);
+        stream->printf("event profiler off\r\n");
+    } else {
+        EventProfiler::dump_and_reset(stream, what.empty() ? 10 : strtol(what.c_str(), NULL, 10));
+    }
+}
+
 static uint32_t getDeviceType()
 {
 #define IAP_LOCATION 0x1FFF1FF1
@@ -656,6 +689,8 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("Commands:\r\n");
     stream->printf("version\r\n");
     stream->printf("mem [-v]\r\n");
+    stream->printf("isrstats [on|off] - interrupt times and jitter in cycles since the last isrstats\r\n");
+    stream->printf("eventstats [on|off|count] - the module event handlers that took the most time since the last eventstats\r\n");
     stream->printf("ls [-s] [folder]\r\n");
     stream->printf("cd folder\r\n");
     stream->printf("pwd\r\n");
@@ -46,6 +46,8 @@ private:
     static void calc_thermistor_command( string parameters, StreamOutput *stream);
     static void switch_command(string parameters, StreamOutput *stream );
     static void mem_command(string parameters, StreamOutput *stream );
+    static void isrstats_command(string parameters, StreamOutput *stream );
+    static void eventstats_command(string parameters, StreamOutput *stream );
 
     static void net_command( string parameters, StreamOutput *stream);
 